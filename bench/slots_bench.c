@@ -0,0 +1,108 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Times looking up the cairo backend's images by id, in its slot table
+// and in the array scan it replaced, with 10, 100 and 1000 images held.
+// The ids are looked up in a shuffled order, as a scene full of icons
+// would draw them.
+//
+// Built and run by make bench on the cairo targets.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cairo_ctx.h"
+
+#define LOOKUPS 4000000
+
+// keeps the lookups from being optimized away
+static volatile uintptr_t g_sink;
+
+// how the images were held before the slot table
+typedef struct {
+  int id;
+  cairo_surface_t* surface;
+  cairo_pattern_t* pattern;
+} scan_entry_t;
+
+static scan_entry_t* scan_find(scan_entry_t* p_entries, int used, int id)
+{
+  for (int i = 0; i < used; i++) {
+    if (p_entries[i].id == id) {
+      return &p_entries[i];
+    }
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------
+static double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void shuffle(int* p_ids, int count)
+{
+  for (int i = count - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    int t = p_ids[i];
+    p_ids[i] = p_ids[j];
+    p_ids[j] = t;
+  }
+}
+
+//---------------------------------------------------------
+static int bench(int resident)
+{
+  slot_table_t table;
+  slot_table_init(&table, sizeof(image_pattern_data_t));
+
+  int* p_ids = malloc(sizeof(int) * resident);
+  scan_entry_t* p_entries = calloc(resident, sizeof(scan_entry_t));
+  if (!p_ids || !p_entries) {
+    fprintf(stderr, "slots_bench: out of memory\n");
+    return 1;
+  }
+
+  for (int i = 0; i < resident; i++) {
+    if (!slot_table_alloc(&table, &p_ids[i])) {
+      fprintf(stderr, "slots_bench: slot table full\n");
+      return 1;
+    }
+    p_entries[i].id = p_ids[i];
+  }
+  shuffle(p_ids, resident);
+
+  double start = now_ns();
+  for (int i = 0; i < LOOKUPS; i++) {
+    g_sink += (uintptr_t)slot_table_find(&table, p_ids[i % resident]);
+  }
+  double slot_ns = (now_ns() - start) / LOOKUPS;
+
+  start = now_ns();
+  for (int i = 0; i < LOOKUPS; i++) {
+    g_sink += (uintptr_t)scan_find(p_entries, resident, p_ids[i % resident]);
+  }
+  double scan_ns = (now_ns() - start) / LOOKUPS;
+
+  printf("%8d %13.1f %13.1f\n", resident, slot_ns, scan_ns);
+
+  free(p_entries);
+  free(p_ids);
+  slot_table_fini(&table);
+  return 0;
+}
+
+//---------------------------------------------------------
+int main(int argc, char **argv)
+{
+  srand(1);
+  printf("  images  slot ns/find  scan ns/find\n");
+  return bench(10) || bench(100) || bench(1000);
+}
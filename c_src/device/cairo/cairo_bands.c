@@ -0,0 +1,290 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Splits each frame into horizontal bands and draws them in parallel.
+// Every band replays the whole scene through its own cairo_t, clipped to
+// its rows, so scripts outside of a band are culled before they are
+// drawn. The calling thread draws the first band and the workers the
+// rest. Images and fonts are shared and only read while drawing.
+//
+// The same workers are available to the devices for other work that
+// splits by rows, such as converting the frame for the screen.
+
+#include <cairo.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bounds.h"
+#include "cairo_ctx.h"
+#include "comms.h"
+#include "device.h"
+
+// more than this and the bands get too thin to be worth it
+#define MAX_BANDS 64
+
+typedef struct {
+  pthread_t thread;
+  uint32_t index;
+
+  // kept from frame to frame while the band covers the same rows
+  cairo_surface_t* surface;
+  cairo_t* cr;
+  pattern_stack_t* pattern_stack;
+  int pattern_stack_count;
+} band_t;
+
+static struct {
+  uint32_t count;
+  band_t* bands;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  uint32_t generation;
+  uint32_t remaining;
+  bool f_quit;
+
+  // the job being run
+  cairo_band_fn_t fn;
+  void* user_data;
+} g_bands = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .start = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER,
+};
+
+// the frame being drawn
+typedef struct {
+  driver_data_t* p_data;
+  scenic_cairo_ctx_t* p_ctx;
+  bbox_t view;
+  bbox_t clip;
+  uint8_t* p_pixels;
+  cairo_format_t format;
+  int width;
+  int height;
+  int stride;
+} band_frame_t;
+
+//---------------------------------------------------------
+static void render_band(uint32_t index, uint32_t count, void* user_data)
+{
+  band_frame_t* p_frame = (band_frame_t*)user_data;
+  int y0 = p_frame->height * index / count;
+  int y1 = p_frame->height * (index + 1) / count;
+  bbox_t area = bbox_intersect(p_frame->clip, (bbox_t){0, y0, p_frame->width, y1});
+  if ((area.x0 >= area.x1) || (area.y0 >= area.y1)) {
+    return;
+  }
+
+  // the band's rows of the frame. The device offset lets everything
+  // keep using frame coordinates
+  band_t* p_band = &g_bands.bands[index];
+  uint8_t* p_rows = p_frame->p_pixels + y0 * p_frame->stride;
+  if (!p_band->surface
+      || (cairo_image_surface_get_data(p_band->surface) != p_rows)
+      || (cairo_image_surface_get_format(p_band->surface) != p_frame->format)
+      || (cairo_image_surface_get_width(p_band->surface) != p_frame->width)
+      || (cairo_image_surface_get_height(p_band->surface) != y1 - y0)
+      || (cairo_image_surface_get_stride(p_band->surface) != p_frame->stride)) {
+    cairo_surface_destroy(p_band->surface);
+    p_band->surface = cairo_image_surface_create_for_data(
+      p_rows, p_frame->format, p_frame->width, y1 - y0, p_frame->stride);
+    cairo_surface_set_device_offset(p_band->surface, 0, -y0);
+  }
+
+  // the band starts from the frame's fill and stroke and keeps its own
+  // references to them
+  scenic_cairo_ctx_t ctx = *p_frame->p_ctx;
+  ctx.surface = p_band->surface;
+  ctx.cr = p_band->cr;
+  ctx.pattern_stack = p_band->pattern_stack;
+  ctx.pattern_stack_count = p_band->pattern_stack_count;
+  ctx.pattern_stack_used = 0;
+  cairo_pattern_reference(ctx.pattern.fill);
+  cairo_pattern_reference(ctx.pattern.stroke);
+
+  scenic_cairo_begin_frame(&ctx);
+  cairo_rectangle(ctx.cr, area.x0, area.y0, area.x1 - area.x0, area.y1 - area.y0);
+  cairo_clip(ctx.cr);
+
+  driver_data_t data = *p_frame->p_data;
+  data.v_ctx = &ctx;
+  render_scene(&data, bbox_intersect(p_frame->view, area));
+
+  scenic_cairo_end_frame(&ctx);
+  pattern_stack_release(&ctx);
+  p_band->cr = ctx.cr;
+  p_band->pattern_stack = ctx.pattern_stack;
+  p_band->pattern_stack_count = ctx.pattern_stack_count;
+}
+
+//---------------------------------------------------------
+static void* band_main(void* user_data)
+{
+  band_t* p_band = (band_t*)user_data;
+  uint32_t generation = 0;
+
+  pthread_mutex_lock(&g_bands.mutex);
+  while (true) {
+    while (!g_bands.f_quit && (g_bands.generation == generation)) {
+      pthread_cond_wait(&g_bands.start, &g_bands.mutex);
+    }
+    if (g_bands.f_quit) {
+      break;
+    }
+    generation = g_bands.generation;
+    pthread_mutex_unlock(&g_bands.mutex);
+
+    g_bands.fn(p_band->index, g_bands.count, g_bands.user_data);
+
+    pthread_mutex_lock(&g_bands.mutex);
+    if (--g_bands.remaining == 0) {
+      pthread_cond_signal(&g_bands.done);
+    }
+  }
+  pthread_mutex_unlock(&g_bands.mutex);
+
+  return NULL;
+}
+
+//---------------------------------------------------------
+// 0 threads is one per cpu. Anything less than two draws the frame in
+// one piece as before
+void cairo_bands_init(int threads)
+{
+  if (threads == 0) {
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (threads > MAX_BANDS) {
+    threads = MAX_BANDS;
+  }
+  if (threads < 2) {
+    return;
+  }
+
+  g_bands.bands = calloc(threads, sizeof(band_t));
+  if (!g_bands.bands) {
+    log_error("cairo: no memory for %d render threads", threads);
+    return;
+  }
+
+  // band 0 is drawn by the thread rendering the frame
+  g_bands.count = 1;
+  for (int i = 1; i < threads; i++) {
+    band_t* p_band = &g_bands.bands[i];
+    p_band->index = i;
+    if (pthread_create(&p_band->thread, NULL, band_main, p_band)) {
+      log_error("cairo: could only start %d render threads", g_bands.count);
+      break;
+    }
+    g_bands.count++;
+  }
+
+  if (g_bands.count < 2) {
+    free(g_bands.bands);
+    g_bands.bands = NULL;
+    g_bands.count = 0;
+    return;
+  }
+  log_info("cairo: rendering in %d bands", g_bands.count);
+}
+
+//---------------------------------------------------------
+void cairo_bands_fini()
+{
+  if (!g_bands.bands) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_bands.mutex);
+  g_bands.f_quit = true;
+  pthread_cond_broadcast(&g_bands.start);
+  pthread_mutex_unlock(&g_bands.mutex);
+
+  for (uint32_t i = 1; i < g_bands.count; i++) {
+    pthread_join(g_bands.bands[i].thread, NULL);
+  }
+  for (uint32_t i = 0; i < g_bands.count; i++) {
+    cairo_destroy(g_bands.bands[i].cr);
+    cairo_surface_destroy(g_bands.bands[i].surface);
+    free(g_bands.bands[i].pattern_stack);
+  }
+  free(g_bands.bands);
+  g_bands.bands = NULL;
+  g_bands.count = 0;
+}
+
+//---------------------------------------------------------
+// Calls fn once for each band, in parallel, and returns when they are
+// all done. Index 0 runs on the calling thread.
+void cairo_bands_run(cairo_band_fn_t fn, void* user_data)
+{
+  if (!g_bands.bands) {
+    fn(0, 1, user_data);
+    return;
+  }
+
+  pthread_mutex_lock(&g_bands.mutex);
+  g_bands.fn = fn;
+  g_bands.user_data = user_data;
+  g_bands.remaining = g_bands.count - 1;
+  g_bands.generation++;
+  pthread_cond_broadcast(&g_bands.start);
+  pthread_mutex_unlock(&g_bands.mutex);
+
+  fn(0, g_bands.count, user_data);
+
+  pthread_mutex_lock(&g_bands.mutex);
+  while (g_bands.remaining > 0) {
+    pthread_cond_wait(&g_bands.done, &g_bands.mutex);
+  }
+  pthread_mutex_unlock(&g_bands.mutex);
+}
+
+//---------------------------------------------------------
+// The device has already set up p_ctx->cr for the frame with
+// scenic_cairo_begin_frame, clipped to the part being repainted and
+// cleared. Each band draws inside of that clip. The frame is ended here.
+void device_render_scene(driver_data_t* p_data, bbox_t view)
+{
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
+  cairo_surface_t* surface = p_ctx->surface;
+
+  if (!g_bands.bands
+      || (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE)
+      || (cairo_image_surface_get_height(surface) < (int)g_bands.count)) {
+    render_scene(p_data, view);
+    scenic_cairo_end_frame(p_ctx);
+    pattern_cache_end_frame();
+    return;
+  }
+
+  double x0, y0, x1, y1;
+  cairo_clip_extents(p_ctx->cr, &x0, &y0, &x1, &y1);
+
+  // the clear is done by p_ctx->cr and the bands write to the pixels
+  // behind cairo's back
+  cairo_surface_flush(surface);
+
+  band_frame_t frame = {
+    .p_data = p_data,
+    .p_ctx = p_ctx,
+    .view = view,
+    .clip = {x0, y0, x1, y1},
+    .p_pixels = cairo_image_surface_get_data(surface),
+    .format = cairo_image_surface_get_format(surface),
+    .width = cairo_image_surface_get_width(surface),
+    .height = cairo_image_surface_get_height(surface),
+    .stride = cairo_image_surface_get_stride(surface),
+  };
+  cairo_bands_run(render_band, &frame);
+
+  cairo_surface_mark_dirty(surface);
+  scenic_cairo_end_frame(p_ctx);
+  pattern_cache_end_frame();
+}
@@ -1,3 +1,6 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "cairo_ctx.h"
 #include "device.h"
 
@@ -16,6 +19,9 @@ scenic_cairo_ctx_t* scenic_cairo_init(const device_opts_t* p_opts,
     return NULL;
   }
 
+  slot_table_init(&p_ctx->images, sizeof(image_pattern_data_t));
+  slot_table_init(&p_ctx->fonts, sizeof(font_data_t));
+
   p_ctx->ratio = 1.0f;
   p_ctx->dist_tolerance = 0.1f * p_ctx->ratio;
 
@@ -39,15 +45,53 @@ scenic_cairo_ctx_t* scenic_cairo_init(const device_opts_t* p_opts,
   p_ctx->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
                                               p_info->width, p_info->height);
 
+  cairo_bands_init(p_opts->render_threads);
+
   return p_ctx;
 }
 
 void scenic_cairo_fini(scenic_cairo_ctx_t* p_ctx)
 {
+  cairo_bands_fini();
+  pattern_stack_release(p_ctx);
+  pattern_cache_clear();
+  free(p_ctx->pattern_stack);
+  slot_table_fini(&p_ctx->images);
+  slot_table_fini(&p_ctx->fonts);
+  cairo_destroy(p_ctx->cr);
   cairo_surface_destroy(p_ctx->surface);
   free(p_ctx);
 }
 
+// The cairo_t is kept from one frame to the next. It is only made again
+// when it is drawing somewhere else or has gone into an error state.
+// Everything a frame changes sits inside of the save made here, so
+// restoring it in scenic_cairo_end_frame starts the next frame clean.
+void scenic_cairo_begin_frame(scenic_cairo_ctx_t* p_ctx)
+{
+  if (!p_ctx->cr
+      || (cairo_get_target(p_ctx->cr) != p_ctx->surface)
+      || (cairo_status(p_ctx->cr) != CAIRO_STATUS_SUCCESS)) {
+    cairo_destroy(p_ctx->cr);
+    p_ctx->cr = cairo_create(p_ctx->surface);
+  }
+
+  // the path isn't part of the saved state
+  cairo_new_path(p_ctx->cr);
+  cairo_save(p_ctx->cr);
+}
+
+// Unwinds any states the scripts pushed and never popped, then the save
+// made in scenic_cairo_begin_frame
+void scenic_cairo_end_frame(scenic_cairo_ctx_t* p_ctx)
+{
+  while (p_ctx->pattern_stack_used > 0) {
+    cairo_restore(p_ctx->cr);
+    pattern_stack_pop(p_ctx);
+  }
+  cairo_restore(p_ctx->cr);
+}
+
 void device_begin_cursor_render(driver_data_t* p_data)
 {
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
@@ -70,34 +114,99 @@ char* device_gl_error()
   return NULL;
 }
 
-void pattern_stack_push(scenic_cairo_ctx_t* p_ctx)
+// The surface still holds the last frame drawn. Paths ending in .png are
+// written as PNGs. Anything else gets the raw pixels, a row at a time
+// with no padding, as cairo's native endian 32 bit ARGB.
+void device_dump_frame(const char* path)
 {
-  pattern_stack_t* ptr = (pattern_stack_t*)malloc(sizeof(pattern_stack_t));
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)g_device_info.v_ctx;
+  cairo_surface_t* surface = p_ctx->surface;
+  cairo_surface_flush(surface);
+
+  size_t path_len = strlen(path);
+  if ((path_len >= 4) && !strcmp(path + path_len - 4, ".png")) {
+    cairo_status_t status = cairo_surface_write_to_png(surface, path);
+    if (status != CAIRO_STATUS_SUCCESS) {
+      log_error("cairo: Unable to write %s: %s", path, cairo_status_to_string(status));
+    }
+    return;
+  }
 
-  ptr->pattern = p_ctx->pattern;
-  ptr->text_align = p_ctx->text_align;
-  ptr->text_base = p_ctx->text_base;
+  FILE* p_file = fopen(path, "wb");
+  if (!p_file) {
+    log_error("cairo: Unable to open %s", path);
+    return;
+  }
 
-  if (!p_ctx->pattern_stack_head) {
-    ptr->next = NULL;
-    p_ctx->pattern_stack_head = ptr;
-  } else {
-    ptr->next = p_ctx->pattern_stack_head;
-    p_ctx->pattern_stack_head = ptr;
+  const uint8_t* p_pixels = cairo_image_surface_get_data(surface);
+  int stride = cairo_image_surface_get_stride(surface);
+  int width = cairo_image_surface_get_width(surface);
+  int height = cairo_image_surface_get_height(surface);
+  bool ok = true;
+  for (int y = 0; ok && (y < height); y++) {
+    ok = fwrite(p_pixels + y * stride, 4, width, p_file) == (size_t)width;
+  }
+
+  if (fclose(p_file) || !ok) {
+    log_error("cairo: Unable to write %s", path);
   }
 }
 
-void pattern_stack_pop(scenic_cairo_ctx_t* p_ctx)
+// The stack is an array that only ever grows, so once it is deep enough
+// for the scene, pushing and popping state doesn't touch the heap
+bool pattern_stack_push(scenic_cairo_ctx_t* p_ctx)
 {
-  pattern_stack_t* ptr = p_ctx->pattern_stack_head;
+  if (p_ctx->pattern_stack_used >= p_ctx->pattern_stack_count) {
+    int count = p_ctx->pattern_stack_count ? p_ctx->pattern_stack_count * 2 : 16;
+    pattern_stack_t* stack = (pattern_stack_t*)realloc(p_ctx->pattern_stack,
+                                                       sizeof(pattern_stack_t) * count);
+    if (!stack) {
+      log_error("pattern stack out of memory");
+      return false;
+    }
+    p_ctx->pattern_stack = stack;
+    p_ctx->pattern_stack_count = count;
+  }
+
+  pattern_stack_t* ptr = &p_ctx->pattern_stack[p_ctx->pattern_stack_used++];
+
+  // the saved patterns get their own references. Whatever replaces them
+  // on the context releases its own when it is popped
+  ptr->pattern.fill = cairo_pattern_reference(p_ctx->pattern.fill);
+  ptr->pattern.stroke = cairo_pattern_reference(p_ctx->pattern.stroke);
+  ptr->text_align = p_ctx->text_align;
+  ptr->text_base = p_ctx->text_base;
+
+  return true;
+}
 
-  if (!ptr) {
+bool pattern_stack_pop(scenic_cairo_ctx_t* p_ctx)
+{
+  if (p_ctx->pattern_stack_used <= 0) {
     log_error("pattern stack underflow");
-  } else {
-    p_ctx->pattern = ptr->pattern;
-    p_ctx->text_align = ptr->text_align;
-    p_ctx->text_base = ptr->text_base;
-    p_ctx->pattern_stack_head = p_ctx->pattern_stack_head->next;
-    free(ptr);
+    return false;
+  }
+
+  pattern_stack_t* ptr = &p_ctx->pattern_stack[--p_ctx->pattern_stack_used];
+
+  cairo_pattern_destroy(p_ctx->pattern.fill);
+  cairo_pattern_destroy(p_ctx->pattern.stroke);
+  p_ctx->pattern = ptr->pattern;
+  p_ctx->text_align = ptr->text_align;
+  p_ctx->text_base = ptr->text_base;
+
+  return true;
+}
+
+// Drops the context's references to its current patterns and to anything
+// still saved on its stack
+void pattern_stack_release(scenic_cairo_ctx_t* p_ctx)
+{
+  while (p_ctx->pattern_stack_used > 0) {
+    pattern_stack_pop(p_ctx);
   }
+  cairo_pattern_destroy(p_ctx->pattern.fill);
+  cairo_pattern_destroy(p_ctx->pattern.stroke);
+  p_ctx->pattern.fill = NULL;
+  p_ctx->pattern.stroke = NULL;
 }
@@ -10,24 +10,36 @@ typedef struct {
   cairo_pattern_t* stroke;
 } fill_stroke_pattern_t;
 
-typedef struct pattern_stack_t_ {
+typedef struct {
   fill_stroke_pattern_t pattern;
   text_align_t text_align;
   text_base_t text_base;
-  struct pattern_stack_t_* next;
 } pattern_stack_t;
 
 typedef struct {
-  int id;
   cairo_surface_t* surface;
   cairo_pattern_t* pattern;
 } image_pattern_data_t;
 
 typedef struct {
-  int id;
   cairo_font_face_t* font_face;
 } font_data_t;
 
+typedef struct {
+  int id;
+  int generation;
+  int next_free;
+} slot_t;
+
+typedef struct {
+  slot_t* slots;
+  uint8_t* items;
+  size_t item_size;
+  int count;
+  int used;
+  int free_head;
+} slot_table_t;
+
 typedef struct {
   color_rgba_t clear_color;
   FT_Library ft_library;
@@ -36,16 +48,12 @@ typedef struct {
   text_base_t text_base;
   cairo_surface_t* surface;
   cairo_t* cr;
-  pattern_stack_t* pattern_stack_head;
+  pattern_stack_t* pattern_stack;
+  int pattern_stack_count;
+  int pattern_stack_used;
   fill_stroke_pattern_t pattern;
-  int images_count;
-  int images_used;
-  int highest_image_id;
-  image_pattern_data_t* images;
-  int fonts_count;
-  int fonts_used;
-  int highest_font_id;
-  font_data_t* fonts;
+  slot_table_t images;
+  slot_table_t fonts;
   float dist_tolerance;
   float ratio;
 } scenic_cairo_ctx_t;
@@ -53,9 +61,33 @@ typedef struct {
 scenic_cairo_ctx_t* scenic_cairo_init(const device_opts_t* p_opts,
                                       device_info_t* p_info);
 void scenic_cairo_fini(scenic_cairo_ctx_t* p_ctx);
+void scenic_cairo_begin_frame(scenic_cairo_ctx_t* p_ctx);
+void scenic_cairo_end_frame(scenic_cairo_ctx_t* p_ctx);
+
+typedef void (*cairo_band_fn_t)(uint32_t index, uint32_t count, void* user_data);
+
+void cairo_bands_init(int threads);
+void cairo_bands_fini();
+void cairo_bands_run(cairo_band_fn_t fn, void* user_data);
+
+bool pattern_stack_push(scenic_cairo_ctx_t* p_ctx);
+bool pattern_stack_pop(scenic_cairo_ctx_t* p_ctx);
+void pattern_stack_release(scenic_cairo_ctx_t* p_ctx);
+
+cairo_pattern_t* pattern_cache_color(color_rgba_t color);
+cairo_pattern_t* pattern_cache_linear(coordinates_t start, coordinates_t end,
+                                      color_rgba_t color_start, color_rgba_t color_end);
+cairo_pattern_t* pattern_cache_radial(coordinates_t center,
+                                      float inner_radius, float outer_radius,
+                                      color_rgba_t color_start, color_rgba_t color_end);
+void pattern_cache_end_frame();
+void pattern_cache_clear();
 
-void pattern_stack_push(scenic_cairo_ctx_t* p_ctx);
-void pattern_stack_pop(scenic_cairo_ctx_t* p_ctx);
+void slot_table_init(slot_table_t* p_table, size_t item_size);
+void slot_table_fini(slot_table_t* p_table);
+void* slot_table_alloc(slot_table_t* p_table, int* p_id);
+void* slot_table_find(const slot_table_t* p_table, int id);
+bool slot_table_free(slot_table_t* p_table, int id);
 
 image_pattern_data_t* find_image_pattern(scenic_cairo_ctx_t* p_ctx, int id);
 font_data_t* find_font(scenic_cairo_ctx_t* p_ctx, int id);
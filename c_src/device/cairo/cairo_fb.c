@@ -2,6 +2,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/fb.h>
+#include <math.h>
 #include <sched.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
@@ -10,25 +11,71 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "bounds.h"
 #include "cairo_ctx.h"
 #include "comms.h"
 #include "device.h"
 #include "fontstash.h"
+#include "pixels.h"
 #include "scenic_ops.h"
+#include "trace.h"
 
 #define FB0_TIMEOUT 60 //seconds
 
+// repaints smaller than this are converted without handing off to the
+// render threads
+#define PARALLEL_CONVERT_PIXELS (64 * 1024)
+
+// converts a row of cairo pixels to the screen's format
+typedef void (*convert_row_t)(void* p_dst, const void* p_src, uint32_t count,
+                              uint32_t x, uint32_t y, bool dither);
+
 typedef struct {
   int fd;
 
-  union {
-    u_int8_t  *c;
-    u_int16_t *s;
-    u_int32_t *i;
-  } rgb_buff;
+  // when cairo can't draw into the framebuffer directly, each frame is
+  // converted into it a row at a time
+  convert_row_t convert;
+  uint32_t cpp;
+  bool f_dither;
 
   struct fb_var_screeninfo var;
   struct fb_fix_screeninfo fix;
+
+  // the screen info as it was before we touched it, put back on close
+  struct fb_var_screeninfo var_orig;
+  bool f_var_changed;
+
+  // the framebuffer is mapped once for the life of the device
+  uint8_t* p_fb;
+  size_t fb_size;
+
+  // where the top left of the picture sits on the screen. It is centered
+  // when smaller than the screen
+  uint32_t x_offs;
+  uint32_t y_offs;
+
+  // cairo draws straight into the framebuffer, so there is nothing to
+  // convert or copy at the end of a frame
+  bool f_direct;
+  cairo_surface_t* page_surfaces[2];
+
+  // the cairo_t of the page not being drawn into, kept for when it is
+  cairo_t* page_crs[2];
+
+  // With two pages, frames are drawn into the hidden one, which is then
+  // shown with FBIOPAN_DISPLAY. The hidden page still holds the frame
+  // before the one on screen, so it is missing that frame's changes too.
+  uint32_t page_count;
+  uint32_t back_page;
+  bbox_t last_damage;
+  bool f_vsync;
+
+  // pixel rectangle of the surface being repainted this frame
+  uint32_t damage_x0;
+  uint32_t damage_y0;
+  uint32_t damage_x1;
+  uint32_t damage_y1;
 } cairo_fb_t;
 
 cairo_fb_t g_cairo_fb = {0};
@@ -82,6 +129,128 @@ void set332map(int fh)
     set8map(fh, &map332);
 }
 
+//---------------------------------------------------------
+// Try for a virtual screen twice the visible height, so there is a page
+// to draw into while the other one is shown. Stays single buffered if
+// the driver can't do that or can't pan.
+static void setup_pages(int fd)
+{
+  g_cairo_fb.page_count = 1;
+  g_cairo_fb.back_page = 0;
+  g_cairo_fb.var_orig = g_cairo_fb.var;
+
+  struct fb_var_screeninfo* p_var = &g_cairo_fb.var;
+  if (p_var->yres_virtual < p_var->yres * 2) {
+    struct fb_var_screeninfo var = *p_var;
+    var.yres_virtual = var.yres * 2;
+    var.xoffset = 0;
+    var.yoffset = 0;
+    if (ioctl(fd, FBIOPUT_VSCREENINFO, &var)) {
+      log_info("cairo: fb can't be made taller, drawing single buffered");
+      return;
+    }
+    g_cairo_fb.f_var_changed = true;
+
+    // the driver may have adjusted what it was given
+    if (ioctl(fd, FBIOGET_VSCREENINFO, p_var)
+        || ioctl(fd, FBIOGET_FSCREENINFO, &g_cairo_fb.fix)) {
+      log_error("cairo: Failed to re-read the screen info: %s", strerror(errno));
+      return;
+    }
+  }
+
+  uint32_t page_size = g_cairo_fb.fix.line_length * p_var->yres;
+  if ((p_var->yres_virtual < p_var->yres * 2)
+      || (g_cairo_fb.fix.smem_len && (g_cairo_fb.fix.smem_len < page_size * 2))) {
+    log_info("cairo: no room for a second fb page, drawing single buffered");
+    return;
+  }
+
+  // show the first page, which also checks that panning works
+  p_var->xoffset = 0;
+  p_var->yoffset = 0;
+  if (ioctl(fd, FBIOPAN_DISPLAY, p_var)) {
+    log_info("cairo: fb can't pan, drawing single buffered");
+    return;
+  }
+
+  g_cairo_fb.page_count = 2;
+  g_cairo_fb.back_page = 1;
+  g_cairo_fb.last_damage = bbox_infinite;
+}
+
+//---------------------------------------------------------
+// show the page that was just drawn, and draw into the other one next
+static void present_page(int fd)
+{
+  if (g_cairo_fb.page_count < 2) {
+    return;
+  }
+
+#ifdef FBIO_WAITFORVSYNC
+  if (g_cairo_fb.f_vsync) {
+    uint32_t crtc = 0;
+    if (ioctl(fd, FBIO_WAITFORVSYNC, &crtc)) {
+      log_info("cairo: fb can't wait for vsync, flipping without it");
+      g_cairo_fb.f_vsync = false;
+    }
+  }
+#endif
+
+  g_cairo_fb.var.yoffset = g_cairo_fb.back_page * g_cairo_fb.var.yres;
+  if (ioctl(fd, FBIOPAN_DISPLAY, &g_cairo_fb.var)) {
+    // Keep drawing into the page that is still on screen, all of it.
+    // device_end_render stops drawing into it directly
+    log_error("cairo: FBIOPAN_DISPLAY failed, drawing single buffered");
+    g_cairo_fb.page_count = 1;
+    g_cairo_fb.back_page ^= 1;
+    invalidate_frame();
+    return;
+  }
+
+  g_cairo_fb.back_page ^= 1;
+}
+
+//---------------------------------------------------------
+static uint8_t* page_origin(uint32_t page)
+{
+  return g_cairo_fb.p_fb
+    + (page * g_cairo_fb.var.yres + g_cairo_fb.y_offs) * g_cairo_fb.fix.line_length;
+}
+
+static bool is_xrgb32(const struct fb_var_screeninfo* p_var)
+{
+  return (p_var->bits_per_pixel == 32)
+    && (p_var->red.offset == 16) && (p_var->red.length == 8)
+    && (p_var->green.offset == 8) && (p_var->green.length == 8)
+    && (p_var->blue.offset == 0) && (p_var->blue.length == 8);
+}
+
+//---------------------------------------------------------
+// 24 bit screens take the bytes of cairo's little endian words as they
+// are, less the alpha
+static void argb32_to_rgb24(void* p_dst, const void* p_src, uint32_t count,
+                            uint32_t x, uint32_t y, bool dither)
+{
+  uint8_t* p_out = (uint8_t*)p_dst;
+  const uint8_t* p_in = (const uint8_t*)p_src;
+  for (uint32_t i = 0; i < count; i++, p_out += 3, p_in += 4) {
+    p_out[0] = p_in[0];
+    p_out[1] = p_in[1];
+    p_out[2] = p_in[2];
+  }
+}
+
+static void argb32_to_xrgb32(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither)
+{
+  uint32_t* p_out = (uint32_t*)p_dst;
+  const uint32_t* p_in = (const uint32_t*)p_src;
+  for (uint32_t i = 0; i < count; i++) {
+    p_out[i] = p_in[i] & 0x00ffffff;
+  }
+}
+
 int device_init(const device_opts_t* p_opts,
                 device_info_t* p_info,
                 driver_data_t* p_data)
@@ -96,6 +265,7 @@ int device_init(const device_opts_t* p_opts,
   }
 
   p_info->v_ctx = p_ctx;
+  p_info->f_partial_render = true;
 
   time_t fb0_timer_start = time(NULL);
   while ((time(NULL) - fb0_timer_start) < FB0_TIMEOUT) {
@@ -120,27 +290,94 @@ int device_init(const device_opts_t* p_opts,
     return -1;
   }
 
+  g_cairo_fb.f_vsync = p_opts->vsync;
+  setup_pages(g_cairo_fb.fd);
+
+  g_cairo_fb.fb_size = g_cairo_fb.fix.smem_len
+    ? g_cairo_fb.fix.smem_len
+    : g_cairo_fb.fix.line_length * g_cairo_fb.var.yres_virtual;
+  g_cairo_fb.p_fb = mmap(NULL, g_cairo_fb.fb_size,
+                         PROT_WRITE | PROT_READ, MAP_SHARED, g_cairo_fb.fd, 0);
+  if (g_cairo_fb.p_fb == MAP_FAILED) {
+    log_error("cairo: failed to mmap fb: %s", strerror(errno));
+    g_cairo_fb.p_fb = NULL;
+    return -1;
+  }
+
   uint32_t width = cairo_image_surface_get_width(p_ctx->surface);
   uint32_t height = cairo_image_surface_get_height(p_ctx->surface);
-  size_t pix_count = width * height;
+
+  g_cairo_fb.x_offs = (width < g_cairo_fb.var.xres)
+                      ? (g_cairo_fb.var.xres - width) / 2
+                      : 0;
+  g_cairo_fb.y_offs = (height < g_cairo_fb.var.yres)
+                      ? (g_cairo_fb.var.yres - height) / 2
+                      : 0;
+
+  // A 32bpp XRGB screen has the same layout as a cairo ARGB32 surface.
+  // When the whole picture fits on it, cairo can draw into each page
+  // directly. Only with two pages though. With one, every frame would be
+  // drawn onto the page being scanned out, clear and all
+  if ((g_cairo_fb.page_count == 2)
+      && is_xrgb32(&g_cairo_fb.var)
+      && (g_cairo_fb.fix.line_length % 4 == 0)
+      && (g_cairo_fb.x_offs + width <= g_cairo_fb.fix.line_length / 4)
+      && (g_cairo_fb.y_offs + height <= g_cairo_fb.var.yres)) {
+    bool ok = true;
+    for (uint32_t page = 0; page < g_cairo_fb.page_count; page++) {
+      cairo_surface_t* surface = cairo_image_surface_create_for_data(
+        page_origin(page) + g_cairo_fb.x_offs * 4, CAIRO_FORMAT_ARGB32,
+        width, height, g_cairo_fb.fix.line_length);
+      g_cairo_fb.page_surfaces[page] = surface;
+      ok = ok && (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS);
+    }
+    if (ok) {
+      cairo_surface_destroy(p_ctx->surface);
+      p_ctx->surface = cairo_surface_reference(
+        g_cairo_fb.page_surfaces[g_cairo_fb.back_page]);
+      g_cairo_fb.f_direct = true;
+      return 0;
+    }
+    for (uint32_t page = 0; page < g_cairo_fb.page_count; page++) {
+      cairo_surface_destroy(g_cairo_fb.page_surfaces[page]);
+      g_cairo_fb.page_surfaces[page] = NULL;
+    }
+  }
+
+  bool is_bgr555 = (g_cairo_fb.var.red.offset == 0)
+    && (g_cairo_fb.var.green.offset == 5)
+    && (g_cairo_fb.var.blue.offset == 10);
+
+  g_cairo_fb.f_dither = p_opts->dither;
 
   switch (g_cairo_fb.var.bits_per_pixel)
   {
   case 8:
-    g_cairo_fb.rgb_buff.c = (uint8_t*)malloc(pix_count * sizeof(uint8_t));
+    g_cairo_fb.convert = pixels_argb32_to_rgb332;
+    g_cairo_fb.cpp = 1;
 
     get8map(g_cairo_fb.fd, &map_back);
     set332map(g_cairo_fb.fd);
     break;
   case 15:
   case 16:
-    g_cairo_fb.rgb_buff.c = (uint8_t*)malloc(pix_count * sizeof(uint16_t));
+    if (is_bgr555) {
+      g_cairo_fb.convert = pixels_argb32_to_bgr555;
+    } else if ((g_cairo_fb.var.bits_per_pixel == 15)
+               || (g_cairo_fb.var.green.length == 5)) {
+      g_cairo_fb.convert = pixels_argb32_to_rgb555;
+    } else {
+      g_cairo_fb.convert = pixels_argb32_to_rgb565;
+    }
+    g_cairo_fb.cpp = 2;
     break;
   case 24:
-    g_cairo_fb.rgb_buff.c = (uint8_t*)malloc(pix_count * 3 * sizeof(uint8_t));
+    g_cairo_fb.convert = argb32_to_rgb24;
+    g_cairo_fb.cpp = 3;
     break;
   case 32:
-    g_cairo_fb.rgb_buff.c = (uint8_t*)malloc(pix_count * sizeof(uint32_t));
+    g_cairo_fb.convert = argb32_to_xrgb32;
+    g_cairo_fb.cpp = 4;
     break;
   default:
     log_error("cairo: Unsupported video mode: %dbpp", g_cairo_fb.var.bits_per_pixel);
@@ -160,11 +397,23 @@ int device_close(device_info_t* p_info)
     set8map(g_cairo_fb.fd, &map_back);
   }
 
-  close(g_cairo_fb.fd);
-  free(g_cairo_fb.rgb_buff.c);
-
+  // the surface may point into the framebuffer, so it goes first
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_info->v_ctx;
   scenic_cairo_fini(p_ctx);
+
+  for (uint32_t page = 0; page < 2; page++) {
+    cairo_destroy(g_cairo_fb.page_crs[page]);
+    if (g_cairo_fb.page_surfaces[page]) {
+      cairo_surface_destroy(g_cairo_fb.page_surfaces[page]);
+    }
+  }
+  if (g_cairo_fb.p_fb) {
+    munmap(g_cairo_fb.p_fb, g_cairo_fb.fb_size);
+  }
+  if (g_cairo_fb.f_var_changed) {
+    ioctl(g_cairo_fb.fd, FBIOPUT_VSCREENINFO, &g_cairo_fb.var_orig);
+  }
+  close(g_cairo_fb.fd);
 }
 
 void device_poll()
@@ -179,8 +428,48 @@ void device_begin_render(driver_data_t* p_data)
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
 
-  cairo_destroy(p_ctx->cr);
-  p_ctx->cr = cairo_create(p_ctx->surface);
+  if (g_cairo_fb.page_count == 2) {
+    bbox_t damage = p_data->damage;
+    p_data->damage = bbox_union(damage, g_cairo_fb.last_damage);
+    g_cairo_fb.last_damage = damage;
+  }
+
+  if (g_cairo_fb.f_direct) {
+    uint32_t page = g_cairo_fb.back_page;
+    cairo_surface_t* surface = g_cairo_fb.page_surfaces[page];
+    if (p_ctx->surface != surface) {
+      cairo_t* cr = g_cairo_fb.page_crs[page];
+      g_cairo_fb.page_crs[page] = NULL;
+      g_cairo_fb.page_crs[page ^ 1] = p_ctx->cr;
+      p_ctx->cr = cr;
+
+      cairo_surface_destroy(p_ctx->surface);
+      p_ctx->surface = cairo_surface_reference(surface);
+    }
+  }
+
+  scenic_cairo_begin_frame(p_ctx);
+
+  // Only the damaged part of the frame is repainted. Everything outside
+  // of it is left as it was from the last frame
+  uint32_t width = cairo_image_surface_get_width(p_ctx->surface);
+  uint32_t height = cairo_image_surface_get_height(p_ctx->surface);
+  bbox_t area = bbox_intersect(p_data->damage, (bbox_t){0, 0, width, height});
+  if (bbox_is_empty(area)) {
+    g_cairo_fb.damage_x0 = g_cairo_fb.damage_x1 = 0;
+    g_cairo_fb.damage_y0 = g_cairo_fb.damage_y1 = 0;
+  } else {
+    g_cairo_fb.damage_x0 = floorf(area.x0);
+    g_cairo_fb.damage_y0 = floorf(area.y0);
+    g_cairo_fb.damage_x1 = ceilf(area.x1);
+    g_cairo_fb.damage_y1 = ceilf(area.y1);
+  }
+
+  cairo_rectangle(p_ctx->cr,
+                  g_cairo_fb.damage_x0, g_cairo_fb.damage_y0,
+                  g_cairo_fb.damage_x1 - g_cairo_fb.damage_x0,
+                  g_cairo_fb.damage_y1 - g_cairo_fb.damage_y0);
+  cairo_clip(p_ctx->cr);
 
   // Paint surface to clear color
   cairo_set_source_rgba(p_ctx->cr,
@@ -191,111 +480,51 @@ void device_begin_render(driver_data_t* p_data)
   cairo_paint(p_ctx->cr);
 }
 
-inline static uint8_t to_8_color(uint8_t r, uint8_t g, uint8_t b)
-{
-    return ((((r >> 5) & 7) << 5) |
-            (((g >> 5) & 7) << 2) |
-            ((b >> 6) & 3));
-}
-
-inline static uint16_t to_15_color(uint8_t r, uint8_t g, uint8_t b)
-{
-    return ((((r >> 3) & 31) << 10) |
-            (((g >> 3) & 31) << 5)  |
-            ((b >> 3) & 31));
-}
-
-inline static uint16_t to_15_color_bgr(uint8_t r, uint8_t g, uint8_t b)
-{
-    return ((((b >> 3) & 31) << 10) |
-            (((g >> 3) & 31) << 5)  |
-            ((r >> 3) & 31));
-}
-
-inline static uint16_t to_16_color(uint8_t r, uint8_t g, uint8_t b)
+//---------------------------------------------------------
+// the rectangle of the frame going to the screen
+typedef struct {
+  const uint8_t* p_src;
+  uint32_t src_stride;
+  uint8_t* p_dst;
+  uint32_t dst_stride;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+} fb_copy_t;
+
+// converts this band's share of the rows
+static void convert_rows(uint32_t index, uint32_t count, void* user_data)
 {
-    return ((((r >> 3) & 31) << 11) |
-            (((g >> 2) & 63) << 5)  |
-            ((b >> 3) & 31));
+  const fb_copy_t* p_copy = (const fb_copy_t*)user_data;
+  uint32_t first = p_copy->height * index / count;
+  uint32_t last = p_copy->height * (index + 1) / count;
+
+  for (uint32_t row = first; row < last; row++) {
+    g_cairo_fb.convert(p_copy->p_dst + row * p_copy->dst_stride,
+                       p_copy->p_src + row * p_copy->src_stride,
+                       p_copy->width,
+                       p_copy->x, p_copy->y + row,
+                       g_cairo_fb.f_dither);
+  }
 }
 
 void render_cairo_surface_to_fb(scenic_cairo_ctx_t* p_ctx)
 {
   cairo_surface_flush(p_ctx->surface);
-  uint8_t* cairo_buff = cairo_image_surface_get_data(p_ctx->surface);
-  uint32_t width = cairo_image_surface_get_width(p_ctx->surface);
-  uint32_t height = cairo_image_surface_get_height(p_ctx->surface);
-
-  bool is_bgr555 = ((g_cairo_fb.var.red.offset == 0 &&
-                     g_cairo_fb.var.green.offset == 5 &&
-                     g_cairo_fb.var.blue.offset == 10))
-                    ? true
-                    : false;
-
-  size_t pix_count = width * height;
-
-  int cpp = 0;
-  switch (g_cairo_fb.var.bits_per_pixel)
-  {
-  case 8:
-    cpp = 1;
-    for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-      g_cairo_fb.rgb_buff.c[i] = to_8_color(cairo_buff[j+2],
-                                            cairo_buff[j+1],
-                                            cairo_buff[j+0]);
-    }
-    break;
-  case 15:
-    cpp = 2;
-    if (is_bgr555) {
-      for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-        g_cairo_fb.rgb_buff.s[i] = to_15_color_bgr(cairo_buff[j+2],
-                                                   cairo_buff[j+1],
-                                                   cairo_buff[j+0]);
-      }
-    } else {
-      for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-        g_cairo_fb.rgb_buff.s[i] = to_15_color(cairo_buff[j+2],
-                                               cairo_buff[j+1],
-                                               cairo_buff[j+0]);
-      }
-    }
-    break;
-  case 16:
-    cpp = 2;
-    if (is_bgr555) {
-      for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-        g_cairo_fb.rgb_buff.s[i] = to_15_color_bgr(cairo_buff[j+2],
-                                                   cairo_buff[j+1],
-                                                   cairo_buff[j+0]);
-      }
-    } else {
-      for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-        g_cairo_fb.rgb_buff.s[i] = to_16_color(cairo_buff[j+2],
-                                               cairo_buff[j+1],
-                                               cairo_buff[j+0]);
-      }
-    }
-    break;
-  case 24:
-    cpp = 3;
-    for (uint32_t i = 0, j = 0; i < (cpp * pix_count); i += 3, j += 4) {
-      g_cairo_fb.rgb_buff.c[i+0] = cairo_buff[j+0];
-      g_cairo_fb.rgb_buff.c[i+1] = cairo_buff[j+1];
-      g_cairo_fb.rgb_buff.c[i+2] = cairo_buff[j+2];
-    }
-    break;
-  case 32:
-    cpp = 4;
-    for (uint32_t i = 0, j = 0; i < pix_count; i++, j += 4) {
-      g_cairo_fb.rgb_buff.i[i] = ((cairo_buff[j+2] << 16)) |
-                                  (cairo_buff[j+1] << 8) |
-                                  (cairo_buff[j+0]);
-    }
-    break;
+  if (g_cairo_fb.f_direct) {
+    return;
   }
 
-  uint32_t x_stride = (g_cairo_fb.fix.line_length * 8) / g_cairo_fb.var.bits_per_pixel;
+  // only the damaged rectangle is converted, straight into the page
+  uint32_t x0 = g_cairo_fb.damage_x0;
+  uint32_t x1 = g_cairo_fb.damage_x1;
+  uint32_t y0 = g_cairo_fb.damage_y0;
+  uint32_t y1 = g_cairo_fb.damage_y1;
+
+  uint32_t cpp = g_cairo_fb.cpp;
+  uint32_t line_length = g_cairo_fb.fix.line_length;
+  uint32_t x_stride = line_length / cpp;
 
   uint32_t pic_xs = g_device_info.width;
   uint32_t pic_ys = g_device_info.height;
@@ -305,28 +534,66 @@ void render_cairo_surface_to_fb(scenic_cairo_ctx_t* p_ctx)
   uint32_t xc = (pic_xs > scr_xs) ? scr_xs : pic_xs;
   uint32_t yc = (pic_ys > scr_ys) ? scr_ys : pic_ys;
 
-  uint32_t x_offs = (pic_xs < g_cairo_fb.var.xres)
-                    ? (g_cairo_fb.var.xres - pic_xs) / 2
-                    : 0;
-  uint32_t y_offs = (pic_ys < g_cairo_fb.var.yres)
-                    ? (g_cairo_fb.var.yres - pic_ys) / 2
-                    : 0;
+  // clip the damage to what is visible on the screen
+  if (x1 > xc) x1 = xc;
+  if (y1 > yc) y1 = yc;
+  if ((x0 >= x1) || (y0 >= y1)) {
+    return;
+  }
 
-  size_t fb_size = scr_xs * scr_ys * cpp;
-  uint8_t* fb = mmap(NULL, fb_size, PROT_WRITE | PROT_READ, MAP_SHARED, g_cairo_fb.fd, 0);
+  uint32_t src_stride = cairo_image_surface_get_stride(p_ctx->surface);
+  fb_copy_t copy = {
+    .p_src = cairo_image_surface_get_data(p_ctx->surface) + y0 * src_stride + x0 * 4,
+    .src_stride = src_stride,
+    .p_dst = page_origin(g_cairo_fb.back_page)
+      + y0 * line_length + (g_cairo_fb.x_offs + x0) * cpp,
+    .dst_stride = line_length,
+    .x = x0,
+    .y = y0,
+    .width = x1 - x0,
+    .height = y1 - y0
+  };
+
+  if (copy.width * copy.height >= PARALLEL_CONVERT_PIXELS) {
+    cairo_bands_run(convert_rows, &copy);
+  } else {
+    convert_rows(0, 1, &copy);
+  }
+}
 
-  if (fb == MAP_FAILED) {
-    log_error("cairo: failed to mmap fb");
+//---------------------------------------------------------
+// Once flipping fails there is only the page on screen, so frames go back
+// to being drawn offscreen and copied over. The copy is all of the frame
+// the first time, since present_page invalidated it
+static void stop_drawing_direct(scenic_cairo_ctx_t* p_ctx)
+{
+  cairo_surface_t* surface = cairo_image_surface_create(
+    CAIRO_FORMAT_ARGB32,
+    cairo_image_surface_get_width(p_ctx->surface),
+    cairo_image_surface_get_height(p_ctx->surface));
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    log_error("cairo: no memory to draw offscreen, drawing onto the screen");
+    cairo_surface_destroy(surface);
     return;
   }
 
-  uint8_t* p_fb = fb + (y_offs * scr_xs + x_offs) * cpp;
-  uint8_t* p_image = g_cairo_fb.rgb_buff.c;
-
-  for (uint32_t i = 0; i < yc; i++, p_fb += scr_xs * cpp, p_image += pic_xs * cpp)
-    memcpy(p_fb, p_image, xc * cpp);
+  cairo_destroy(p_ctx->cr);
+  p_ctx->cr = NULL;
+  cairo_surface_destroy(p_ctx->surface);
+  p_ctx->surface = surface;
+
+  for (uint32_t page = 0; page < 2; page++) {
+    cairo_destroy(g_cairo_fb.page_crs[page]);
+    g_cairo_fb.page_crs[page] = NULL;
+    if (g_cairo_fb.page_surfaces[page]) {
+      cairo_surface_destroy(g_cairo_fb.page_surfaces[page]);
+      g_cairo_fb.page_surfaces[page] = NULL;
+    }
+  }
 
-  munmap(fb, fb_size);
+  g_cairo_fb.convert = argb32_to_xrgb32;
+  g_cairo_fb.cpp = 4;
+  g_cairo_fb.f_direct = false;
 }
 
 void device_end_render(driver_data_t* p_data)
@@ -337,6 +604,14 @@ void device_end_render(driver_data_t* p_data)
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
   render_cairo_surface_to_fb(p_ctx);
+
+  int64_t trace_start = trace_begin();
+  present_page(g_cairo_fb.fd);
+  trace_end(trace_start, trace_present, 0, NULL, 0);
+
+  if (g_cairo_fb.f_direct && (g_cairo_fb.page_count < 2)) {
+    stop_drawing_direct(p_ctx);
+  }
 }
 
 void device_loop(driver_data_t* p_data)
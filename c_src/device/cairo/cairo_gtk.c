@@ -226,8 +226,7 @@ void device_begin_render(driver_data_t* p_data)
   // Don't allow gtk to draw while p_ctx->surface is being rendered
   g_mutex_lock(&g_cairo_gtk.render_mutex);
 
-  cairo_destroy(p_ctx->cr);
-  p_ctx->cr = cairo_create(p_ctx->surface);
+  scenic_cairo_begin_frame(p_ctx);
 
   // Paint surface to clear color
   cairo_set_source_rgba(p_ctx->cr,
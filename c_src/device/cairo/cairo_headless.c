@@ -0,0 +1,168 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Draws into a cairo image surface in memory and never shows it, so the
+// driver can run where there is no display or framebuffer, such as on a
+// build server. Everything else is as on a screen: the full port
+// protocol runs over stdin and stdout, and device_dump_frame writes out
+// what was drawn when the caller asks.
+//
+// Frames are presented as soon as they are drawn. With a refresh_rate
+// set, presenting waits for the next tick of a simulated display at that
+// rate instead, as vsync would.
+
+#include <cairo.h>
+#include <math.h>
+#include <time.h>
+
+#include "bounds.h"
+#include "cairo_ctx.h"
+#include "comms.h"
+#include "device.h"
+#include "scenic_ops.h"
+#include "trace.h"
+
+#define NSECS_PER_SEC 1000000000
+
+typedef struct {
+  // nanoseconds between simulated refreshes, or 0 for none
+  int64_t refresh_period;
+  // when the next refresh happens
+  struct timespec next_refresh;
+} cairo_headless_t;
+
+cairo_headless_t g_cairo_headless = {0};
+
+extern device_info_t g_device_info;
+extern device_opts_t g_opts;
+
+//---------------------------------------------------------
+static void add_nsecs(struct timespec* p_ts, int64_t nsecs)
+{
+  nsecs += p_ts->tv_nsec;
+  p_ts->tv_sec += nsecs / NSECS_PER_SEC;
+  p_ts->tv_nsec = nsecs % NSECS_PER_SEC;
+}
+
+//---------------------------------------------------------
+// Waits for the next refresh. A frame that missed its refresh goes out
+// at the one after, and the ticks carry on from there
+static void wait_for_refresh()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  struct timespec* p_next = &g_cairo_headless.next_refresh;
+  while ((p_next->tv_sec < now.tv_sec)
+         || ((p_next->tv_sec == now.tv_sec) && (p_next->tv_nsec <= now.tv_nsec))) {
+    add_nsecs(p_next, g_cairo_headless.refresh_period);
+  }
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, p_next, NULL)) {
+    // interrupted by a signal, keep waiting
+  }
+}
+
+int device_init(const device_opts_t* p_opts,
+                device_info_t* p_info,
+                driver_data_t* p_data)
+{
+  if (g_opts.debug_mode) {
+    log_info("cairo %s", __func__);
+  }
+
+  scenic_cairo_ctx_t* p_ctx = scenic_cairo_init(p_opts, p_info);
+  if (!p_ctx) {
+    log_error("cairo %s failed", __func__);
+    return -1;
+  }
+
+  if (cairo_surface_status(p_ctx->surface) != CAIRO_STATUS_SUCCESS) {
+    log_error("cairo: Unable to create a %dx%d surface", p_info->width, p_info->height);
+    scenic_cairo_fini(p_ctx);
+    return -1;
+  }
+
+  p_info->v_ctx = p_ctx;
+  p_info->f_partial_render = true;
+
+  if (p_opts->refresh_rate > 0) {
+    g_cairo_headless.refresh_period = NSECS_PER_SEC / p_opts->refresh_rate;
+    clock_gettime(CLOCK_MONOTONIC, &g_cairo_headless.next_refresh);
+  }
+
+  return 0;
+}
+
+int device_close(device_info_t* p_info)
+{
+  if (g_opts.debug_mode) {
+    log_info("cairo %s", __func__);
+  }
+
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_info->v_ctx;
+  scenic_cairo_fini(p_ctx);
+
+  return 0;
+}
+
+void device_poll()
+{
+}
+
+void device_begin_render(driver_data_t* p_data)
+{
+  if (g_opts.debug_mode) {
+    log_info("cairo %s", __func__);
+  }
+
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
+  scenic_cairo_begin_frame(p_ctx);
+
+  // The surface keeps the last frame, so only the damaged part of this
+  // one is repainted
+  uint32_t width = cairo_image_surface_get_width(p_ctx->surface);
+  uint32_t height = cairo_image_surface_get_height(p_ctx->surface);
+  bbox_t area = bbox_intersect(p_data->damage, (bbox_t){0, 0, width, height});
+  if (bbox_is_empty(area)) {
+    area = (bbox_t){0, 0, 0, 0};
+  }
+
+  cairo_rectangle(p_ctx->cr,
+                  floorf(area.x0), floorf(area.y0),
+                  ceilf(area.x1) - floorf(area.x0),
+                  ceilf(area.y1) - floorf(area.y0));
+  cairo_clip(p_ctx->cr);
+
+  // Paint surface to clear color
+  cairo_set_source_rgba(p_ctx->cr,
+                        p_ctx->clear_color.red,
+                        p_ctx->clear_color.green,
+                        p_ctx->clear_color.blue,
+                        p_ctx->clear_color.alpha);
+  cairo_paint(p_ctx->cr);
+}
+
+void device_end_render(driver_data_t* p_data)
+{
+  if (g_opts.debug_mode) {
+    log_info("cairo %s", __func__);
+  }
+
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)p_data->v_ctx;
+  cairo_surface_flush(p_ctx->surface);
+
+  if (g_cairo_headless.refresh_period) {
+    int64_t trace_start = trace_begin();
+    wait_for_refresh();
+    trace_end(trace_start, trace_present, 0, NULL, 0);
+  }
+}
+
+void device_loop(driver_data_t* p_data)
+{
+  scenic_loop(p_data);
+}
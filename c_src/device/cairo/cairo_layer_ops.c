@@ -0,0 +1,115 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Layers are ARGB32 image surfaces. Each is drawn through its own
+// context, made from the one drawing the frame in the same way as the
+// render bands make theirs, so images, fonts and patterns are shared.
+
+#include <cairo.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "cairo_ctx.h"
+#include "layer_ops.h"
+
+typedef struct {
+  cairo_surface_t* surface;
+  // kept from one drawing of the layer to the next
+  scenic_cairo_ctx_t ctx;
+} cairo_layer_t;
+
+//---------------------------------------------------------
+void* layer_ops_create(void* v_ctx, uint32_t width, uint32_t height)
+{
+  cairo_layer_t* p_layer = calloc(1, sizeof(cairo_layer_t));
+  if (!p_layer) {
+    return NULL;
+  }
+
+  p_layer->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status(p_layer->surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(p_layer->surface);
+    free(p_layer);
+    return NULL;
+  }
+
+  return p_layer;
+}
+
+//---------------------------------------------------------
+void layer_ops_delete(void* v_ctx, void* v_layer)
+{
+  cairo_layer_t* p_layer = (cairo_layer_t*)v_layer;
+  cairo_destroy(p_layer->ctx.cr);
+  free(p_layer->ctx.pattern_stack);
+  cairo_surface_destroy(p_layer->surface);
+  free(p_layer);
+}
+
+//---------------------------------------------------------
+void* layer_ops_begin(void* v_ctx, void* v_layer)
+{
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
+  cairo_layer_t* p_layer = (cairo_layer_t*)v_layer;
+
+  // the layer starts from the frame's fill and stroke and keeps its own
+  // references to them
+  cairo_t* cr = p_layer->ctx.cr;
+  pattern_stack_t* pattern_stack = p_layer->ctx.pattern_stack;
+  int pattern_stack_count = p_layer->ctx.pattern_stack_count;
+  p_layer->ctx = *p_ctx;
+  p_layer->ctx.surface = p_layer->surface;
+  p_layer->ctx.cr = cr;
+  p_layer->ctx.pattern_stack = pattern_stack;
+  p_layer->ctx.pattern_stack_count = pattern_stack_count;
+  p_layer->ctx.pattern_stack_used = 0;
+  cairo_pattern_reference(p_layer->ctx.pattern.fill);
+  cairo_pattern_reference(p_layer->ctx.pattern.stroke);
+
+  scenic_cairo_begin_frame(&p_layer->ctx);
+
+  cairo_set_operator(p_layer->ctx.cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint(p_layer->ctx.cr);
+  cairo_set_operator(p_layer->ctx.cr, CAIRO_OPERATOR_OVER);
+
+  return &p_layer->ctx;
+}
+
+//---------------------------------------------------------
+void layer_ops_end(void* v_ctx, void* v_layer, void* v_layer_ctx)
+{
+  cairo_layer_t* p_layer = (cairo_layer_t*)v_layer;
+  scenic_cairo_end_frame(&p_layer->ctx);
+  pattern_stack_release(&p_layer->ctx);
+  cairo_surface_flush(p_layer->surface);
+}
+
+//---------------------------------------------------------
+// paint doesn't touch the current path, which the script may still be
+// building
+void layer_ops_draw(void* v_ctx, void* v_layer, float x, float y, float w, float h)
+{
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
+  cairo_layer_t* p_layer = (cairo_layer_t*)v_layer;
+  cairo_t* cr = p_ctx->cr;
+
+  cairo_save(cr);
+  cairo_translate(cr, x, y);
+  cairo_scale(cr, w / cairo_image_surface_get_width(p_layer->surface),
+              h / cairo_image_surface_get_height(p_layer->surface));
+  cairo_set_source_surface(cr, p_layer->surface, 0, 0);
+  cairo_paint(cr);
+  cairo_restore(cr);
+}
+
+//---------------------------------------------------------
+float layer_ops_scale(void* v_ctx)
+{
+  scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
+  cairo_matrix_t m;
+  cairo_get_matrix(p_ctx->cr, &m);
+  return fmaxf(hypotf(m.xx, m.yx), hypotf(m.xy, m.yy));
+}
@@ -0,0 +1,263 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Interns the solid color and gradient patterns the scripts ask for, so the
+// same color set every frame is the same cairo_pattern_t every frame.
+//
+// The cache holds one reference to each pattern and every lookup hands the
+// caller another one. The context owns the references to its current fill
+// and stroke and the pattern stack owns the ones it saved, so a pattern
+// dropped from the cache lives on until nothing is drawing with it.
+// Patterns that haven't been used for a while are dropped at the end of a
+// frame, which keeps the cache from growing on scenes that animate their
+// gradients.
+//
+// The render threads share the cache, so lookups are done under a lock.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cairo_ctx.h"
+#include "comms.h"
+
+// must be a power of two. Only half of the slots are ever used, which keeps
+// the probe sequences short
+#define PATTERN_CACHE_SLOTS 1024
+#define PATTERN_CACHE_MAX (PATTERN_CACHE_SLOTS / 2)
+
+// frames a pattern can go unused before it is dropped
+#define PATTERN_CACHE_FRAMES 60
+
+typedef enum {
+  PATTERN_NONE = 0,
+  PATTERN_COLOR,
+  PATTERN_LINEAR,
+  PATTERN_RADIAL,
+} pattern_kind_t;
+
+// compared as bytes, so it is always zeroed before it is filled in
+typedef struct {
+  uint32_t kind;
+  float params[4];
+  color_rgba_t colors[2];
+} pattern_key_t;
+
+typedef struct {
+  pattern_key_t key;
+  uint32_t hash;
+  uint32_t last_used;
+  cairo_pattern_t* pattern;
+} pattern_entry_t;
+
+static struct {
+  pthread_mutex_t mutex;
+  uint32_t count;
+  uint32_t frame;
+  bool f_full;
+  pattern_entry_t entries[PATTERN_CACHE_SLOTS];
+} g_patterns = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+//---------------------------------------------------------
+// FNV-1a
+static uint32_t hash_key(const pattern_key_t* p_key)
+{
+  const uint8_t* p = (const uint8_t*)p_key;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < sizeof(pattern_key_t); i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+//---------------------------------------------------------
+static pattern_entry_t* find_slot(const pattern_key_t* p_key, uint32_t hash)
+{
+  uint32_t mask = PATTERN_CACHE_SLOTS - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    pattern_entry_t* p_entry = &g_patterns.entries[i];
+    if (!p_entry->pattern) {
+      return p_entry;
+    }
+    if ((p_entry->hash == hash) && !memcmp(&p_entry->key, p_key, sizeof(pattern_key_t))) {
+      return p_entry;
+    }
+  }
+}
+
+//---------------------------------------------------------
+// Drops the cache's reference to every pattern not used since min_frame and
+// packs the rest back in. Anything still set on a context stays alive
+static void evict(uint32_t min_frame)
+{
+  static pattern_entry_t kept[PATTERN_CACHE_MAX];
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < PATTERN_CACHE_SLOTS; i++) {
+    pattern_entry_t* p_entry = &g_patterns.entries[i];
+    if (!p_entry->pattern) {
+      continue;
+    }
+    if ((int32_t)(p_entry->last_used - min_frame) >= 0) {
+      kept[count++] = *p_entry;
+    } else {
+      cairo_pattern_destroy(p_entry->pattern);
+    }
+  }
+
+  if (count == g_patterns.count) {
+    return;
+  }
+
+  memset(g_patterns.entries, 0, sizeof(g_patterns.entries));
+  for (uint32_t i = 0; i < count; i++) {
+    *find_slot(&kept[i].key, kept[i].hash) = kept[i];
+  }
+  g_patterns.count = count;
+}
+
+//---------------------------------------------------------
+static cairo_pattern_t* create_pattern(const pattern_key_t* p_key)
+{
+  cairo_pattern_t* pattern;
+  const float* p = p_key->params;
+
+  switch (p_key->kind) {
+    case PATTERN_COLOR:
+      return cairo_pattern_create_rgba(p_key->colors[0].red / 255.0f,
+                                       p_key->colors[0].green / 255.0f,
+                                       p_key->colors[0].blue / 255.0f,
+                                       p_key->colors[0].alpha / 255.0f);
+    case PATTERN_LINEAR:
+      pattern = cairo_pattern_create_linear(p[0], p[1], p[2], p[3]);
+      break;
+    case PATTERN_RADIAL:
+      pattern = cairo_pattern_create_radial(p[0], p[1], p[2], p[0], p[1], p[3]);
+      break;
+    default:
+      return NULL;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    cairo_pattern_add_color_stop_rgba(pattern, i,
+                                      p_key->colors[i].red / 255.0f,
+                                      p_key->colors[i].green / 255.0f,
+                                      p_key->colors[i].blue / 255.0f,
+                                      p_key->colors[i].alpha / 255.0f);
+  }
+  return pattern;
+}
+
+//---------------------------------------------------------
+// Returns a new reference to the pattern for the key, creating it if it
+// isn't cached yet
+static cairo_pattern_t* lookup(const pattern_key_t* p_key)
+{
+  uint32_t hash = hash_key(p_key);
+  cairo_pattern_t* pattern;
+
+  pthread_mutex_lock(&g_patterns.mutex);
+
+  pattern_entry_t* p_entry = find_slot(p_key, hash);
+  if (!p_entry->pattern && (g_patterns.count >= PATTERN_CACHE_MAX) && !g_patterns.f_full) {
+    // make room by dropping everything this frame hasn't used. If that
+    // doesn't free anything, don't try again until the next frame
+    evict(g_patterns.frame);
+    g_patterns.f_full = g_patterns.count >= PATTERN_CACHE_MAX;
+    p_entry = find_slot(p_key, hash);
+  }
+
+  if (p_entry->pattern) {
+    pattern = p_entry->pattern;
+    p_entry->last_used = g_patterns.frame;
+  } else if (g_patterns.count < PATTERN_CACHE_MAX) {
+    pattern = create_pattern(p_key);
+    p_entry->key = *p_key;
+    p_entry->hash = hash;
+    p_entry->last_used = g_patterns.frame;
+    p_entry->pattern = pattern;
+    g_patterns.count++;
+  } else {
+    // the frame really does use this many patterns. Hand this one out
+    // uncached rather than grow
+    pthread_mutex_unlock(&g_patterns.mutex);
+    return create_pattern(p_key);
+  }
+
+  cairo_pattern_reference(pattern);
+  pthread_mutex_unlock(&g_patterns.mutex);
+
+  return pattern;
+}
+
+//---------------------------------------------------------
+cairo_pattern_t* pattern_cache_color(color_rgba_t color)
+{
+  pattern_key_t key;
+  memset(&key, 0, sizeof(pattern_key_t));
+  key.kind = PATTERN_COLOR;
+  key.colors[0] = color;
+  return lookup(&key);
+}
+
+//---------------------------------------------------------
+cairo_pattern_t* pattern_cache_linear(coordinates_t start, coordinates_t end,
+                                      color_rgba_t color_start, color_rgba_t color_end)
+{
+  pattern_key_t key;
+  memset(&key, 0, sizeof(pattern_key_t));
+  key.kind = PATTERN_LINEAR;
+  key.params[0] = start.x;
+  key.params[1] = start.y;
+  key.params[2] = end.x;
+  key.params[3] = end.y;
+  key.colors[0] = color_start;
+  key.colors[1] = color_end;
+  return lookup(&key);
+}
+
+//---------------------------------------------------------
+cairo_pattern_t* pattern_cache_radial(coordinates_t center,
+                                      float inner_radius, float outer_radius,
+                                      color_rgba_t color_start, color_rgba_t color_end)
+{
+  pattern_key_t key;
+  memset(&key, 0, sizeof(pattern_key_t));
+  key.kind = PATTERN_RADIAL;
+  key.params[0] = center.x;
+  key.params[1] = center.y;
+  key.params[2] = inner_radius;
+  key.params[3] = outer_radius;
+  key.colors[0] = color_start;
+  key.colors[1] = color_end;
+  return lookup(&key);
+}
+
+//---------------------------------------------------------
+// Called once the frame is drawn, while no render threads are running
+void pattern_cache_end_frame()
+{
+  pthread_mutex_lock(&g_patterns.mutex);
+  g_patterns.frame++;
+  g_patterns.f_full = false;
+  evict(g_patterns.frame - PATTERN_CACHE_FRAMES);
+  pthread_mutex_unlock(&g_patterns.mutex);
+}
+
+//---------------------------------------------------------
+void pattern_cache_clear()
+{
+  pthread_mutex_lock(&g_patterns.mutex);
+  for (uint32_t i = 0; i < PATTERN_CACHE_SLOTS; i++) {
+    cairo_pattern_destroy(g_patterns.entries[i].pattern);
+  }
+  memset(g_patterns.entries, 0, sizeof(g_patterns.entries));
+  g_patterns.count = 0;
+  pthread_mutex_unlock(&g_patterns.mutex);
+}
@@ -14,13 +14,16 @@ extern device_opts_t g_opts;
 
 static const char* log_prefix = "cairo";
 
+// Both take over the caller's reference to the pattern
 void set_fill_pattern(scenic_cairo_ctx_t* p_ctx, cairo_pattern_t* pattern)
 {
+  cairo_pattern_destroy(p_ctx->pattern.fill);
   p_ctx->pattern.fill = pattern;
 }
 
 void set_stroke_pattern(scenic_cairo_ctx_t* p_ctx, cairo_pattern_t* pattern)
 {
+  cairo_pattern_destroy(p_ctx->pattern.stroke);
   p_ctx->pattern.stroke = pattern;
 }
 
@@ -597,8 +600,9 @@ void script_ops_push_state(void* v_ctx)
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  pattern_stack_push(p_ctx);
-  cairo_save(p_ctx->cr);
+  if (pattern_stack_push(p_ctx)) {
+    cairo_save(p_ctx->cr);
+  }
 }
 
 void script_ops_pop_state(void* v_ctx)
@@ -609,8 +613,10 @@ void script_ops_pop_state(void* v_ctx)
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_restore(p_ctx->cr);
-  pattern_stack_pop(p_ctx);
+  // an unmatched pop mustn't restore the save the frame was started with
+  if (pattern_stack_pop(p_ctx)) {
+    cairo_restore(p_ctx->cr);
+  }
 }
 
 void script_ops_scissor(void* v_ctx,
@@ -692,11 +698,7 @@ void script_ops_fill_color(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* color_rgba = cairo_pattern_create_rgba(color.red / 255.0f,
-                                                          color.green / 255.0f,
-                                                          color.blue / 255.0f,
-                                                          color.alpha / 255.0f);
-  set_fill_pattern(p_ctx, color_rgba);
+  set_fill_pattern(p_ctx, pattern_cache_color(color));
 }
 
 void script_ops_fill_linear(void* v_ctx,
@@ -710,19 +712,7 @@ void script_ops_fill_linear(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* linear_gradient = cairo_pattern_create_linear(start.x, start.y,
-                                                                 end.x, end.y);
-  cairo_pattern_add_color_stop_rgba(linear_gradient, 0.0,
-                                    color_start.red / 255.0f,
-                                    color_start.green / 255.0f,
-                                    color_start.blue / 255.0f,
-                                    color_start.alpha / 255.0f);
-  cairo_pattern_add_color_stop_rgba(linear_gradient, 1.0,
-                                    color_end.red / 255.0f,
-                                    color_end.green / 255.0f,
-                                    color_end.blue / 255.0f,
-                                    color_end.alpha / 255.0f);
-  set_fill_pattern(p_ctx, linear_gradient);
+  set_fill_pattern(p_ctx, pattern_cache_linear(start, end, color_start, color_end));
 }
 
 void script_ops_fill_radial(void* v_ctx,
@@ -739,21 +729,8 @@ void script_ops_fill_radial(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* radial_gradient = cairo_pattern_create_radial(center.x, center.y,
-                                                                 inner_radius,
-                                                                 center.x, center.y,
-                                                                 outer_radius);
-  cairo_pattern_add_color_stop_rgba(radial_gradient, 0.0,
-                                    color_start.red / 255.0f,
-                                    color_start.green / 255.0f,
-                                    color_start.blue / 255.0f,
-                                    color_start.alpha / 255.0f);
-  cairo_pattern_add_color_stop_rgba(radial_gradient, 1.0,
-                                    color_end.red / 255.0f,
-                                    color_end.green / 255.0f,
-                                    color_end.blue / 255.0f,
-                                    color_end.alpha / 255.0f);
-  set_fill_pattern(p_ctx, radial_gradient);
+  set_fill_pattern(p_ctx, pattern_cache_radial(center, inner_radius, outer_radius,
+                                               color_start, color_end));
 }
 
 void script_ops_fill_image(void* v_ctx, sid_t id)
@@ -772,7 +749,7 @@ void script_ops_fill_image(void* v_ctx, sid_t id)
   image_pattern_data_t* image_data = find_image_pattern(p_ctx, p_image->image_id);
 
   cairo_set_antialias(p_ctx->cr, CAIRO_ANTIALIAS_NONE);
-  set_fill_pattern(p_ctx, image_data->pattern);
+  set_fill_pattern(p_ctx, cairo_pattern_reference(image_data->pattern));
 }
 
 void script_ops_fill_stream(void* v_ctx,
@@ -809,11 +786,7 @@ void script_ops_stroke_color(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* color_rgba = cairo_pattern_create_rgba(color.red / 255.0f,
-                                                          color.green / 255.0f,
-                                                          color.blue / 255.0f,
-                                                          color.alpha / 255.0f);
-  set_stroke_pattern(p_ctx, color_rgba);
+  set_stroke_pattern(p_ctx, pattern_cache_color(color));
 }
 
 void script_ops_stroke_linear(void* v_ctx,
@@ -827,19 +800,7 @@ void script_ops_stroke_linear(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* linear_gradient = cairo_pattern_create_linear(start.x, start.y,
-                                                                 end.x, end.y);
-  cairo_pattern_add_color_stop_rgba(linear_gradient, 0.0,
-                                    color_start.red / 255.0f,
-                                    color_start.green / 255.0f,
-                                    color_start.blue / 255.0f,
-                                    color_start.alpha / 255.0f);
-  cairo_pattern_add_color_stop_rgba(linear_gradient, 1.0,
-                                    color_end.red / 255.0f,
-                                    color_end.green / 255.0f,
-                                    color_end.blue / 255.0f,
-                                    color_end.alpha / 255.0f);
-  set_stroke_pattern(p_ctx, linear_gradient);
+  set_stroke_pattern(p_ctx, pattern_cache_linear(start, end, color_start, color_end));
 }
 
 void script_ops_stroke_radial(void* v_ctx,
@@ -856,21 +817,8 @@ void script_ops_stroke_radial(void* v_ctx,
 
   scenic_cairo_ctx_t* p_ctx = (scenic_cairo_ctx_t*)v_ctx;
 
-  cairo_pattern_t* radial_gradient = cairo_pattern_create_radial(center.x, center.y,
-                                                                 inner_radius,
-                                                                 center.x, center.y,
-                                                                 outer_radius);
-  cairo_pattern_add_color_stop_rgba(radial_gradient, 0.0,
-                                    color_start.red / 255.0f,
-                                    color_start.green / 255.0f,
-                                    color_start.blue / 255.0f,
-                                    color_start.alpha / 255.0f);
-  cairo_pattern_add_color_stop_rgba(radial_gradient, 1.0,
-                                    color_end.red / 255.0f,
-                                    color_end.green / 255.0f,
-                                    color_end.blue / 255.0f,
-                                    color_end.alpha / 255.0f);
-  set_stroke_pattern(p_ctx, radial_gradient);
+  set_stroke_pattern(p_ctx, pattern_cache_radial(center, inner_radius, outer_radius,
+                                                 color_start, color_end));
 }
 
 void script_ops_stroke_image(void* v_ctx, sid_t id)
@@ -889,7 +837,7 @@ void script_ops_stroke_image(void* v_ctx, sid_t id)
   image_pattern_data_t* image_data = find_image_pattern(p_ctx, p_image->image_id);
 
   cairo_set_antialias(p_ctx->cr, CAIRO_ANTIALIAS_NONE);
-  set_stroke_pattern(p_ctx, image_data->pattern);
+  set_stroke_pattern(p_ctx, cairo_pattern_reference(image_data->pattern));
 }
 
 void script_ops_stroke_stream(void* v_ctx,
@@ -0,0 +1,107 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Tables that hand out ids for the images and fonts the cairo backend
+// holds, and find them again in constant time.
+//
+// An id is the index of its slot plus one in the low bits, and the slot's
+// generation in the bits above. Freed slots go on a free list and their
+// generation is bumped, so an id that outlived its item doesn't find
+// whatever was put in the slot next. Ids are never 0 or negative, which
+// leaves those for the callers' errors.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cairo_ctx.h"
+
+#define SLOT_BITS 20
+#define SLOT_MASK ((1 << SLOT_BITS) - 1)
+#define SLOT_MAX (SLOT_MASK - 1)
+#define GENERATION_MASK (INT32_MAX >> SLOT_BITS)
+
+//---------------------------------------------------------
+void slot_table_init(slot_table_t* p_table, size_t item_size)
+{
+  memset(p_table, 0, sizeof(slot_table_t));
+  p_table->item_size = item_size;
+  p_table->free_head = -1;
+}
+
+//---------------------------------------------------------
+void slot_table_fini(slot_table_t* p_table)
+{
+  free(p_table->slots);
+  free(p_table->items);
+  slot_table_init(p_table, p_table->item_size);
+}
+
+//---------------------------------------------------------
+// Returns the new item, zeroed, and its id in *p_id. Returns NULL when
+// the table can't grow. Items may move when the table grows, so pointers
+// to them are only good until the next alloc
+void* slot_table_alloc(slot_table_t* p_table, int* p_id)
+{
+  int index = p_table->free_head;
+
+  if (index >= 0) {
+    p_table->free_head = p_table->slots[index].next_free;
+  } else {
+    if (p_table->used >= SLOT_MAX) {
+      return NULL;
+    }
+    if (p_table->used >= p_table->count) {
+      int count = p_table->count ? p_table->count * 2 : 16;
+      slot_t* slots = (slot_t*)realloc(p_table->slots, sizeof(slot_t) * count);
+      if (!slots) return NULL;
+      p_table->slots = slots;
+      uint8_t* items = (uint8_t*)realloc(p_table->items, p_table->item_size * count);
+      if (!items) return NULL;
+      p_table->items = items;
+      p_table->count = count;
+    }
+    index = p_table->used++;
+    p_table->slots[index].generation = 0;
+  }
+
+  slot_t* p_slot = &p_table->slots[index];
+  p_slot->id = (p_slot->generation << SLOT_BITS) | (index + 1);
+  p_slot->next_free = -1;
+
+  void* p_item = p_table->items + index * p_table->item_size;
+  memset(p_item, 0, p_table->item_size);
+
+  *p_id = p_slot->id;
+  return p_item;
+}
+
+//---------------------------------------------------------
+void* slot_table_find(const slot_table_t* p_table, int id)
+{
+  int index = (id & SLOT_MASK) - 1;
+  if ((id <= 0) || (index < 0) || (index >= p_table->used)
+      || (p_table->slots[index].id != id)) {
+    return NULL;
+  }
+  return p_table->items + index * p_table->item_size;
+}
+
+//---------------------------------------------------------
+bool slot_table_free(slot_table_t* p_table, int id)
+{
+  if (!slot_table_find(p_table, id)) {
+    return false;
+  }
+
+  int index = (id & SLOT_MASK) - 1;
+  slot_t* p_slot = &p_table->slots[index];
+  p_slot->id = 0;
+  p_slot->generation = (p_slot->generation + 1) & GENERATION_MASK;
+  p_slot->next_free = p_table->free_head;
+  p_table->free_head = index;
+
+  return true;
+}
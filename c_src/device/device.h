@@ -16,6 +16,11 @@ void device_poll();
 void device_loop(driver_data_t* p_data);
 void device_begin_render(driver_data_t* p_data);
 void device_begin_cursor_render(driver_data_t* p_data);
+// draws the frame between begin and end render. The default just calls
+// render_scene
+void device_render_scene(driver_data_t* p_data, bbox_t view);
 void device_end_render(driver_data_t* p_data);
 void device_clear_color(float red, float green, float blue, float alpha);
+// writes the last frame drawn to path. The default says the device can't
+void device_dump_frame(const char* path);
 char* device_gl_error();
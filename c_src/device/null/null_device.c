@@ -0,0 +1,136 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// A device that draws nothing. Every message is still read, every script
+// compiled and walked, and every image decoded, so with scenic_replay it
+// times the driver's own work apart from any drawing library, and it
+// builds anywhere: SCENIC_LOCAL_TARGET=null.
+//
+// Images and fonts are given ids but not kept, and layers are never made,
+// so layer_cache has no effect here.
+
+#include "comms.h"
+#include "device.h"
+#include "font_ops.h"
+#include "image_ops.h"
+#include "layer_ops.h"
+#include "scenic_ops.h"
+
+extern device_opts_t g_opts;
+
+// any non-NULL context will do
+static int null_ctx = 0;
+
+int device_init(const device_opts_t* p_opts,
+                device_info_t* p_info,
+                driver_data_t* p_data)
+{
+  if (g_opts.debug_mode) {
+    log_info("null %s", __func__);
+  }
+
+  p_info->width = p_opts->width;
+  p_info->height = p_opts->height;
+  p_info->v_ctx = &null_ctx;
+  p_info->f_partial_render = true;
+
+  return 0;
+}
+
+int device_close(device_info_t* p_info)
+{
+  if (g_opts.debug_mode) {
+    log_info("null %s", __func__);
+  }
+  return 0;
+}
+
+void device_poll()
+{
+}
+
+void device_loop(driver_data_t* p_data)
+{
+  scenic_loop(p_data);
+}
+
+void device_begin_render(driver_data_t* p_data)
+{
+}
+
+void device_begin_cursor_render(driver_data_t* p_data)
+{
+}
+
+void device_end_render(driver_data_t* p_data)
+{
+}
+
+void device_clear_color(float red, float green, float blue, float alpha)
+{
+}
+
+char* device_gl_error()
+{
+  return NULL;
+}
+
+//---------------------------------------------------------
+int32_t image_ops_create(void* v_ctx, uint32_t width, uint32_t height, void* p_pixels)
+{
+  static int32_t next_id = 0;
+  return ++next_id;
+}
+
+void image_ops_update(void* v_ctx, int32_t image_id, void* p_pixels)
+{
+}
+
+void image_ops_update_region(void* v_ctx, int32_t image_id,
+                             uint32_t x, uint32_t y,
+                             uint32_t width, uint32_t height,
+                             void* p_pixels)
+{
+}
+
+void image_ops_delete(void* v_ctx, int32_t image_id)
+{
+}
+
+//---------------------------------------------------------
+int32_t font_ops_create(void* v_ctx, font_t* p_font, uint32_t size)
+{
+  static int32_t next_id = 0;
+  return ++next_id;
+}
+
+//---------------------------------------------------------
+void* layer_ops_create(void* v_ctx, uint32_t width, uint32_t height)
+{
+  return NULL;
+}
+
+void layer_ops_delete(void* v_ctx, void* v_layer)
+{
+}
+
+void* layer_ops_begin(void* v_ctx, void* v_layer)
+{
+  return NULL;
+}
+
+void layer_ops_end(void* v_ctx, void* v_layer, void* v_layer_ctx)
+{
+}
+
+void layer_ops_draw(void* v_ctx, void* v_layer, float x, float y, float w, float h)
+{
+}
+
+float layer_ops_scale(void* v_ctx)
+{
+  return 1.0f;
+}
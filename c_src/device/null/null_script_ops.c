@@ -0,0 +1,198 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// The null device draws nothing, so each script op does nothing. They
+// are defined rather than left to the defaults, which log every call.
+
+#include "script_ops.h"
+
+void script_ops_draw_line(void* v_ctx, coordinates_t a, coordinates_t b, bool stroke)
+{
+}
+
+void script_ops_draw_triangle(void* v_ctx, coordinates_t a, coordinates_t b, coordinates_t c, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_quad(void* v_ctx, coordinates_t a, coordinates_t b, coordinates_t c, coordinates_t d, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_rect(void* v_ctx, float w, float h, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_rrect(void* v_ctx, float w, float h, float radius, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_rrectv(void* v_ctx, float w, float h, float ulr, float urr, float lrr, float llr, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_arc(void* v_ctx, float radius, float radians, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_sector(void* v_ctx, float radius, float radians, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_circle(void* v_ctx, float radius, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_ellipse(void* v_ctx, float radius0, float radius1, bool fill, bool stroke)
+{
+}
+
+void script_ops_draw_text(void* v_ctx, uint32_t size, const char* text)
+{
+}
+
+void script_ops_draw_sprites(void* v_ctx, sid_t id, uint32_t count, const sprite_t* sprites)
+{
+}
+
+void script_ops_begin_path(void* v_ctx)
+{
+}
+
+void script_ops_close_path(void* v_ctx)
+{
+}
+
+void script_ops_fill_path(void* v_ctx)
+{
+}
+
+void script_ops_stroke_path(void* v_ctx)
+{
+}
+
+void script_ops_move_to(void* v_ctx, coordinates_t a)
+{
+}
+
+void script_ops_line_to(void* v_ctx, coordinates_t a)
+{
+}
+
+void script_ops_arc_to(void* v_ctx, coordinates_t a, coordinates_t b, float radius)
+{
+}
+
+void script_ops_bezier_to(void* v_ctx, coordinates_t c0, coordinates_t c1, coordinates_t a)
+{
+}
+
+void script_ops_quadratic_to(void* v_ctx, coordinates_t c, coordinates_t a)
+{
+}
+
+void script_ops_arc(void* v_ctx, coordinates_t c, float radius, float a0, float a1, sweep_dir_t sweep_dir)
+{
+}
+
+void script_ops_push_state(void* v_ctx)
+{
+}
+
+void script_ops_pop_state(void* v_ctx)
+{
+}
+
+void script_ops_scissor(void* v_ctx, float w, float h)
+{
+}
+
+void script_ops_transform(void* v_ctx, float a, float b, float c, float d, float e, float f)
+{
+}
+
+void script_ops_scale(void* v_ctx, float x, float y)
+{
+}
+
+void script_ops_rotate(void* v_ctx, float radians)
+{
+}
+
+void script_ops_translate(void* v_ctx, float x, float y)
+{
+}
+
+void script_ops_fill_color(void* v_ctx, color_rgba_t color)
+{
+}
+
+void script_ops_fill_linear(void* v_ctx, coordinates_t start, coordinates_t end, color_rgba_t color_start, color_rgba_t color_end)
+{
+}
+
+void script_ops_fill_radial(void* v_ctx, coordinates_t center, float inner_radius, float outer_radius, color_rgba_t color_start, color_rgba_t color_end)
+{
+}
+
+void script_ops_fill_image(void* v_ctx, sid_t id)
+{
+}
+
+void script_ops_fill_stream(void* v_ctx, sid_t id)
+{
+}
+
+void script_ops_stroke_width(void* v_ctx, float w)
+{
+}
+
+void script_ops_stroke_color(void* v_ctx, color_rgba_t color)
+{
+}
+
+void script_ops_stroke_linear(void* v_ctx, coordinates_t start, coordinates_t end, color_rgba_t color_start, color_rgba_t color_end)
+{
+}
+
+void script_ops_stroke_radial(void* v_ctx, coordinates_t center, float inner_radius, float outer_radius, color_rgba_t color_start, color_rgba_t color_end)
+{
+}
+
+void script_ops_stroke_image(void* v_ctx, sid_t id)
+{
+}
+
+void script_ops_stroke_stream(void* v_ctx, sid_t id)
+{
+}
+
+void script_ops_line_cap(void* v_ctx, line_cap_t type)
+{
+}
+
+void script_ops_line_join(void* v_ctx, line_join_t type)
+{
+}
+
+void script_ops_miter_limit(void* v_ctx, uint32_t limit)
+{
+}
+
+void script_ops_font(void* v_ctx, sid_t id)
+{
+}
+
+void script_ops_font_size(void* v_ctx, float size)
+{
+}
+
+void script_ops_text_align(void* v_ctx, text_align_t type)
+{
+}
+
+void script_ops_text_base(void* v_ctx, text_base_t type)
+{
+}
@@ -23,10 +23,12 @@
 #define NANOVG_GLES2_IMPLEMENTATION
 #include "nanovg/nanovg.h"
 #include "nanovg/nanovg_gl.h"
+#include "nanovg/nanovg_gl_utils.h"
 
 #include "scenic_types.h"
 #include "comms.h"
 #include "device.h"
+#include "trace.h"
 
 #define DEFAULT_SCREEN    0
 
@@ -283,7 +285,9 @@ void device_end_render(driver_data_t* p_data)
   //log_info("nvgEndFrame: %" PRId64, monotonic_time() - time);
 
   //time = monotonic_time();
+  int64_t trace_start = trace_begin();
   eglSwapBuffers(g_egl_data.display, g_egl_data.surface);
+  trace_end(trace_start, trace_present, 0, NULL, 0);
   //log_info("device_end_render: %" PRId64, monotonic_time() - time);
 }
 
@@ -26,10 +26,12 @@
 #include <EGL/egl.h>
 #include "nanovg/nanovg.h"
 #include "nanovg/nanovg_gl.h"
+#include "nanovg/nanovg_gl_utils.h"
 
 #include "scenic_types.h"
 #include "comms.h"
 #include "device.h"
+#include "trace.h"
 
 #define DEFAULT_SCREEN    0
 
@@ -657,7 +659,9 @@ void device_end_render(driver_data_t* p_data)
     next_idx = g_egl_data.frame_idx + 1;
   }
 
+  int64_t trace_start = trace_begin();
   eglSwapBuffers(g_egl_data.display, g_egl_data.surface);
+  trace_end(trace_start, trace_present, 0, NULL, 0);
 
   gbm.bo[next_idx] = gbm_surface_lock_front_buffer(gbm.surface);
   drm.fb[next_idx] = drm_fb_get_from_bo(gbm.bo[next_idx]);
@@ -676,6 +680,7 @@ void device_end_render(driver_data_t* p_data)
   }
 
   
+  trace_start = trace_begin();
   waiting_for_flip = 1;
   while (waiting_for_flip) {
     ret = select(drm.fd + 1, &fds, NULL, NULL, NULL);
@@ -690,6 +695,7 @@ void device_end_render(driver_data_t* p_data)
     }
     drmHandleEvent(drm.fd, &evctx);
   }
+  trace_end(trace_start, trace_present, 0, NULL, 0);
 
   if (gbm.bo[g_egl_data.frame_idx]) {
     gbm_surface_release_buffer(gbm.surface, gbm.bo[g_egl_data.frame_idx]);
@@ -20,11 +20,13 @@
 #define NANOVG_GL2_IMPLEMENTATION
 #include "nanovg/nanovg.h"
 #include "nanovg/nanovg_gl.h"
+#include "nanovg/nanovg_gl_utils.h"
 
 #include "scenic_types.h"
 #include "utils.h"
 #include "comms.h"
 #include "device.h"
+#include "trace.h"
 
 #define STDIN_FILENO 0
 
@@ -89,6 +91,8 @@ void reshape_window(GLFWwindow* window, int w, int h)
   g_glfw_data.p_info->height = h;
   g_glfw_data.p_info->ratio = g_glfw_data.ratio_x;
 
+  // the framebuffer was just cleared, so the next frame must repaint
+  invalidate_frame();
   send_reshape(w, h);
 }
 
@@ -359,7 +363,9 @@ void device_end_render(driver_data_t* p_data)
   //log_info("nvgEndFrame: %" PRId64, monotonic_time() - time);
 
   //time = monotonic_time();
+  int64_t trace_start = trace_begin();
   glfwSwapBuffers(g_glfw_data.p_window);
+  trace_end(trace_start, trace_present, 0, NULL, 0);
   //log_info("device_end_render: %" PRId64, monotonic_time() - time);
 }
 
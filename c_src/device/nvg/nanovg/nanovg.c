@@ -419,6 +419,26 @@ void nvgEndFrame(NVGcontext* ctx)
 	}
 }
 
+int nvgBeginLayer(NVGcontext* ctx, float layerWidth, float layerHeight)
+{
+	if (ctx->nstates >= NVG_MAX_STATES)
+		return 0;
+	ctx->params.renderFlush(ctx->params.userPtr);
+	nvgSave(ctx);
+	nvgReset(ctx);
+	nvg__setDevicePixelRatio(ctx, 1.0f);
+	ctx->params.renderViewport(ctx->params.userPtr, layerWidth, layerHeight, 1.0f);
+	return 1;
+}
+
+void nvgEndLayer(NVGcontext* ctx, float windowWidth, float windowHeight, float devicePixelRatio)
+{
+	ctx->params.renderFlush(ctx->params.userPtr);
+	nvgRestore(ctx);
+	nvg__setDevicePixelRatio(ctx, devicePixelRatio);
+	ctx->params.renderViewport(ctx->params.userPtr, windowWidth, windowHeight, devicePixelRatio);
+}
+
 NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b)
 {
 	return nvgRGBA(r,g,b,255);
@@ -2470,6 +2490,57 @@ static int nvg__isTransformFlipped(const float *xform)
 	return( det < 0);
 }
 
+void nvgImageRects(NVGcontext* ctx, int image, float alpha, const float* rects, int stride, int count)
+{
+	NVGstate* state = nvg__getState(ctx);
+	int isFlipped = nvg__isTransformFlipped(state->xform);
+	NVGvertex* verts;
+	NVGpaint paint;
+	float c[8];
+	int i, w = 0, h = 0, nverts = 0;
+
+	if (count <= 0) return;
+	ctx->params.renderGetTextureSize(ctx->params.userPtr, image, &w, &h);
+	if (w <= 0 || h <= 0) return;
+
+	verts = nvg__allocTempVerts(ctx, count*6);
+	if (verts == NULL) return;
+
+	for (i = 0; i < count; i++, rects += stride) {
+		float s0 = rects[0] / w, t0 = rects[1] / h;
+		float s1 = (rects[0] + rects[2]) / w, t1 = (rects[1] + rects[3]) / h;
+		float x0 = rects[4], y0 = rects[5];
+		float x1 = rects[4] + rects[6], y1 = rects[5] + rects[7];
+		if (isFlipped) {
+			float tmp;
+			tmp = y0; y0 = y1; y1 = tmp;
+			tmp = t0; t0 = t1; t1 = tmp;
+		}
+		// Transform corners, then two triangles wound the same way as text.
+		nvgTransformPoint(&c[0],&c[1], state->xform, x0, y0);
+		nvgTransformPoint(&c[2],&c[3], state->xform, x1, y0);
+		nvgTransformPoint(&c[4],&c[5], state->xform, x1, y1);
+		nvgTransformPoint(&c[6],&c[7], state->xform, x0, y1);
+		nvg__vset(&verts[nverts], c[0], c[1], s0, t0); nverts++;
+		nvg__vset(&verts[nverts], c[4], c[5], s1, t1); nverts++;
+		nvg__vset(&verts[nverts], c[2], c[3], s1, t0); nverts++;
+		nvg__vset(&verts[nverts], c[0], c[1], s0, t0); nverts++;
+		nvg__vset(&verts[nverts], c[6], c[7], s0, t1); nverts++;
+		nvg__vset(&verts[nverts], c[4], c[5], s1, t1); nverts++;
+	}
+
+	paint = nvgImagePattern(ctx, 0, 0, (float)w, (float)h, 0, image, alpha);
+
+	// Apply global alpha
+	paint.innerColor.a *= state->alpha;
+	paint.outerColor.a *= state->alpha;
+
+	ctx->params.renderTriangles(ctx->params.userPtr, &paint, state->compositeOperation, &state->scissor, verts, nverts, ctx->fringeWidth);
+
+	ctx->drawCallCount++;
+	ctx->fillTriCount += nverts/3;
+}
+
 float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
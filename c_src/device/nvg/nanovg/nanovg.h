@@ -164,6 +164,18 @@ void nvgCancelFrame(NVGcontext* ctx);
 // Ends drawing flushing remaining render state.
 void nvgEndFrame(NVGcontext* ctx);
 
+// Switches drawing to another render target part way through a frame, such as
+// a framebuffer object, which the caller binds after this returns.
+// Everything drawn so far is flushed to the current target first. A fresh state
+// is pushed on the state stack, sized for a target of layerWidth x layerHeight
+// pixels. Returns 0, and changes nothing, if the state stack is full.
+int nvgBeginLayer(NVGcontext* ctx, float layerWidth, float layerHeight);
+
+// Flushes what was drawn to the layer and pops back to the frame's state. The
+// window size and pixel ratio are the ones the frame was begun with. The caller
+// binds the frame's target again after this returns.
+void nvgEndLayer(NVGcontext* ctx, float windowWidth, float windowHeight, float devicePixelRatio);
+
 //
 // Composite operation
 //
@@ -392,6 +404,14 @@ void nvgImageSize(NVGcontext* ctx, int image, int* w, int* h);
 // Deletes created image.
 void nvgDeleteImage(NVGcontext* ctx, int image);
 
+// Draws count rectangles cut from an image as one batch of textured triangles,
+// which the back-end renders with a single draw call.
+// Each rectangle is read from rects as 8 floats: the source x, y, w, h in image
+// pixels followed by the destination x, y, w, h. Consecutive rectangles start
+// stride floats apart. The current transform, scissor and global alpha apply,
+// edges are not anti-aliased and the current path is left untouched.
+void nvgImageRects(NVGcontext* ctx, int image, float alpha, const float* rects, int stride, int count);
+
 //
 // Paints
 //
@@ -16,6 +16,19 @@ void image_ops_update(void* v_ctx, int32_t image_id, void* p_pixels)
   nvgUpdateImage(p_ctx, image_id, p_pixels);
 }
 
+void image_ops_update_region(void* v_ctx, int32_t image_id,
+                             uint32_t x, uint32_t y,
+                             uint32_t width, uint32_t height,
+                             void* p_pixels)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+  NVGparams* p_params = nvgInternalParams(p_ctx);
+  // nvgUpdateImage always uploads the whole texture. The backend can take
+  // a region, which it reads out of the full size pixels
+  p_params->renderUpdateTexture(p_params->userPtr, image_id,
+                                x, y, width, height, p_pixels);
+}
+
 void image_ops_delete(void* v_ctx, int32_t image_id)
 {
   NVGcontext* p_ctx = (NVGcontext*)v_ctx;
@@ -0,0 +1,130 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Layers are nanovg framebuffer objects. nanovg only draws to one target
+// per frame, so drawing a layer flushes what the frame has so far, draws
+// the layer on a fresh state and then carries on with the frame. Where
+// the GL can't make framebuffers, nvgluCreateFramebuffer returns NULL and
+// there are no layers.
+
+#include <stddef.h>
+
+#ifdef SCENIC_GLES2
+  #include <GLES2/gl2.h>
+#else
+  #ifdef __APPLE__
+    #include <OpenGL/gl3.h>
+  #else
+    #include <GLES3/gl3.h>
+  #endif
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "comms.h"
+#include "layer_ops.h"
+#include "nanovg/nanovg.h"
+#include "nanovg/nanovg_gl_utils.h"
+
+extern device_info_t g_device_info;
+
+typedef struct {
+  NVGLUframebuffer* p_fb;
+  int width;
+  int height;
+  // the frame's viewport and clear color, put back when the layer is done
+  GLint viewport[4];
+  GLfloat clear_color[4];
+} nvg_layer_t;
+
+//---------------------------------------------------------
+void* layer_ops_create(void* v_ctx, uint32_t width, uint32_t height)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+
+  nvg_layer_t* p_layer = calloc(1, sizeof(nvg_layer_t));
+  if (!p_layer) {
+    return NULL;
+  }
+
+  p_layer->p_fb = nvgluCreateFramebuffer(p_ctx, width, height, 0);
+  if (!p_layer->p_fb) {
+    free(p_layer);
+    return NULL;
+  }
+  p_layer->width = width;
+  p_layer->height = height;
+
+  return p_layer;
+}
+
+//---------------------------------------------------------
+void layer_ops_delete(void* v_ctx, void* v_layer)
+{
+  nvg_layer_t* p_layer = (nvg_layer_t*)v_layer;
+  nvgluDeleteFramebuffer(p_layer->p_fb);
+  free(p_layer);
+}
+
+//---------------------------------------------------------
+void* layer_ops_begin(void* v_ctx, void* v_layer)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+  nvg_layer_t* p_layer = (nvg_layer_t*)v_layer;
+
+  if (!nvgBeginLayer(p_ctx, p_layer->width, p_layer->height)) {
+    return NULL;
+  }
+
+  glGetIntegerv(GL_VIEWPORT, p_layer->viewport);
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, p_layer->clear_color);
+
+  nvgluBindFramebuffer(p_layer->p_fb);
+  glViewport(0, 0, p_layer->width, p_layer->height);
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+  return p_ctx;
+}
+
+//---------------------------------------------------------
+void layer_ops_end(void* v_ctx, void* v_layer, void* v_layer_ctx)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+  nvg_layer_t* p_layer = (nvg_layer_t*)v_layer;
+
+  nvgEndLayer(p_ctx, g_device_info.width, g_device_info.height, g_device_info.ratio);
+
+  nvgluBindFramebuffer(NULL);
+  glViewport(p_layer->viewport[0], p_layer->viewport[1],
+             p_layer->viewport[2], p_layer->viewport[3]);
+  glClearColor(p_layer->clear_color[0], p_layer->clear_color[1],
+               p_layer->clear_color[2], p_layer->clear_color[3]);
+}
+
+//---------------------------------------------------------
+// drawn as a textured rectangle, which leaves the current path alone.
+// The framebuffer's rows run bottom up and textured triangles don't go
+// through the paint's NVG_IMAGE_FLIPY, so the source is read upside down
+void layer_ops_draw(void* v_ctx, void* v_layer, float x, float y, float w, float h)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+  nvg_layer_t* p_layer = (nvg_layer_t*)v_layer;
+
+  float rect[8] = {0, p_layer->height, p_layer->width, -p_layer->height, x, y, w, h};
+  nvgImageRects(p_ctx, p_layer->p_fb->image, 1.0f, rect, 8, 1);
+}
+
+//---------------------------------------------------------
+float layer_ops_scale(void* v_ctx)
+{
+  NVGcontext* p_ctx = (NVGcontext*)v_ctx;
+  float xform[6];
+  nvgCurrentTransform(p_ctx, xform);
+  return fmaxf(hypotf(xform[0], xform[1]), hypotf(xform[2], xform[3]))
+    * g_device_info.ratio;
+}
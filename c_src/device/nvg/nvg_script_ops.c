@@ -242,42 +242,6 @@ void script_ops_draw_text(void* v_ctx,
 
 //---------------------------------------------------------
 // see: https://github.com/memononen/nanovg/issues/348
-static void draw_image(NVGcontext* p_ctx,
-                       sid_t id,
-                       const sprite_t sprite)
-{
-  float ax, ay;
-  NVGpaint img_pattern;
-
-  // get the mapped image_id for this driver_id
-  image_t* p_image = get_image(id);
-  if (!p_image) return;
-
-  // get the dimensions of the image
-  int iw,ih;
-  nvgImageSize(p_ctx, p_image->image_id, &iw, &ih);
-
-  // Aspect ratio of pixel in x and y dimensions. This allows us to scale
-  // the sprite to fill the whole rectangle.
-  ax = sprite.dw / sprite.sw;
-  ay = sprite.dh / sprite.sh;
-
-  // create the temporary pattern
-  img_pattern = nvgImagePattern(p_ctx,
-                                sprite.dx - sprite.sx*ax, sprite.dy - sprite.sy*ay,
-                                (float)iw*ax, (float)ih*ay,
-                                0, p_image->image_id, sprite.alpha);
-
-  // draw the image into a rect
-  nvgBeginPath(p_ctx);
-  nvgRect(p_ctx, sprite.dx, sprite.dy, sprite.dw, sprite.dh);
-  nvgFillPaint(p_ctx, img_pattern);
-  nvgFill(p_ctx);
-
-  // the data for the paint pattern is a struct on the stack.
-  // no need to clean it up
-}
-
 void script_ops_draw_sprites(void* v_ctx,
                              sid_t id,
                              uint32_t count,
@@ -289,8 +253,21 @@ void script_ops_draw_sprites(void* v_ctx,
   }
 
   NVGcontext* p_ctx = (NVGcontext*)v_ctx;
-  for (int i = 0; i < count; i++) {
-    draw_image(p_ctx, id, sprites[i]);
+
+  // get the mapped image_id for this driver_id, once for all the sprites
+  image_t* p_image = get_image(id);
+  if (!p_image) return;
+
+  // Runs of sprites with the same alpha are drawn as one batch of
+  // triangles. sprite_t starts with the 8 floats nvgImageRects reads
+  uint32_t start = 0;
+  for (uint32_t i = 1; i <= count; i++) {
+    if ((i == count) || (sprites[i].alpha != sprites[start].alpha)) {
+      nvgImageRects(p_ctx, p_image->image_id, sprites[start].alpha,
+                    &sprites[start].sx, sizeof(sprite_t) / sizeof(float),
+                    i - start);
+      start = i;
+    }
   }
 }
 
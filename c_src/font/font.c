@@ -9,6 +9,7 @@
 #include "common.h"
 #include "comms.h"
 #include "font.h"
+#include "ids.h"
 #include "scenic_types.h"
 #include "utils.h"
 
@@ -45,6 +46,10 @@ static int _comparator(const void* p_arg, const void* p_obj)
 //---------------------------------------------------------
 font_t* get_font(sid_t id)
 {
+  // interned ids resolve straight through their handle
+  if (id.handle) {
+    return get_id_slot(id, ID_SLOT_FONT);
+  }
   return tommy_hashlin_search(&fonts,
                               _comparator,
                               &id,
@@ -79,7 +84,7 @@ void put_font(uint32_t* p_msg_length, void* v_ctx)
   read_bytes_down(p_font->id.p_data, id_length, p_msg_length);
 
   // read the data into the blob buffer
-  p_font->blob.size = id_length;
+  p_font->blob.size = blob_size;
   p_font->blob.p_data = ((void*)p_font) + struct_size + id_size;
   read_bytes_down(p_font->blob.p_data, blob_size, p_msg_length);
 
@@ -100,4 +105,24 @@ void put_font(uint32_t* p_msg_length, void* v_ctx)
 
   // insert the script into the tommy hash
   tommy_hashlin_insert(&fonts, &p_font->node, p_font, HASH_ID(p_font->id));
+
+  // fonts are never deleted, so the reference on the id is never released
+  p_font->id.handle = intern_id(p_font->id).handle;
+  set_id_slot(p_font->id, ID_SLOT_FONT, p_font);
+  mark_id_dirty(p_font->id);
+}
+
+//---------------------------------------------------------
+static void add_font_size(uint64_t* p_bytes, font_t* p_font)
+{
+  *p_bytes += ALIGN_UP(sizeof(font_t), 8) + ALIGN_UP(p_font->id.size + 1, 8)
+    + p_font->blob.size;
+}
+
+void font_stats(uint32_t* p_count, uint64_t* p_bytes)
+{
+  *p_count = tommy_hashlin_count(&fonts);
+  *p_bytes = 0;
+  tommy_hashlin_foreach_arg(&fonts,
+                            (tommy_foreach_arg_func*)add_font_size, p_bytes);
 }
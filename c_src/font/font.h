@@ -12,4 +12,5 @@
 void init_fonts(void);
 void put_font(uint32_t* p_msg_length, void* v_ctx);
 font_t* get_font(sid_t id);
+void font_stats(uint32_t* p_count, uint64_t* p_bytes);
 
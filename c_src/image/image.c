@@ -9,9 +9,13 @@
 
 #include "common.h"
 #include "comms.h"
+#include "ids.h"
 #include "image.h"
 #include "image_ops.h"
+#include "pixels.h"
 #include "scenic_types.h"
+#include "shm.h"
+#include "trace.h"
 #include "utils.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -45,29 +49,44 @@ static int _comparator(const void* p_arg, const void* p_obj)
 //---------------------------------------------------------
 image_t* get_image(sid_t id)
 {
+  // interned ids resolve straight through their handle
+  if (id.handle) {
+    return get_id_slot(id, ID_SLOT_IMAGE);
+  }
   return tommy_hashlin_search(&images,
                               _comparator,
                               &id,
                               HASH_ID(id));
 }
 
+//---------------------------------------------------------
+// everything but taking it out of the table
+static void release_image(void* v_ctx, image_t* p_image)
+{
+  set_id_slot(p_image->id, ID_SLOT_IMAGE, NULL);
+  mark_id_dirty(p_image->id);
+  release_id(p_image->id);
+  image_ops_delete(v_ctx, p_image->image_id);
+
+  free(p_image);
+}
+
 //---------------------------------------------------------
 void image_free(void* v_ctx, image_t* p_image)
 {
   if (p_image) {
     tommy_hashlin_remove_existing(&images, &p_image->node);
-    image_ops_delete(v_ctx, p_image->image_id);
-
-    free(p_image);
+    release_image(v_ctx, p_image);
   }
 }
 
 //---------------------------------------------------------
 void reset_images(void* v_ctx)
 {
-  // deallocates all the objects iterating the hashtable
+  // deallocates all the objects iterating the hashtable. They can't be
+  // removed from it while it is being iterated, but it is done with next
   tommy_hashlin_foreach_arg(&images,
-                            (tommy_foreach_arg_func*)image_free, v_ctx);
+                            (tommy_foreach_arg_func*)release_image, v_ctx);
 
   // deallocates the hashtable
   tommy_hashlin_done(&images);
@@ -77,30 +96,58 @@ void reset_images(void* v_ctx)
 }
 
 //---------------------------------------------------------
-int read_pixels(void* p_pixels,
-                uint32_t width, uint32_t height,
-                image_format_t format_in,
-                uint32_t* p_msg_length)
+// the pixels are held as rgba whatever format they came in
+static void add_image_size(uint64_t* p_bytes, image_t* p_image)
 {
-  // read incoming data into a temporary buffer
-  int buffer_size = *p_msg_length;
-  void* p_buffer = malloc(buffer_size);
-  if (!p_buffer) {
-    log_error("Unable to alloc temporary pixel buffer!!");
-    return -1;
+  *p_bytes += ALIGN_UP(sizeof(image_t), 8) + ALIGN_UP(p_image->id.size + 1, 8)
+    + p_image->width * p_image->height * 4;
+}
+
+void image_stats(uint32_t* p_count, uint64_t* p_bytes)
+{
+  *p_count = tommy_hashlin_count(&images);
+  *p_bytes = 0;
+  tommy_hashlin_foreach_arg(&images,
+                            (tommy_foreach_arg_func*)add_image_size, p_bytes);
+}
+
+//---------------------------------------------------------
+// bytes per pixel of the raw formats. Files are compressed
+static uint32_t format_bytes(image_format_t format)
+{
+  switch (format) {
+  case IMAGE_FORMAT_GRAY: return 1;
+  case IMAGE_FORMAT_GRAY_ALPHA: return 2;
+  case IMAGE_FORMAT_RGB: return 3;
+  case IMAGE_FORMAT_RGBA: return 4;
+  default: return 0;
   }
-  read_bytes_down(p_buffer, buffer_size, p_msg_length);
+}
 
+//---------------------------------------------------------
+// convert the incoming bytes into RGBA pixels
+static int convert_pixels(void* p_pixels,
+                          uint32_t width, uint32_t height,
+                          image_format_t format_in,
+                          const void* p_buffer, uint32_t buffer_size)
+{
   unsigned int pixel_count = width * height;
-  unsigned int src_i;
-  unsigned int dst_i;
   int x, y, comp;
   void* p_temp = NULL;
 
+  if (buffer_size < pixel_count * format_bytes(format_in)) {
+    log_error("Not enough pixel data for the image");
+    return -1;
+  }
+
   switch (format_in) {
   case IMAGE_FORMAT_FILE:
     p_temp = (void*)stbi_load_from_memory(p_buffer, buffer_size, &x, &y, &comp, 4);
-    if (p_temp && (x != width || y != height)) {
+    if (!p_temp) {
+      log_error("Unable to decode image");
+      return -1;
+    }
+    if (x != width || y != height) {
       send_puts("Image size mismatch!!");
       free(p_temp);
       return -1;
@@ -111,35 +158,15 @@ int read_pixels(void* p_pixels,
     break;
 
   case IMAGE_FORMAT_GRAY:
-    for (unsigned int i = 0; i < pixel_count; i++) {
-      dst_i = i * 4;
-      ((char*)p_pixels)[dst_i] = ((char*)p_buffer)[i];
-      ((char*)p_pixels)[dst_i + 1] = ((char*)p_buffer)[i];
-      ((char*)p_pixels)[dst_i + 2] = ((char*)p_buffer)[i];
-      ((char*)p_pixels)[dst_i + 3] = 0xff;
-    }
+    pixels_gray_to_rgba(p_pixels, p_buffer, pixel_count);
     break;
 
   case IMAGE_FORMAT_GRAY_ALPHA:
-    for (unsigned int i = 0; i < pixel_count; i++) {
-      dst_i = i * 4;
-      src_i = i * 2;
-      ((char*)p_pixels)[dst_i] = ((char*)p_buffer)[src_i];
-      ((char*)p_pixels)[dst_i + 1] = ((char*)p_buffer)[src_i];
-      ((char*)p_pixels)[dst_i + 2] = ((char*)p_buffer)[src_i];
-      ((char*)p_pixels)[dst_i + 3] = ((char*)p_buffer)[src_i + 1];
-    }
+    pixels_gray_alpha_to_rgba(p_pixels, p_buffer, pixel_count);
     break;
 
   case IMAGE_FORMAT_RGB:
-    for (unsigned int i = 0; i < pixel_count; i++) {
-      dst_i = i * 4;
-      src_i = i * 3;
-      ((char*)p_pixels)[dst_i] = ((char*)p_buffer)[src_i];
-      ((char*)p_pixels)[dst_i + 1] = ((char*)p_buffer)[src_i + 1];
-      ((char*)p_pixels)[dst_i + 2] = ((char*)p_buffer)[src_i + 2];
-      ((char*)p_pixels)[dst_i + 3] = 0xff;
-    }
+    pixels_rgb_to_rgba(p_pixels, p_buffer, pixel_count);
     break;
 
   case IMAGE_FORMAT_RGBA:
@@ -149,39 +176,17 @@ int read_pixels(void* p_pixels,
     break;
   }
 
-  // clean up
-  if (p_buffer) free(p_buffer);
-
   return 0;
 }
 
 //---------------------------------------------------------
-void put_image(uint32_t* p_msg_length, void* v_ctx)
+// create or update the image named id from the bytes at p_src, which are
+// in the given format
+static void store_image(void* v_ctx, sid_t id,
+                        uint32_t width, uint32_t height,
+                        image_format_t format,
+                        const void* p_src, uint32_t src_size)
 {
-  // read in the fixed size data
-  uint32_t id_length;
-  uint32_t blob_size;
-  uint32_t width;
-  uint32_t height;
-  image_format_t format;
-  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
-  read_bytes_down(&blob_size, sizeof(uint32_t), p_msg_length);
-  read_bytes_down(&width, sizeof(uint32_t), p_msg_length);
-  read_bytes_down(&height, sizeof(uint32_t), p_msg_length);
-  read_bytes_down(&format, sizeof(uint32_t), p_msg_length);
-
-  // read the id into a temp buffer
-  void* p_temp_id = calloc(1, id_length + 1);
-  if (!p_temp_id) {
-    log_error("Unable to allocate image p_temp_id");
-    return;
-  }
-
-  read_bytes_down(p_temp_id, id_length, p_msg_length);
-  sid_t id;
-  id.size = id_length;
-  id.p_data = p_temp_id;
-
   // get the existing image record, if there is one
   image_t* p_image = get_image(id);
 
@@ -189,7 +194,6 @@ void put_image(uint32_t* p_msg_length, void* v_ctx)
   if (p_image
       && ((width != p_image->width) || (height != p_image->height))) {
     log_error("Cannot change image size");
-    free(p_temp_id);
     return;
   }
 
@@ -198,14 +202,13 @@ void put_image(uint32_t* p_msg_length, void* v_ctx)
     // initialize a record to hold the image
     int struct_size = ALIGN_UP(sizeof(image_t), 8);
     // the +1 is so the id is null terminated
-    int id_size = ALIGN_UP(id_length + 1, 8);
+    int id_size = ALIGN_UP(id.size + 1, 8);
     int pixel_size = width * height * 4;
     int alloc_size = struct_size + id_size + pixel_size;
 
     p_image = malloc(alloc_size);
     if (!p_image) {
       log_error("Unable to allocate image struct");
-      free(p_temp_id);
       return;
     }
 
@@ -215,29 +218,198 @@ void put_image(uint32_t* p_msg_length, void* v_ctx)
     p_image->height = height;
     p_image->format = format;
 
-    // initialize the id
-    p_image->id.size = id_length;
-    p_image->id.p_data = ((void*)p_image) + struct_size;
-    memcpy(p_image->id.p_data, p_temp_id, id_length);
-
     // initialize the pixel pointer
     p_image->p_pixels = ((void*)p_image) + struct_size + id_size;
 
     // get the image data in pixel format
-    read_pixels(p_image->p_pixels, width, height, format, p_msg_length);
+    if (convert_pixels(p_image->p_pixels, width, height, format, p_src, src_size)) {
+      free(p_image);
+      return;
+    }
+
+    // initialize the id
+    p_image->id.size = id.size;
+    p_image->id.p_data = ((void*)p_image) + struct_size;
+    memcpy(p_image->id.p_data, id.p_data, id.size);
+    p_image->id.handle = intern_id(p_image->id).handle;
 
     // create a texture from the pixel data
+    int64_t trace_start = trace_begin();
     p_image->image_id = image_ops_create(v_ctx, width, height, p_image->p_pixels);
+    trace_end(trace_start, trace_image_upload, width * height * 4,
+              p_image->id.p_data, p_image->id.size);
 
     // save the image record into the tommyhash
     tommy_hashlin_insert(&images, &p_image->node, p_image, HASH_ID(p_image->id));
+    set_id_slot(p_image->id, ID_SLOT_IMAGE, p_image);
 
   } else {
     // the image already exists and is the right size.
     // can save some bit of work by replacing the pixels of the existing image
-    read_pixels(p_image->p_pixels, width, height, format, p_msg_length);
+    if (convert_pixels(p_image->p_pixels, width, height, format, p_src, src_size)) {
+      return;
+    }
+    int64_t trace_start = trace_begin();
     image_ops_update(v_ctx, p_image->image_id, p_image->p_pixels);
+    trace_end(trace_start, trace_image_upload, width * height * 4,
+              p_image->id.p_data, p_image->id.size);
   }
 
-  free(p_temp_id);
+  // anything drawing this image needs to be repainted
+  mark_id_dirty(p_image->id);
+}
+
+//---------------------------------------------------------
+void put_image(uint32_t* p_msg_length, void* v_ctx)
+{
+  // read in the fixed size data
+  uint32_t id_length;
+  uint32_t blob_size;
+  uint32_t width;
+  uint32_t height;
+  image_format_t format;
+  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&blob_size, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&width, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&height, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&format, sizeof(uint32_t), p_msg_length);
+
+  if (id_length > *p_msg_length) {
+    log_error("Invalid image id length: %d", id_length);
+    return;
+  }
+
+  // the id and pixels are used where they sit in the input buffer
+  uint32_t pixels_size = *p_msg_length - id_length;
+  void* p_id = read_bytes_in_place(*p_msg_length, p_msg_length);
+  if (!p_id) {
+    log_error("Unable to read image");
+    return;
+  }
+
+  sid_t id = {p_id, id_length, 0};
+  store_image(v_ctx, id, width, height, format, p_id + id_length, pixels_size);
+}
+
+//---------------------------------------------------------
+// Same as put_image, but the pixels are in a shared memory file written
+// by the caller. Only the path, offset and size come down the pipe. The
+// caller doesn't write the file again until MSG_OUT_SHM_DONE says so.
+void put_image_shm(uint32_t* p_msg_length, void* v_ctx)
+{
+  // read in the fixed size data
+  uint32_t id_length;
+  uint32_t path_length;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t width;
+  uint32_t height;
+  image_format_t format;
+  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&path_length, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&offset, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&size, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&width, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&height, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&format, sizeof(uint32_t), p_msg_length);
+
+  if (id_length + path_length != *p_msg_length) {
+    log_error("Invalid shared image message");
+    return;
+  }
+
+  void* p_id = read_bytes_in_place(*p_msg_length, p_msg_length);
+  if (!p_id) {
+    log_error("Unable to read image");
+    return;
+  }
+
+  // the pixels are copied out, so the caller can have the file back as
+  // soon as they are stored, or straight away if they can't be
+  sid_t id = {p_id, id_length, 0};
+  const char* p_path = p_id + id_length;
+  const void* p_src = shm_map(p_path, path_length, offset, size);
+  if (p_src) {
+    store_image(v_ctx, id, width, height, format, p_src, size);
+  }
+  shm_done(p_path, path_length);
+}
+
+//---------------------------------------------------------
+// Replace the pixels in one rectangle of an existing image. Only that
+// region is converted and handed to the renderer. The pixels are raw
+// (not a file) and tightly packed, width * height of them.
+void put_image_region(uint32_t* p_msg_length, void* v_ctx)
+{
+  // read in the fixed size data
+  uint32_t id_length;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  image_format_t format;
+  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&x, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&y, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&width, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&height, sizeof(uint32_t), p_msg_length);
+  read_bytes_down(&format, sizeof(uint32_t), p_msg_length);
+
+  if (id_length > *p_msg_length) {
+    log_error("Invalid image id length: %d", id_length);
+    return;
+  }
+
+  uint32_t pixels_size = *p_msg_length - id_length;
+  void* p_id = read_bytes_in_place(*p_msg_length, p_msg_length);
+  if (!p_id) {
+    log_error("Unable to read image region");
+    return;
+  }
+
+  sid_t id = {p_id, id_length, 0};
+  image_t* p_image = get_image(id);
+  if (!p_image) {
+    log_error("Image region update for unknown image");
+    return;
+  }
+
+  uint32_t bpp = format_bytes(format);
+  if (!bpp) {
+    log_error("Invalid image region format: %d", format);
+    return;
+  }
+
+  // the region has to sit inside the image
+  if ((x > p_image->width) || (width > p_image->width - x)
+      || (y > p_image->height) || (height > p_image->height - y)) {
+    log_error("Image region out of bounds");
+    return;
+  }
+
+  if (!width || !height) {
+    return;
+  }
+
+  if (pixels_size / bpp / width < height) {
+    log_error("Not enough pixel data for the image region");
+    return;
+  }
+
+  // convert the region a row at a time into the retained pixels, which
+  // stay whole so the renderer can read the region out of them in place
+  const void* p_src = p_id + id_length;
+  uint32_t src_stride = width * bpp;
+  for (uint32_t row = 0; row < height; row++) {
+    void* p_dst = p_image->p_pixels + (((y + row) * p_image->width) + x) * 4;
+    convert_pixels(p_dst, width, 1, format, p_src + row * src_stride, src_stride);
+  }
+
+  int64_t trace_start = trace_begin();
+  image_ops_update_region(v_ctx, p_image->image_id, x, y, width, height, p_image->p_pixels);
+  trace_end(trace_start, trace_image_upload, width * height * 4,
+            p_image->id.p_data, p_image->id.size);
+
+  // anything drawing this image needs to be repainted
+  mark_id_dirty(p_image->id);
 }
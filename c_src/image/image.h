@@ -29,5 +29,8 @@ typedef enum {
 
 void init_images(void);
 void put_image(uint32_t* p_msg_length, void* v_ctx);
+void put_image_shm(uint32_t* p_msg_length, void* v_ctx);
+void put_image_region(uint32_t* p_msg_length, void* v_ctx);
 void reset_images(void* v_ctx);
 image_t* get_image(sid_t id);
+void image_stats(uint32_t* p_count, uint64_t* p_bytes);
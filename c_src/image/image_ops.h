@@ -4,4 +4,9 @@
 
 int32_t image_ops_create(void* v_ctx, uint32_t width, uint32_t height, void* p_pixels);
 void image_ops_update(void* v_ctx, int32_t image_id, void* p_pixels);
+// p_pixels is the whole image. Only the x/y/width/height region has changed
+void image_ops_update_region(void* v_ctx, int32_t image_id,
+                             uint32_t x, uint32_t y,
+                             uint32_t width, uint32_t height,
+                             void* p_pixels);
 void image_ops_delete(void* v_ctx, int32_t image_id);
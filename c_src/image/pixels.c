@@ -0,0 +1,667 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#include <string.h>
+
+#include "pixels.h"
+
+#if defined(PIXELS_NO_SIMD)
+  // plain C only, for measuring what the SIMD loops are worth
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+  #include <tmmintrin.h>
+  #define PIXELS_SSE2
+#elif defined(__ARM_NEON) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  #include <arm_neon.h>
+  #define PIXELS_NEON
+#endif
+
+//=============================================================================
+// plain C. Also finishes off whatever the SIMD loops leave over
+
+//---------------------------------------------------------
+static void gray_to_rgba_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t g = p_src[i];
+    p_dst[0] = g;
+    p_dst[1] = g;
+    p_dst[2] = g;
+    p_dst[3] = 0xff;
+    p_dst += 4;
+  }
+}
+
+//---------------------------------------------------------
+static void gray_alpha_to_rgba_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t g = p_src[0];
+    p_dst[0] = g;
+    p_dst[1] = g;
+    p_dst[2] = g;
+    p_dst[3] = p_src[1];
+    p_src += 2;
+    p_dst += 4;
+  }
+}
+
+//---------------------------------------------------------
+static void rgb_to_rgba_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    p_dst[0] = p_src[0];
+    p_dst[1] = p_src[1];
+    p_dst[2] = p_src[2];
+    p_dst[3] = 0xff;
+    p_src += 3;
+    p_dst += 4;
+  }
+}
+
+//---------------------------------------------------------
+static void rgba_to_argb32_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t argb = ((uint32_t)p_src[3] << 24) | ((uint32_t)p_src[0] << 16)
+      | ((uint32_t)p_src[1] << 8) | p_src[2];
+    memcpy(p_dst, &argb, sizeof(uint32_t));
+    p_src += 4;
+    p_dst += 4;
+  }
+}
+
+//---------------------------------------------------------
+// ordered dither thresholds, 0 to 15
+static const uint8_t bayer4[4][4] = {
+  { 0,  8,  2, 10},
+  {12,  4, 14,  6},
+  { 3, 11,  1,  9},
+  {15,  7, 13,  5}
+};
+
+// What is added to each channel of a row's pixels before it is cut
+// down. The pattern repeats every 4 pixels, which is also how many
+// pixels the SIMD loops step by, so entry i & 3 is right for pixel i.
+typedef struct {
+  uint8_t r[4];
+  uint8_t g[4];
+  uint8_t b[4];
+} dither_t;
+
+// the drops are how many low bits of each channel the format loses
+static void dither_init(dither_t* p_dither, uint32_t x, uint32_t y, bool dither,
+                        uint32_t r_drop, uint32_t g_drop, uint32_t b_drop)
+{
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t m = dither ? bayer4[y & 3][(x + i) & 3] : 0;
+    p_dither->r[i] = (m << r_drop) >> 4;
+    p_dither->g[i] = (m << g_drop) >> 4;
+    p_dither->b[i] = (m << b_drop) >> 4;
+  }
+}
+
+// the channels of pixel i with its dither added, saturated
+static inline void dither_pixel(const uint8_t* p_src, const dither_t* p_dither, uint32_t i,
+                                uint32_t* p_r, uint32_t* p_g, uint32_t* p_b)
+{
+  uint32_t argb;
+  memcpy(&argb, p_src + i * 4, sizeof(uint32_t));
+  uint32_t r = ((argb >> 16) & 0xff) + p_dither->r[i & 3];
+  uint32_t g = ((argb >> 8) & 0xff) + p_dither->g[i & 3];
+  uint32_t b = (argb & 0xff) + p_dither->b[i & 3];
+  *p_r = (r > 0xff) ? 0xff : r;
+  *p_g = (g > 0xff) ? 0xff : g;
+  *p_b = (b > 0xff) ? 0xff : b;
+}
+
+//---------------------------------------------------------
+static void argb32_to_rgb565_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                               const dither_t* p_dither)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t r, g, b;
+    dither_pixel(p_src, p_dither, i, &r, &g, &b);
+    uint16_t px = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+    memcpy(p_dst + i * 2, &px, sizeof(uint16_t));
+  }
+}
+
+//---------------------------------------------------------
+static void argb32_to_rgb555_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                               const dither_t* p_dither)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t r, g, b;
+    dither_pixel(p_src, p_dither, i, &r, &g, &b);
+    uint16_t px = ((r & 0xf8) << 7) | ((g & 0xf8) << 2) | (b >> 3);
+    memcpy(p_dst + i * 2, &px, sizeof(uint16_t));
+  }
+}
+
+//---------------------------------------------------------
+static void argb32_to_bgr555_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                               const dither_t* p_dither)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t r, g, b;
+    dither_pixel(p_src, p_dither, i, &r, &g, &b);
+    uint16_t px = ((b & 0xf8) << 7) | ((g & 0xf8) << 2) | (r >> 3);
+    memcpy(p_dst + i * 2, &px, sizeof(uint16_t));
+  }
+}
+
+//---------------------------------------------------------
+static void argb32_to_rgb332_c(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                               const dither_t* p_dither)
+{
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t r, g, b;
+    dither_pixel(p_src, p_dither, i, &r, &g, &b);
+    p_dst[i] = (r & 0xe0) | ((g & 0xe0) >> 3) | (b >> 6);
+  }
+}
+
+//=============================================================================
+// SSE2, plus SSSE3 for RGB when the cpu has it. Every x86_64 has SSE2
+
+#ifdef PIXELS_SSE2
+
+//---------------------------------------------------------
+// 16 pixels at a time
+static uint32_t gray_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  const __m128i ff = _mm_set1_epi8((char)0xff);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    __m128i g = _mm_loadu_si128((const __m128i*)(p_src + done));
+    __m128i gg_lo = _mm_unpacklo_epi8(g, g);
+    __m128i gg_hi = _mm_unpackhi_epi8(g, g);
+    __m128i ga_lo = _mm_unpacklo_epi8(g, ff);
+    __m128i ga_hi = _mm_unpackhi_epi8(g, ff);
+    __m128i* p = (__m128i*)(p_dst + done * 4);
+    _mm_storeu_si128(p, _mm_unpacklo_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(gg_hi, ga_hi));
+    _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(gg_hi, ga_hi));
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// 8 pixels at a time. Each 16 bit lane is g | a << 8
+static uint32_t gray_alpha_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  const __m128i low = _mm_set1_epi16(0x00ff);
+  uint32_t done = 0;
+
+  for (; done + 8 <= count; done += 8) {
+    __m128i ga = _mm_loadu_si128((const __m128i*)(p_src + done * 2));
+    __m128i g = _mm_and_si128(ga, low);
+    __m128i gg = _mm_or_si128(g, _mm_slli_epi16(g, 8));
+    __m128i* p = (__m128i*)(p_dst + done * 4);
+    _mm_storeu_si128(p, _mm_unpacklo_epi16(gg, ga));
+    _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(gg, ga));
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// 16 pixels from three loads. Plain SSE2 has no byte shuffle, so this
+// one needs SSSE3
+__attribute__((target("ssse3")))
+static uint32_t rgb_to_rgba_ssse3(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+                                       6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    const __m128i* s = (const __m128i*)(p_src + done * 3);
+    __m128i a = _mm_loadu_si128(s);
+    __m128i b = _mm_loadu_si128(s + 1);
+    __m128i c = _mm_loadu_si128(s + 2);
+    __m128i* p = (__m128i*)(p_dst + done * 4);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_shuffle_epi8(a, spread), alpha));
+    _mm_storeu_si128(p + 1, _mm_or_si128(
+                       _mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), spread), alpha));
+    _mm_storeu_si128(p + 2, _mm_or_si128(
+                       _mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), spread), alpha));
+    _mm_storeu_si128(p + 3, _mm_or_si128(
+                       _mm_shuffle_epi8(_mm_srli_si128(c, 4), spread), alpha));
+  }
+  return done;
+}
+
+static uint32_t rgb_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  if (__builtin_cpu_supports("ssse3")) {
+    return rgb_to_rgba_ssse3(p_dst, p_src, count);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------
+// 4 pixels at a time. In memory little endian ARGB is B G R A, so this
+// just swaps R and B in each 32 bit lane
+static uint32_t rgba_to_argb32_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  const __m128i ag = _mm_set1_epi32((int)0xff00ff00);
+  const __m128i rb = _mm_set1_epi32(0x00ff00ff);
+  uint32_t done = 0;
+
+  for (; done + 4 <= count; done += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(p_src + done * 4));
+    __m128i y = _mm_and_si128(x, rb);
+    y = _mm_or_si128(_mm_srli_epi32(y, 16), _mm_slli_epi32(y, 16));
+    x = _mm_or_si128(_mm_and_si128(x, ag), y);
+    _mm_storeu_si128((__m128i*)(p_dst + done * 4), x);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// the dither for 4 pixels, laid out like the ARGB32 words it is added to
+static __m128i dither_bias(const dither_t* p_dither)
+{
+  int32_t w[4];
+  for (int i = 0; i < 4; i++) {
+    w[i] = (p_dither->r[i] << 16) | (p_dither->g[i] << 8) | p_dither->b[i];
+  }
+  return _mm_setr_epi32(w[0], w[1], w[2], w[3]);
+}
+
+// The 16 bit results are built in 32 bit lanes. They are sign extended
+// first so the signed pack down to 16 bits keeps them whole
+static inline __m128i pack_16(__m128i x)
+{
+  return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+static inline __m128i rgb565_lanes(__m128i p)
+{
+  __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xf800));
+  __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07e0));
+  __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001f));
+  return pack_16(_mm_or_si128(_mm_or_si128(r, g), b));
+}
+
+static inline __m128i rgb555_lanes(__m128i p)
+{
+  __m128i r = _mm_and_si128(_mm_srli_epi32(p, 9), _mm_set1_epi32(0x7c00));
+  __m128i g = _mm_and_si128(_mm_srli_epi32(p, 6), _mm_set1_epi32(0x03e0));
+  __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001f));
+  return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+static inline __m128i bgr555_lanes(__m128i p)
+{
+  __m128i b = _mm_and_si128(_mm_slli_epi32(p, 7), _mm_set1_epi32(0x7c00));
+  __m128i g = _mm_and_si128(_mm_srli_epi32(p, 6), _mm_set1_epi32(0x03e0));
+  __m128i r = _mm_and_si128(_mm_srli_epi32(p, 19), _mm_set1_epi32(0x001f));
+  return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+static inline __m128i rgb332_lanes(__m128i p)
+{
+  __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), _mm_set1_epi32(0xe0));
+  __m128i g = _mm_and_si128(_mm_srli_epi32(p, 11), _mm_set1_epi32(0x1c));
+  __m128i b = _mm_and_si128(_mm_srli_epi32(p, 6), _mm_set1_epi32(0x03));
+  return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+//---------------------------------------------------------
+// 8 pixels at a time. The saturating add applies the dither to every
+// channel at once
+static uint32_t argb32_to_rgb565_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const __m128i bias = dither_bias(p_dither);
+  uint32_t done = 0;
+
+  for (; done + 8 <= count; done += 8) {
+    const __m128i* s = (const __m128i*)(p_src + done * 4);
+    __m128i a = _mm_adds_epu8(_mm_loadu_si128(s), bias);
+    __m128i b = _mm_adds_epu8(_mm_loadu_si128(s + 1), bias);
+    _mm_storeu_si128((__m128i*)(p_dst + done * 2),
+                     _mm_packs_epi32(rgb565_lanes(a), rgb565_lanes(b)));
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// the 555 formats leave the top bit clear, so they pack without help
+static uint32_t argb32_to_rgb555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const __m128i bias = dither_bias(p_dither);
+  uint32_t done = 0;
+
+  for (; done + 8 <= count; done += 8) {
+    const __m128i* s = (const __m128i*)(p_src + done * 4);
+    __m128i a = _mm_adds_epu8(_mm_loadu_si128(s), bias);
+    __m128i b = _mm_adds_epu8(_mm_loadu_si128(s + 1), bias);
+    _mm_storeu_si128((__m128i*)(p_dst + done * 2),
+                     _mm_packs_epi32(rgb555_lanes(a), rgb555_lanes(b)));
+  }
+  return done;
+}
+
+static uint32_t argb32_to_bgr555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const __m128i bias = dither_bias(p_dither);
+  uint32_t done = 0;
+
+  for (; done + 8 <= count; done += 8) {
+    const __m128i* s = (const __m128i*)(p_src + done * 4);
+    __m128i a = _mm_adds_epu8(_mm_loadu_si128(s), bias);
+    __m128i b = _mm_adds_epu8(_mm_loadu_si128(s + 1), bias);
+    _mm_storeu_si128((__m128i*)(p_dst + done * 2),
+                     _mm_packs_epi32(bgr555_lanes(a), bgr555_lanes(b)));
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// 16 pixels at a time, packed 32 to 16 to 8 bits
+static uint32_t argb32_to_rgb332_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const __m128i bias = dither_bias(p_dither);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    const __m128i* s = (const __m128i*)(p_src + done * 4);
+    __m128i a = rgb332_lanes(_mm_adds_epu8(_mm_loadu_si128(s), bias));
+    __m128i b = rgb332_lanes(_mm_adds_epu8(_mm_loadu_si128(s + 1), bias));
+    __m128i c = rgb332_lanes(_mm_adds_epu8(_mm_loadu_si128(s + 2), bias));
+    __m128i d = rgb332_lanes(_mm_adds_epu8(_mm_loadu_si128(s + 3), bias));
+    _mm_storeu_si128((__m128i*)(p_dst + done),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+  return done;
+}
+
+//=============================================================================
+// NEON. The structure loads and stores do the interleaving
+
+#elif defined(PIXELS_NEON)
+
+//---------------------------------------------------------
+static uint32_t gray_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  uint32_t done = 0;
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x4_t out;
+    out.val[0] = vld1q_u8(p_src + done);
+    out.val[1] = out.val[0];
+    out.val[2] = out.val[0];
+    out.val[3] = vdupq_n_u8(0xff);
+    vst4q_u8(p_dst + done * 4, out);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+static uint32_t gray_alpha_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  uint32_t done = 0;
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x2_t in = vld2q_u8(p_src + done * 2);
+    uint8x16x4_t out;
+    out.val[0] = in.val[0];
+    out.val[1] = in.val[0];
+    out.val[2] = in.val[0];
+    out.val[3] = in.val[1];
+    vst4q_u8(p_dst + done * 4, out);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+static uint32_t rgb_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  uint32_t done = 0;
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x3_t in = vld3q_u8(p_src + done * 3);
+    uint8x16x4_t out;
+    out.val[0] = in.val[0];
+    out.val[1] = in.val[1];
+    out.val[2] = in.val[2];
+    out.val[3] = vdupq_n_u8(0xff);
+    vst4q_u8(p_dst + done * 4, out);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// little endian ARGB words are B G R A in memory
+static uint32_t rgba_to_argb32_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{
+  uint32_t done = 0;
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x4_t px = vld4q_u8(p_src + done * 4);
+    uint8x16_t r = px.val[0];
+    px.val[0] = px.val[2];
+    px.val[2] = r;
+    vst4q_u8(p_dst + done * 4, px);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// one channel's dither for 16 pixels
+static uint8x16_t dither_plane(const uint8_t* p_bias)
+{
+  uint8_t plane[16];
+  for (int i = 0; i < 16; i++) {
+    plane[i] = p_bias[i & 3];
+  }
+  return vld1q_u8(plane);
+}
+
+//---------------------------------------------------------
+// vsri shifts each channel in under the ones already placed above it
+static uint32_t argb32_to_rgb565_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const uint8x16_t br = dither_plane(p_dither->r);
+  const uint8x16_t bg = dither_plane(p_dither->g);
+  const uint8x16_t bb = dither_plane(p_dither->b);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x4_t px = vld4q_u8(p_src + done * 4);
+    uint8x16_t b = vqaddq_u8(px.val[0], bb);
+    uint8x16_t g = vqaddq_u8(px.val[1], bg);
+    uint8x16_t r = vqaddq_u8(px.val[2], br);
+
+    uint16x8_t lo = vshll_n_u8(vget_low_u8(r), 8);
+    lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(g), 8), 5);
+    lo = vsriq_n_u16(lo, vshll_n_u8(vget_low_u8(b), 8), 11);
+    uint16x8_t hi = vshll_n_u8(vget_high_u8(r), 8);
+    hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(g), 8), 5);
+    hi = vsriq_n_u16(hi, vshll_n_u8(vget_high_u8(b), 8), 11);
+
+    vst1q_u16((uint16_t*)(p_dst + done * 2), lo);
+    vst1q_u16((uint16_t*)(p_dst + done * 2 + 16), hi);
+  }
+  return done;
+}
+
+//---------------------------------------------------------
+// top is the channel that lands in bits 10-14, bottom the one in 0-4
+static inline uint16x8_t x555(uint8x8_t top, uint8x8_t g, uint8x8_t bottom)
+{
+  uint16x8_t x = vshrq_n_u16(vshll_n_u8(top, 8), 1);
+  x = vsriq_n_u16(x, vshll_n_u8(g, 8), 6);
+  return vsriq_n_u16(x, vshll_n_u8(bottom, 8), 11);
+}
+
+static uint32_t argb32_to_555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                   const dither_t* p_dither, bool bgr)
+{
+  const uint8x16_t br = dither_plane(p_dither->r);
+  const uint8x16_t bg = dither_plane(p_dither->g);
+  const uint8x16_t bb = dither_plane(p_dither->b);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x4_t px = vld4q_u8(p_src + done * 4);
+    uint8x16_t b = vqaddq_u8(px.val[0], bb);
+    uint8x16_t g = vqaddq_u8(px.val[1], bg);
+    uint8x16_t r = vqaddq_u8(px.val[2], br);
+    uint8x16_t top = bgr ? b : r;
+    uint8x16_t bottom = bgr ? r : b;
+
+    vst1q_u16((uint16_t*)(p_dst + done * 2),
+              x555(vget_low_u8(top), vget_low_u8(g), vget_low_u8(bottom)));
+    vst1q_u16((uint16_t*)(p_dst + done * 2 + 16),
+              x555(vget_high_u8(top), vget_high_u8(g), vget_high_u8(bottom)));
+  }
+  return done;
+}
+
+static uint32_t argb32_to_rgb555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  return argb32_to_555_simd(p_dst, p_src, count, p_dither, false);
+}
+
+static uint32_t argb32_to_bgr555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  return argb32_to_555_simd(p_dst, p_src, count, p_dither, true);
+}
+
+//---------------------------------------------------------
+static uint32_t argb32_to_rgb332_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{
+  const uint8x16_t br = dither_plane(p_dither->r);
+  const uint8x16_t bg = dither_plane(p_dither->g);
+  const uint8x16_t bb = dither_plane(p_dither->b);
+  uint32_t done = 0;
+
+  for (; done + 16 <= count; done += 16) {
+    uint8x16x4_t px = vld4q_u8(p_src + done * 4);
+    uint8x16_t b = vqaddq_u8(px.val[0], bb);
+    uint8x16_t g = vqaddq_u8(px.val[1], bg);
+    uint8x16_t r = vqaddq_u8(px.val[2], br);
+    uint8x16_t x = vandq_u8(r, vdupq_n_u8(0xe0));
+    x = vorrq_u8(x, vandq_u8(vshrq_n_u8(g, 3), vdupq_n_u8(0x1c)));
+    x = vorrq_u8(x, vshrq_n_u8(b, 6));
+    vst1q_u8(p_dst + done, x);
+  }
+  return done;
+}
+
+//=============================================================================
+// no SIMD
+
+#else
+
+static uint32_t gray_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{ return 0; }
+static uint32_t gray_alpha_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{ return 0; }
+static uint32_t rgb_to_rgba_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{ return 0; }
+static uint32_t rgba_to_argb32_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count)
+{ return 0; }
+static uint32_t argb32_to_rgb565_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{ return 0; }
+static uint32_t argb32_to_rgb555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{ return 0; }
+static uint32_t argb32_to_bgr555_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{ return 0; }
+static uint32_t argb32_to_rgb332_simd(uint8_t* p_dst, const uint8_t* p_src, uint32_t count,
+                                      const dither_t* p_dither)
+{ return 0; }
+
+#endif
+
+//=============================================================================
+// public api. The SIMD loops do the bulk and the C loops the tail
+
+//---------------------------------------------------------
+void pixels_gray_to_rgba(void* p_dst, const void* p_src, uint32_t count)
+{
+  uint32_t done = gray_to_rgba_simd(p_dst, p_src, count);
+  gray_to_rgba_c((uint8_t*)p_dst + done * 4, (const uint8_t*)p_src + done, count - done);
+}
+
+//---------------------------------------------------------
+void pixels_gray_alpha_to_rgba(void* p_dst, const void* p_src, uint32_t count)
+{
+  uint32_t done = gray_alpha_to_rgba_simd(p_dst, p_src, count);
+  gray_alpha_to_rgba_c((uint8_t*)p_dst + done * 4, (const uint8_t*)p_src + done * 2,
+                       count - done);
+}
+
+//---------------------------------------------------------
+void pixels_rgb_to_rgba(void* p_dst, const void* p_src, uint32_t count)
+{
+  uint32_t done = rgb_to_rgba_simd(p_dst, p_src, count);
+  rgb_to_rgba_c((uint8_t*)p_dst + done * 4, (const uint8_t*)p_src + done * 3, count - done);
+}
+
+//---------------------------------------------------------
+void pixels_rgba_to_argb32(void* p_dst, const void* p_src, uint32_t count)
+{
+  uint32_t done = rgba_to_argb32_simd(p_dst, p_src, count);
+  rgba_to_argb32_c((uint8_t*)p_dst + done * 4, (const uint8_t*)p_src + done * 4, count - done);
+}
+
+//---------------------------------------------------------
+void pixels_argb32_to_rgb565(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither)
+{
+  dither_t d;
+  dither_init(&d, x, y, dither, 3, 2, 3);
+  uint32_t done = argb32_to_rgb565_simd(p_dst, p_src, count, &d);
+  argb32_to_rgb565_c((uint8_t*)p_dst + done * 2, (const uint8_t*)p_src + done * 4,
+                     count - done, &d);
+}
+
+//---------------------------------------------------------
+void pixels_argb32_to_rgb555(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither)
+{
+  dither_t d;
+  dither_init(&d, x, y, dither, 3, 3, 3);
+  uint32_t done = argb32_to_rgb555_simd(p_dst, p_src, count, &d);
+  argb32_to_rgb555_c((uint8_t*)p_dst + done * 2, (const uint8_t*)p_src + done * 4,
+                     count - done, &d);
+}
+
+//---------------------------------------------------------
+void pixels_argb32_to_bgr555(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither)
+{
+  dither_t d;
+  dither_init(&d, x, y, dither, 3, 3, 3);
+  uint32_t done = argb32_to_bgr555_simd(p_dst, p_src, count, &d);
+  argb32_to_bgr555_c((uint8_t*)p_dst + done * 2, (const uint8_t*)p_src + done * 4,
+                     count - done, &d);
+}
+
+//---------------------------------------------------------
+void pixels_argb32_to_rgb332(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither)
+{
+  dither_t d;
+  dither_init(&d, x, y, dither, 5, 5, 6);
+  uint32_t done = argb32_to_rgb332_simd(p_dst, p_src, count, &d);
+  argb32_to_rgb332_c((uint8_t*)p_dst + done, (const uint8_t*)p_src + done * 4,
+                     count - done, &d);
+}
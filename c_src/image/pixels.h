@@ -0,0 +1,35 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Converters from the raw formats images arrive in to the formats the
+// renderers take. Each uses SIMD where the cpu has it and falls back to
+// plain C otherwise. Counts are in pixels. Nothing needs to be aligned.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void pixels_gray_to_rgba(void* p_dst, const void* p_src, uint32_t count);
+void pixels_gray_alpha_to_rgba(void* p_dst, const void* p_src, uint32_t count);
+void pixels_rgb_to_rgba(void* p_dst, const void* p_src, uint32_t count);
+
+// RGBA bytes to the native endian 0xAARRGGBB words cairo uses
+void pixels_rgba_to_argb32(void* p_dst, const void* p_src, uint32_t count);
+
+// Cairo ARGB32 words to the packed formats of 16, 15 and 8 bit
+// framebuffers. With dither set, a 4x4 ordered (Bayer) pattern is added
+// before the low bits are dropped, which breaks up the banding in
+// gradients. x and y are where the first pixel sits in the picture, so
+// the pattern lines up from row to row and across partial updates.
+void pixels_argb32_to_rgb565(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither);
+void pixels_argb32_to_rgb555(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither);
+void pixels_argb32_to_bgr555(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither);
+void pixels_argb32_to_rgb332(void* p_dst, const void* p_src, uint32_t count,
+                             uint32_t x, uint32_t y, bool dither);
@@ -0,0 +1,147 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "shm.h"
+
+#define SHM_MAX_FILES 8
+#define SHM_MAX_PATH 256
+
+typedef struct {
+  char path[SHM_MAX_PATH];
+  int fd;
+  void* p_map;
+  size_t map_size;
+} shm_file_t;
+
+static shm_file_t files[SHM_MAX_FILES] = {0};
+// the next file to close when they are all in use
+static uint32_t next_victim = 0;
+
+//---------------------------------------------------------
+static void shm_close(shm_file_t* p_file)
+{
+  if (p_file->p_map) {
+    munmap(p_file->p_map, p_file->map_size);
+  }
+  if (p_file->path[0]) {
+    close(p_file->fd);
+  }
+  memset(p_file, 0, sizeof(shm_file_t));
+}
+
+//---------------------------------------------------------
+static shm_file_t* shm_open_file(const char* path, uint32_t path_length)
+{
+  // already open?
+  for (int i = 0; i < SHM_MAX_FILES; i++) {
+    if (files[i].path[0]
+        && !strncmp(files[i].path, path, path_length)
+        && files[i].path[path_length] == 0) {
+      return &files[i];
+    }
+  }
+
+  // find a free entry, or reuse one
+  shm_file_t* p_file = NULL;
+  for (int i = 0; i < SHM_MAX_FILES && !p_file; i++) {
+    if (!files[i].path[0]) {
+      p_file = &files[i];
+    }
+  }
+  if (!p_file) {
+    p_file = &files[next_victim];
+    next_victim = (next_victim + 1) % SHM_MAX_FILES;
+    shm_close(p_file);
+  }
+
+  memcpy(p_file->path, path, path_length);
+  p_file->path[path_length] = 0;
+  p_file->fd = open(p_file->path, O_RDONLY);
+  if (p_file->fd < 0) {
+    log_error("Unable to open shared memory %s: %s", p_file->path, strerror(errno));
+    memset(p_file, 0, sizeof(shm_file_t));
+    return NULL;
+  }
+
+  return p_file;
+}
+
+//---------------------------------------------------------
+const void* shm_map(const char* path, uint32_t path_length,
+                    uint32_t offset, uint32_t size)
+{
+  if (!path_length || path_length >= SHM_MAX_PATH) {
+    log_error("Invalid shared memory path length: %d", path_length);
+    return NULL;
+  }
+
+  shm_file_t* p_file = shm_open_file(path, path_length);
+  if (!p_file) {
+    return NULL;
+  }
+
+  size_t end = (size_t)offset + size;
+  if (end > p_file->map_size) {
+    // the caller only ever grows the file, so reading inside its current
+    // size is safe. Map all of it so later, smaller payloads fit as well
+    struct stat st;
+    if (fstat(p_file->fd, &st) || (size_t)st.st_size < end) {
+      log_error("Shared memory %s is too small", p_file->path);
+      return NULL;
+    }
+
+    if (p_file->p_map) {
+      munmap(p_file->p_map, p_file->map_size);
+      p_file->p_map = NULL;
+      p_file->map_size = 0;
+    }
+
+    void* p_map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, p_file->fd, 0);
+    if (p_map == MAP_FAILED) {
+      log_error("Unable to map shared memory %s: %s", p_file->path, strerror(errno));
+      return NULL;
+    }
+    p_file->p_map = p_map;
+    p_file->map_size = st.st_size;
+  }
+
+  return p_file->p_map + offset;
+}
+
+//---------------------------------------------------------
+// MSG_OUT_SHM_DONE is followed by the path
+void shm_done(const char* path, uint32_t path_length)
+{
+  uint32_t msg_size = sizeof(uint32_t) + path_length;
+  uint8_t* p_msg = malloc(msg_size);
+  if (!p_msg) {
+    log_error("Unable to release shared memory");
+    return;
+  }
+
+  uint32_t msg_id = MSG_OUT_SHM_DONE;
+  memcpy(p_msg, &msg_id, sizeof(uint32_t));
+  memcpy(p_msg + sizeof(uint32_t), path, path_length);
+  write_cmd(p_msg, msg_size);
+  free(p_msg);
+}
+
+//---------------------------------------------------------
+void shm_close_all(void)
+{
+  for (int i = 0; i < SHM_MAX_FILES; i++) {
+    shm_close(&files[i]);
+  }
+}
@@ -0,0 +1,22 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Read-only mappings of the shared memory files the caller writes large
+// image and stream payloads into. Each file stays mapped once it has been
+// used, so a ring of slot files costs one open and one mmap per slot.
+
+#pragma once
+
+#include <stdint.h>
+
+// pointer to size bytes at offset in the file at path, or NULL if they
+// can't be mapped. Good until the file is mapped again with a larger size
+const void* shm_map(const char* path, uint32_t path_length,
+                    uint32_t offset, uint32_t size);
+// tells the caller the driver is done with the payload in the file at
+// path, so the file can be written again
+void shm_done(const char* path, uint32_t path_length);
+void shm_close_all(void);
@@ -13,10 +13,12 @@
 #include <stdint.h>
 #include <assert.h>
 
+#include "capture.h"
 #include "comms.h"
 #include "scenic_types.h"
 #include "image.h"
 #include "font.h"
+#include "ids.h"
 #include "script.h"
 
 #include "device.h"
@@ -30,7 +32,7 @@ int main(int argc, char **argv)
   driver_data_t data = {0};
 
   // super simple arg check
-  if (argc != 12) {
+  if (argc != 18) {
     log_error("Wrong number of parameters");
     return -1;
   }
@@ -46,9 +48,16 @@ int main(int argc, char **argv)
   g_opts.height = atoi(argv[8]);
   g_opts.resizable = atoi(argv[9]);
   g_opts.fbdev = argv[10];
-  g_opts.title = argv[11];
+  g_opts.vsync = atoi(argv[11]);
+  g_opts.render_threads = atoi(argv[12]);
+  g_opts.dither = atoi(argv[13]);
+  g_opts.layer_cache = atoi(argv[14]);
+  g_opts.refresh_rate = atoi(argv[15]);
+  g_opts.capture = argv[16];
+  g_opts.title = argv[17];
 
   // init the hashtables
+  init_ids();
   init_scripts();
   init_fonts();
   init_images();
@@ -62,6 +71,8 @@ int main(int argc, char **argv)
     return err;
   }
 
+  start_capture(g_opts.capture, g_device_info.width, g_device_info.height);
+
   data.debug_mode = g_opts.debug_mode;
   data.v_ctx = g_device_info.v_ctx;
 
@@ -0,0 +1,345 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// scenic_replay plays back a capture written by the driver's capture
+// option. The messages go through the same dispatch_scenic_ops and the
+// same device the driver is built for, so a problem on someone else's
+// machine can be drawn again here, and two builds of the driver can be
+// timed on the same real work.
+//
+//   scenic_replay [-r] [-n passes] [-w width] [-h height]
+//                 [-t render_threads] [-l layer_cache_mb] [-f fbdev]
+//                 capture_file
+//
+// Messages are played as fast as possible, or with -r as far apart as
+// they first came. -n plays the capture that many times over, so a short
+// capture can be timed for long enough to be steady. Each render message
+// draws a frame straight away rather than waiting for the messages after
+// it, so every run draws the same frames. At the end the throughput and
+// the spread of frame times are printed. The frame time runs from the
+// first message after the last frame to the end of the render.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "comms.h"
+#include "device.h"
+#include "font.h"
+#include "ids.h"
+#include "image.h"
+#include "scenic_ops.h"
+#include "script.h"
+#include "shm.h"
+
+device_info_t g_device_info = {0};
+device_opts_t g_opts = {0};
+
+typedef struct {
+  // when each message came, in microseconds from the start
+  int64_t* p_times;
+  uint32_t count;
+  capture_header_t header;
+} capture_t;
+
+typedef struct {
+  int64_t* p_usecs;
+  uint32_t count;
+  uint32_t capacity;
+} samples_t;
+
+//---------------------------------------------------------
+static bool add_sample(samples_t* p_samples, int64_t usecs)
+{
+  if (p_samples->count == p_samples->capacity) {
+    uint32_t capacity = p_samples->capacity ? p_samples->capacity * 2 : 1024;
+    int64_t* p = realloc(p_samples->p_usecs, capacity * sizeof(int64_t));
+    if (!p) {
+      return false;
+    }
+    p_samples->p_usecs = p;
+    p_samples->capacity = capacity;
+  }
+  p_samples->p_usecs[p_samples->count++] = usecs;
+  return true;
+}
+
+//---------------------------------------------------------
+// Reads the capture, keeping the message times and writing the messages
+// themselves to p_out just as they came on stdin
+static bool read_capture(FILE* p_in, FILE* p_out, capture_t* p_capture)
+{
+  capture_header_t* p_header = &p_capture->header;
+  if ((fread(p_header, sizeof(capture_header_t), 1, p_in) != 1)
+      || memcmp(p_header->magic, CAPTURE_MAGIC, sizeof(p_header->magic))) {
+    fprintf(stderr, "scenic_replay: not a capture file\n");
+    return false;
+  }
+  if (p_header->version != CAPTURE_VERSION) {
+    fprintf(stderr, "scenic_replay: capture version %u is not supported\n",
+            p_header->version);
+    return false;
+  }
+
+  samples_t times = {0};
+  uint8_t buffer[64 * 1024];
+  int64_t usecs;
+  uint32_t length;
+  while (fread(&usecs, sizeof(int64_t), 1, p_in) == 1) {
+    if (fread(&length, sizeof(uint32_t), 1, p_in) != 1) {
+      break;
+    }
+    if (!add_sample(&times, usecs)) {
+      fprintf(stderr, "scenic_replay: out of memory\n");
+      return false;
+    }
+    long start = ftell(p_out);
+    fwrite(&length, sizeof(uint32_t), 1, p_out);
+
+    // the length is big endian, as it came from the caller
+    uint32_t remaining = ntoh_ui32(length);
+    while (remaining) {
+      uint32_t size = (remaining < sizeof(buffer)) ? remaining : sizeof(buffer);
+      if (fread(buffer, size, 1, p_in) != 1) {
+        // the driver stopped part way through a message. Drop it, and
+        // what was already written of it
+        times.count--;
+        if (fflush(p_out) || ftruncate(fileno(p_out), start)
+            || fseek(p_out, start, SEEK_SET)) {
+          fprintf(stderr, "scenic_replay: unable to write the messages out\n");
+          return false;
+        }
+        break;
+      }
+      fwrite(buffer, size, 1, p_out);
+      remaining -= size;
+    }
+  }
+
+  p_capture->p_times = times.p_usecs;
+  p_capture->count = times.count;
+
+  if (fflush(p_out)) {
+    fprintf(stderr, "scenic_replay: unable to write the messages out\n");
+    return false;
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+static void sleep_until(int64_t usecs)
+{
+  struct timespec ts = {
+    .tv_sec = usecs / 1000000,
+    .tv_nsec = (usecs % 1000000) * 1000
+  };
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+    // interrupted by a signal, keep waiting
+  }
+}
+
+//---------------------------------------------------------
+static int compare_i64(const void* p_a, const void* p_b)
+{
+  int64_t a = *(const int64_t*)p_a;
+  int64_t b = *(const int64_t*)p_b;
+  return (a > b) - (a < b);
+}
+
+//---------------------------------------------------------
+// nearest rank
+static int64_t percentile(const samples_t* p_sorted, uint32_t pct)
+{
+  if (!p_sorted->count) return 0;
+  uint32_t rank = (pct * (uint64_t)p_sorted->count + 99) / 100;
+  return p_sorted->p_usecs[rank ? rank - 1 : 0];
+}
+
+//---------------------------------------------------------
+static void print_times(FILE* p_out, const char* name, samples_t* p_samples)
+{
+  if (p_samples->count) {
+    qsort(p_samples->p_usecs, p_samples->count, sizeof(int64_t), compare_i64);
+  }
+  fprintf(p_out, "%-8s p50 %8lld  p95 %8lld  p99 %8lld  max %8lld us\n", name,
+          (long long)percentile(p_samples, 50),
+          (long long)percentile(p_samples, 95),
+          (long long)percentile(p_samples, 99),
+          (long long)percentile(p_samples, 100));
+}
+
+//---------------------------------------------------------
+static void usage()
+{
+  fprintf(stderr,
+          "usage: scenic_replay [-r] [-n passes] [-w width] [-h height]\n"
+          "                     [-t render_threads] [-l layer_cache_mb] [-f fbdev]\n"
+          "                     capture_file\n");
+}
+
+//---------------------------------------------------------
+int main(int argc, char **argv)
+{
+  driver_data_t data = {0};
+  bool f_real_time = false;
+  int passes = 1;
+
+  g_opts.global_opacity = 255;
+  g_opts.antialias = 1;
+  g_opts.fbdev = "/dev/fb0";
+  g_opts.vsync = 0;
+  g_opts.render_threads = 1;
+  g_opts.capture = "";
+  g_opts.title = "scenic_replay";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "rn:w:h:t:l:f:")) != -1) {
+    switch (opt) {
+    case 'r': f_real_time = true; break;
+    case 'n': passes = atoi(optarg); break;
+    case 'w': g_opts.width = atoi(optarg); break;
+    case 'h': g_opts.height = atoi(optarg); break;
+    case 't': g_opts.render_threads = atoi(optarg); break;
+    case 'l': g_opts.layer_cache = atoi(optarg); break;
+    case 'f': g_opts.fbdev = optarg; break;
+    default:
+      usage();
+      return 1;
+    }
+  }
+  if ((optind != argc - 1) || (passes < 1)) {
+    usage();
+    return 1;
+  }
+
+  FILE* p_in = fopen(argv[optind], "rb");
+  if (!p_in) {
+    fprintf(stderr, "scenic_replay: unable to open %s\n", argv[optind]);
+    return 1;
+  }
+
+  // the messages are read from stdin, as they are in the driver
+  FILE* p_messages = tmpfile();
+  capture_t capture = {0};
+  if (!p_messages || !read_capture(p_in, p_messages, &capture)) {
+    return 1;
+  }
+  fclose(p_in);
+  if (dup2(fileno(p_messages), STDIN_FILENO) < 0) {
+    fprintf(stderr, "scenic_replay: unable to read the messages back\n");
+    return 1;
+  }
+  lseek(STDIN_FILENO, 0, SEEK_SET);
+
+  // what the driver would send the caller goes nowhere. The report goes
+  // to where stdout was
+  FILE* p_report = fdopen(dup(STDOUT_FILENO), "w");
+  int null_fd = open("/dev/null", O_WRONLY);
+  if (!p_report || (null_fd < 0) || (dup2(null_fd, STDOUT_FILENO) < 0)) {
+    fprintf(stderr, "scenic_replay: unable to redirect stdout\n");
+    return 1;
+  }
+  close(null_fd);
+
+  if (!g_opts.width) g_opts.width = capture.header.width;
+  if (!g_opts.height) g_opts.height = capture.header.height;
+
+  init_ids();
+  init_scripts();
+  init_fonts();
+  init_images();
+
+  data.keep_going = true;
+
+  int err = device_init(&g_opts, &g_device_info, &data);
+  if (err) {
+    fprintf(stderr, "scenic_replay: failed to initialize the device: %d\n", err);
+    return err;
+  }
+  data.v_ctx = g_device_info.v_ctx;
+
+  samples_t frame_times = {0};
+  samples_t render_times = {0};
+  int64_t start = monotonic_time_us();
+  int64_t frame_start = -1;
+  uint32_t played = 0;
+  uint64_t bytes = 0;
+
+  for (int pass = 0; (pass < passes) && data.keep_going; pass++) {
+    // each pass reads the messages from the top again, not whatever
+    // the last pass left buffered
+    if (pass) {
+      if (lseek(STDIN_FILENO, 0, SEEK_SET) < 0) {
+        break;
+      }
+      reset_in();
+    }
+    int64_t pass_start = monotonic_time_us();
+
+    uint32_t n = 0;
+    for (; n < capture.count && data.keep_going; n++) {
+      if (f_real_time) {
+        sleep_until(pass_start + capture.p_times[n] - capture.p_times[0]);
+      }
+
+      struct timeval tv = {0};
+      int len = read_msg_length(&tv);
+      if (len <= 0) {
+        break;
+      }
+
+      bytes += len + sizeof(uint32_t);
+
+      int64_t now = monotonic_time_us();
+      if (frame_start < 0) {
+        frame_start = now;
+      }
+      dispatch_scenic_ops(len, &data);
+
+      if (data.f_render_pending) {
+        data.f_render_pending = false;
+        int64_t render_start = monotonic_time_us();
+        render(&data);
+        now = monotonic_time_us();
+        add_sample(&render_times, now - render_start);
+        add_sample(&frame_times, now - frame_start);
+        frame_start = -1;
+      }
+    }
+    played += n;
+    if (n < capture.count) {
+      break;
+    }
+  }
+
+  double secs = (monotonic_time_us() - start) / 1000000.0;
+
+  fprintf(p_report, "%u messages, %.1f MB, %u frames in %.3f s\n",
+          played, bytes / (1024.0 * 1024.0), frame_times.count, secs);
+  if (secs > 0) {
+    fprintf(p_report, "%.0f messages/s, %.1f MB/s, %.1f frames/s\n",
+            played / secs, bytes / (1024.0 * 1024.0) / secs,
+            frame_times.count / secs);
+  }
+  print_times(p_report, "frame", &frame_times);
+  print_times(p_report, "render", &render_times);
+  fclose(p_report);
+
+  reset_images(data.v_ctx);
+  shm_close_all();
+  device_close(&g_device_info);
+
+  free(frame_times.p_usecs);
+  free(render_times.p_usecs);
+  free(capture.p_times);
+  fclose(p_messages);
+
+  return 0;
+}
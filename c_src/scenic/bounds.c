@@ -0,0 +1,166 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#include <float.h>
+#include <math.h>
+
+#include "bounds.h"
+
+const matrix_t matrix_identity = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+const bbox_t bbox_empty = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+const bbox_t bbox_infinite = {-FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX};
+
+//=============================================================================
+// matrices
+
+//---------------------------------------------------------
+matrix_t matrix_multiply(matrix_t m, matrix_t n)
+{
+  return (matrix_t){
+    m.a * n.a + m.c * n.b,
+    m.b * n.a + m.d * n.b,
+    m.a * n.c + m.c * n.d,
+    m.b * n.c + m.d * n.d,
+    m.a * n.e + m.c * n.f + m.e,
+    m.b * n.e + m.d * n.f + m.f
+  };
+}
+
+//---------------------------------------------------------
+matrix_t matrix_translate(matrix_t m, float x, float y)
+{
+  m.e += m.a * x + m.c * y;
+  m.f += m.b * x + m.d * y;
+  return m;
+}
+
+//---------------------------------------------------------
+matrix_t matrix_scale(matrix_t m, float x, float y)
+{
+  m.a *= x;
+  m.b *= x;
+  m.c *= y;
+  m.d *= y;
+  return m;
+}
+
+//---------------------------------------------------------
+matrix_t matrix_rotate(matrix_t m, float radians)
+{
+  float s = sinf(radians);
+  float c = cosf(radians);
+  return matrix_multiply(m, (matrix_t){c, s, -s, c, 0.0f, 0.0f});
+}
+
+//---------------------------------------------------------
+// false if m squashes everything onto a line or a point
+bool matrix_invert(matrix_t m, matrix_t* p_out)
+{
+  float det = m.a * m.d - m.b * m.c;
+  if (fabsf(det) < 1e-12f) {
+    return false;
+  }
+
+  float inv = 1.0f / det;
+  *p_out = (matrix_t){
+    m.d * inv,
+    -m.b * inv,
+    -m.c * inv,
+    m.a * inv,
+    (m.c * m.f - m.d * m.e) * inv,
+    (m.b * m.e - m.a * m.f) * inv
+  };
+  return true;
+}
+
+//---------------------------------------------------------
+// largest singular value of the linear part
+float matrix_max_scale(matrix_t m)
+{
+  float t = m.a * m.a + m.b * m.b + m.c * m.c + m.d * m.d;
+  float det = m.a * m.d - m.b * m.c;
+  float root = sqrtf(fmaxf(t * t - 4.0f * det * det, 0.0f));
+  return sqrtf((t + root) / 2.0f);
+}
+
+//=============================================================================
+// boxes
+
+//---------------------------------------------------------
+bool bbox_is_empty(bbox_t box)
+{
+  return (box.x0 > box.x1) || (box.y0 > box.y1);
+}
+
+//---------------------------------------------------------
+bool bbox_is_infinite(bbox_t box)
+{
+  return (box.x0 <= -FLT_MAX) || (box.y0 <= -FLT_MAX)
+    || (box.x1 >= FLT_MAX) || (box.y1 >= FLT_MAX);
+}
+
+//---------------------------------------------------------
+bool bbox_intersects(bbox_t a, bbox_t b)
+{
+  return !bbox_is_empty(a) && !bbox_is_empty(b)
+    && (a.x0 <= b.x1) && (b.x0 <= a.x1)
+    && (a.y0 <= b.y1) && (b.y0 <= a.y1);
+}
+
+//---------------------------------------------------------
+bbox_t bbox_add_point(bbox_t box, float x, float y)
+{
+  if (x < box.x0) box.x0 = x;
+  if (y < box.y0) box.y0 = y;
+  if (x > box.x1) box.x1 = x;
+  if (y > box.y1) box.y1 = y;
+  return box;
+}
+
+//---------------------------------------------------------
+bbox_t bbox_union(bbox_t a, bbox_t b)
+{
+  if (bbox_is_empty(b)) return a;
+  if (bbox_is_empty(a)) return b;
+  return (bbox_t){
+    fminf(a.x0, b.x0), fminf(a.y0, b.y0),
+    fmaxf(a.x1, b.x1), fmaxf(a.y1, b.y1)
+  };
+}
+
+//---------------------------------------------------------
+bbox_t bbox_intersect(bbox_t a, bbox_t b)
+{
+  return (bbox_t){
+    fmaxf(a.x0, b.x0), fmaxf(a.y0, b.y0),
+    fminf(a.x1, b.x1), fminf(a.y1, b.y1)
+  };
+}
+
+//---------------------------------------------------------
+bbox_t bbox_pad(bbox_t box, float pad)
+{
+  if (bbox_is_empty(box) || bbox_is_infinite(box)) return box;
+  return (bbox_t){box.x0 - pad, box.y0 - pad, box.x1 + pad, box.y1 + pad};
+}
+
+//---------------------------------------------------------
+// box around the four transformed corners
+bbox_t bbox_transform(matrix_t m, bbox_t box)
+{
+  if (bbox_is_empty(box) || bbox_is_infinite(box)) return box;
+
+  bbox_t out = bbox_empty;
+  out = bbox_add_point(out, m.a * box.x0 + m.c * box.y0 + m.e,
+                            m.b * box.x0 + m.d * box.y0 + m.f);
+  out = bbox_add_point(out, m.a * box.x1 + m.c * box.y0 + m.e,
+                            m.b * box.x1 + m.d * box.y0 + m.f);
+  out = bbox_add_point(out, m.a * box.x0 + m.c * box.y1 + m.e,
+                            m.b * box.x0 + m.d * box.y1 + m.f);
+  out = bbox_add_point(out, m.a * box.x1 + m.c * box.y1 + m.e,
+                            m.b * box.x1 + m.d * box.y1 + m.f);
+  return out;
+}
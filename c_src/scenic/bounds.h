@@ -0,0 +1,46 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// 2D affine matrices and axis aligned boxes used to work out where
+// scripts land on screen without asking the renderer.
+
+#pragma once
+
+#include "scenic_types.h"
+
+// same layout and meaning as cairo_matrix_t and the nanovg xform:
+//   x' = a * x + c * y + e
+//   y' = b * x + d * y + f
+typedef struct {
+  float a;
+  float b;
+  float c;
+  float d;
+  float e;
+  float f;
+} matrix_t;
+
+extern const matrix_t matrix_identity;
+extern const bbox_t bbox_empty;
+extern const bbox_t bbox_infinite;
+
+// the matrix that applies n first, then m
+matrix_t matrix_multiply(matrix_t m, matrix_t n);
+matrix_t matrix_translate(matrix_t m, float x, float y);
+matrix_t matrix_scale(matrix_t m, float x, float y);
+matrix_t matrix_rotate(matrix_t m, float radians);
+bool matrix_invert(matrix_t m, matrix_t* p_out);
+// upper bound on how much m can stretch a distance
+float matrix_max_scale(matrix_t m);
+
+bool bbox_is_empty(bbox_t box);
+bool bbox_is_infinite(bbox_t box);
+bool bbox_intersects(bbox_t a, bbox_t b);
+bbox_t bbox_add_point(bbox_t box, float x, float y);
+bbox_t bbox_union(bbox_t a, bbox_t b);
+bbox_t bbox_intersect(bbox_t a, bbox_t b);
+bbox_t bbox_pad(bbox_t box, float pad);
+bbox_t bbox_transform(matrix_t m, bbox_t box);
@@ -0,0 +1,100 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Writes every message from the caller to a file as it is read, with
+// when it came, so a session can be played back later by scenic_replay.
+// This reproduces what a device drew and how fast without the app that
+// drew it.
+//
+// Images put through shared memory are captured as the message that
+// names them, not their pixels, so they are missing on playback.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "comms.h"
+
+#define CAPTURE_BUFFER_SIZE (1024 * 1024)
+
+bool g_capturing = false;
+
+static FILE* p_capture = NULL;
+static int64_t capture_start = 0;
+
+//---------------------------------------------------------
+static void capture_failed()
+{
+  log_error("Unable to write the capture file, capturing stopped");
+  stop_capture();
+}
+
+//---------------------------------------------------------
+// an empty path captures nothing
+void start_capture(const char* path, uint32_t width, uint32_t height)
+{
+  if (!path || !path[0]) {
+    return;
+  }
+
+  p_capture = fopen(path, "wb");
+  if (!p_capture) {
+    log_error("Unable to open capture file %s", path);
+    return;
+  }
+  setvbuf(p_capture, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+  capture_header_t header = {
+    .version = CAPTURE_VERSION,
+    .width = width,
+    .height = height
+  };
+  memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+
+  capture_start = monotonic_time_us();
+  g_capturing = true;
+  capture_write(&header, sizeof(capture_header_t));
+}
+
+//---------------------------------------------------------
+void stop_capture()
+{
+  g_capturing = false;
+  if (p_capture) {
+    fclose(p_capture);
+    p_capture = NULL;
+  }
+}
+
+//---------------------------------------------------------
+// Written out between batches of messages, so that little is lost if
+// the driver is killed
+void flush_capture()
+{
+  if (g_capturing && fflush(p_capture)) {
+    capture_failed();
+  }
+}
+
+//---------------------------------------------------------
+// the time is only written once the length is in, so a capture cut off
+// while waiting for the next message doesn't end in half a record
+void capture_write_message(const uint8_t* p_length)
+{
+  int64_t usecs = monotonic_time_us() - capture_start;
+  capture_write(&usecs, sizeof(int64_t));
+  if (g_capturing) {
+    capture_write(p_length, sizeof(uint32_t));
+  }
+}
+
+//---------------------------------------------------------
+void capture_write(const void* p_bytes, uint32_t size)
+{
+  if (size && (fwrite(p_bytes, size, 1, p_capture) != 1)) {
+    capture_failed();
+  }
+}
@@ -0,0 +1,54 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "scenic_types.h"
+
+// A capture file starts with this header. Then, for each message from
+// the caller, comes the microseconds since the capture started as a
+// native int64_t, followed by the message exactly as it arrived: its big
+// endian length and then its bytes.
+#define CAPTURE_MAGIC "SCENICAP"
+#define CAPTURE_VERSION 1
+
+PACK(typedef struct capture_header_t
+{
+  char magic[8];
+  uint32_t version;
+  // the size of the picture the messages were drawing
+  uint32_t width;
+  uint32_t height;
+}) capture_header_t;
+
+// set while the messages from the caller are being written to a file
+extern bool g_capturing;
+
+void start_capture(const char* path, uint32_t width, uint32_t height);
+void stop_capture();
+void flush_capture();
+
+void capture_write_message(const uint8_t* p_length);
+void capture_write(const void* p_bytes, uint32_t size);
+
+// Called with each message's length as it is read, and with each run of
+// its bytes as they are taken from stdin
+static inline void capture_message(const uint8_t* p_length)
+{
+  if (g_capturing) {
+    capture_write_message(p_length);
+  }
+}
+
+static inline void capture_bytes(const void* p_bytes, uint32_t size)
+{
+  if (g_capturing) {
+    capture_write(p_bytes, size);
+  }
+}
@@ -14,11 +14,16 @@ The caller will typically be erlang, so use the 2-byte length indicator
 #include <time.h>
 #include <unistd.h>
 
+#include "bounds.h"
+#include "capture.h"
 #include "device.h"
 #include "font.h"
+#include "ids.h"
 #include "image.h"
 #include "scenic_ops.h"
 #include "script.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
 
 // Setting the timeout too high means input will be laggy as you
@@ -74,6 +79,35 @@ bool read_bytes_down(void* p_buff, int bytes_to_read, uint32_t* p_bytes_to_remai
   return true;
 }
 
+//---------------------------------------------------------
+// Like read_bytes_down, but hands back the bytes where they sit in the
+// input buffer instead of copying them out. The pointer is only good
+// until the next read, and is not aligned.
+void* read_bytes_in_place(uint32_t bytes_to_read, uint32_t* p_bytes_to_remaining)
+{
+  if (bytes_to_read > *p_bytes_to_remaining)
+    return NULL;
+
+  void* p = read_in_place(bytes_to_read);
+  if (p)
+    *p_bytes_to_remaining -= bytes_to_read;
+  return p;
+}
+
+//---------------------------------------------------------
+// Throws away the rest of a message a bit at a time, so a bad length
+// never makes the input buffer grow to hold it.
+void skip_bytes_down(uint32_t* p_bytes_to_remaining)
+{
+  while (*p_bytes_to_remaining) {
+    uint32_t chunk = *p_bytes_to_remaining;
+    if (chunk > 4096)
+      chunk = 4096;
+    if (!read_bytes_in_place(chunk, p_bytes_to_remaining))
+      return;
+  }
+}
+
 //=============================================================================
 // send messages up to caller
 
@@ -397,6 +431,74 @@ void receive_crash()
 }
 
 
+//---------------------------------------------------------
+// set when something outside of the scripts changes what is on screen,
+// such as the global transform, the cursor or the window itself
+static bool f_frame_invalid = true;
+
+void invalidate_frame()
+{
+  f_frame_invalid = true;
+}
+
+//---------------------------------------------------------
+// The area of the frame that will actually be painted, in script
+// coordinates. The nanovg devices apply the global transform and the
+// cairo ones don't (and leave it zeroed), so the window is covered both
+// ways.
+static bbox_t render_view(driver_data_t* p_data)
+{
+  if (g_device_info.width <= 0 || g_device_info.height <= 0) {
+    return bbox_infinite;
+  }
+
+  bbox_t window = {0, 0, g_device_info.width, g_device_info.height};
+  matrix_t global = {
+    p_data->global_tx[0], p_data->global_tx[1],
+    p_data->global_tx[2], p_data->global_tx[3],
+    p_data->global_tx[4], p_data->global_tx[5]
+  };
+  bbox_t view = window;
+  matrix_t inverse;
+  if (matrix_invert(global, &inverse)) {
+    view = bbox_union(view, bbox_transform(inverse, window));
+  }
+  if (g_device_info.f_partial_render) {
+    view = bbox_intersect(view, p_data->damage);
+  }
+  return view;
+}
+
+//---------------------------------------------------------
+// the ids of the root scene and cursor, interned once on the first
+// render. They are held for the life of the driver
+static sid_t root_id = {0};
+static sid_t cursor_id = {0};
+
+//---------------------------------------------------------
+// Draw the scene into p_data->v_ctx. Scripts that land outside of view
+// are skipped. Devices that split the frame up call this once per part,
+// each with its own context and view.
+void render_scene(driver_data_t* p_data, bbox_t view)
+{
+  // render the root script
+  begin_script_render(view, 0, 0);
+  render_script(p_data->v_ctx, root_id);
+
+  // render the cursor if one is provided
+  if (p_data->f_show_cursor) {
+    device_begin_cursor_render(p_data);
+    begin_script_render(view, p_data->cursor_pos[0], p_data->cursor_pos[1]);
+    render_script(p_data->v_ctx, cursor_id);
+  }
+}
+
+__attribute__((weak))
+void device_render_scene(driver_data_t* p_data, bbox_t view)
+{
+  render_scene(p_data, view);
+}
+
 //---------------------------------------------------------
 void render(driver_data_t* p_data)
 {
@@ -405,30 +507,73 @@ void render(driver_data_t* p_data)
   static int64_t time_remaining = -1;
   static clock_t render_fps = 0;
   static uint32_t frames = 0;
+  static uint32_t frames_dropped = 0;
 
   clock_t begin_frame = clock();
+  int64_t phase_start = monotonic_time_us();
+  int64_t phase_usecs[stats_phase_count] = {0};
+
+  if (!root_id.handle) {
+    root_id = intern_id((sid_t){"_root_", strlen("_root_"), 0});
+  }
+  if (!cursor_id.handle) {
+    cursor_id = intern_id((sid_t){"_cursor_", strlen("_cursor_"), 0});
+  }
+
+  // drop the offscreen layers of scripts that changed since the last frame
+  begin_script_layers(p_data->v_ctx);
+
+  // if nothing that is drawn has changed, the last frame is still on
+  // screen. Skip the repaint but still tell the caller we are ready
+  bool changed = f_frame_invalid
+    || script_changed(root_id)
+    || (p_data->f_show_cursor && script_changed(cursor_id));
+  if (!changed) {
+    clear_dirty_ids();
+    stats_skip_frame();
+    send_ready();
+    return;
+  }
+
+  // work out which part of the frame the changes cover. The walk also
+  // records where everything landed, for the next frame's damage
+  bbox_t damage;
+  start_script_damage(&damage);
+  add_script_damage(root_id, 0, 0, &damage);
+  if (p_data->f_show_cursor) {
+    add_script_damage(cursor_id,
+                      p_data->cursor_pos[0], p_data->cursor_pos[1],
+                      &damage);
+  }
+  clear_dirty_ids();
+
+  // pad a little for antialiasing at the edges
+  p_data->damage = f_frame_invalid ? bbox_infinite : bbox_pad(damage, 2.0f);
+  f_frame_invalid = false;
 
-  // prep the id to the root scene
-  sid_t id;
-  id.p_data = "_root_";
-  id.size = strlen(id.p_data);
+  int64_t now = monotonic_time_us();
+  phase_usecs[stats_phase_interpret] = now - phase_start;
+  phase_start = now;
 
   // render the scene
+  int64_t trace_start = trace_begin();
   device_begin_render(p_data);
+  trace_end(trace_start, trace_begin_render, 0, NULL, 0);
 
-  // render the root script
-  render_script(p_data->v_ctx, id);
+  trace_start = trace_begin();
+  device_render_scene(p_data, render_view(p_data));
+  trace_end(trace_start, trace_render_scene, 0, NULL, 0);
 
-  // render the cursor if one is provided
-  if (p_data->f_show_cursor) {
-    device_begin_cursor_render(p_data);
-
-    id.p_data = "_cursor_";
-    id.size = strlen(id.p_data);
-    render_script(p_data->v_ctx, id);
-  }
+  now = monotonic_time_us();
+  phase_usecs[stats_phase_backend] = now - phase_start;
+  phase_start = now;
 
+  trace_start = trace_begin();
   device_end_render(p_data);
+  trace_end(trace_start, trace_end_render, 0, NULL, 0);
+
+  phase_usecs[stats_phase_present] = monotonic_time_us() - phase_start;
+  stats_add_frame(phase_usecs);
   clock_t end_frame = clock();
   clock_t delta_ticks = end_frame - begin_frame;
 
@@ -445,22 +590,37 @@ void render(driver_data_t* p_data)
   time_remaining -= delta_real;
 
   if ((g_opts.debug_fps > 0) && (time_remaining <= 0)) {
-    log_info("real_fps: %d", frames);
+    log_info("real_fps: %d, dropped: %d",
+             frames, p_data->frames_dropped - frames_dropped);
     start_real = monotonic_time();
     time_remaining = 1000;
     frames = 0;
+    frames_dropped = p_data->frames_dropped;
   }
 
   // all done
   send_ready();
 }
 
+//---------------------------------------------------------
+// Renders are held until the input that is already waiting has been
+// applied, so a host that gets ahead of the display only pays for one
+// frame of the newest state. The ones skipped are counted as dropped.
+void request_render(driver_data_t* p_data)
+{
+  if (p_data->f_render_pending) {
+    p_data->frames_dropped++;
+  }
+  p_data->f_render_pending = true;
+}
+
 //---------------------------------------------------------
 void set_global_tx(uint32_t* p_msg_length, driver_data_t* p_data)
 {
   for (int i = 0; i < 6; i++) {
     read_bytes_down(&p_data->global_tx[i], sizeof(float), p_msg_length);
   }
+  invalidate_frame();
 }
 
 //---------------------------------------------------------
@@ -469,15 +629,27 @@ void set_cursor_tx(uint32_t* p_msg_length, driver_data_t* p_data)
   for (int i = 0; i < 6; i++) {
     read_bytes_down(&p_data->cursor_tx[i], sizeof(float), p_msg_length);
   }
+  invalidate_frame();
 }
 
 //---------------------------------------------------------
 void update_cursor(uint32_t* p_msg_length, driver_data_t* p_data)
 {
+  uint32_t was_shown = p_data->f_show_cursor;
+  float x = p_data->cursor_pos[0];
+  float y = p_data->cursor_pos[1];
+
   read_bytes_down(&p_data->f_show_cursor, sizeof(uint32_t), p_msg_length);
   for (int i = 0; i < 2; i++) {
     read_bytes_down(&p_data->cursor_pos[i], sizeof(float), p_msg_length);
   }
+
+  // a hidden cursor can move without needing a repaint
+  if ((was_shown != p_data->f_show_cursor)
+      || (p_data->f_show_cursor
+          && (x != p_data->cursor_pos[0] || y != p_data->cursor_pos[1]))) {
+    invalidate_frame();
+  }
 }
 
 //---------------------------------------------------------
@@ -489,6 +661,7 @@ void clear_color(uint32_t* p_msg_length)
   read_bytes_down(&b, 1, p_msg_length);
   read_bytes_down(&a, 1, p_msg_length);
   device_clear_color(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+  invalidate_frame();
 }
 
 //=============================================================================
@@ -504,6 +677,13 @@ int64_t monotonic_time()
     return mt_msecs;
 }
 
+int64_t monotonic_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 // read from the stdio in buffer and act on one message.
 void handle_stdio_in(driver_data_t* p_data)
 {
@@ -512,16 +692,28 @@ void handle_stdio_in(driver_data_t* p_data)
 
   struct timeval tv;
   while (time_remaining > 0) {
+    // while a render is waiting, only take messages that are already here
     tv.tv_sec  = 0;
-    tv.tv_usec = time_remaining;
+    tv.tv_usec = p_data->f_render_pending ? 0 : time_remaining;
 
     int len = read_msg_length(&tv);
     if (len <= 0) break;
 
     // process the message
+    int64_t dispatch_start = monotonic_time_us();
     dispatch_scenic_ops(len, p_data);
+    stats_add_ingest(monotonic_time_us() - dispatch_start, len + sizeof(uint32_t));
 
     // see if time is remaining, so we can process another one
     time_remaining -= monotonic_time() - start;
   }
+
+  // one frame for everything that came in. It also sends the ready
+  if (p_data->f_render_pending && p_data->keep_going) {
+    p_data->f_render_pending = false;
+    render(p_data);
+  }
+
+  poll_stats(p_data);
+  flush_capture();
 }
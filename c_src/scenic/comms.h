@@ -66,6 +66,8 @@ typedef enum {
   MSG_OUT_RESHAPE = 0X05,
   MSG_OUT_READY = 0X06,
   MSG_OUT_DRAW_READY = 0X07,
+  MSG_OUT_PROFILE = 0X08,
+  MSG_OUT_SHM_DONE = 0X09,
 
   MSG_OUT_KEY = 0X0A,
   MSG_OUT_CODEPOINT = 0X0B,
@@ -95,12 +97,17 @@ typedef enum {
 } keymap_t;
 
 int read_exact(uint8_t* buf, int len);
+void* read_in_place(uint32_t len);
+void reset_in();
 int write_exact(uint8_t* buf, int len);
+int write_cmd(uint8_t* buf, uint32_t len);
 int read_msg_length(struct timeval * ptv);
 bool isCallerDown();
 
 bool read_bytes_down(void* p_buff, int bytes_to_read,
                      uint32_t* p_bytes_to_remaining);
+void* read_bytes_in_place(uint32_t bytes_to_read, uint32_t* p_bytes_to_remaining);
+void skip_bytes_down(uint32_t* p_bytes_to_remaining);
 
 // basic events to send up to the caller
 void send_puts(const char* msg, ...);
@@ -127,6 +134,9 @@ void clear_color(uint32_t* p_msg_length);
 void receive_crash();
 void receive_quit(driver_data_t* p_data);
 void render(driver_data_t* p_data);
+void render_scene(driver_data_t* p_data, bbox_t view);
+void request_render(driver_data_t* p_data);
+void invalidate_frame();
 
 void send_image_miss(unsigned int img_id);
 
@@ -143,3 +153,4 @@ void send_ready();
 void handle_stdio_in(driver_data_t* p_data);
 
 int64_t monotonic_time();
+int64_t monotonic_time_us();
@@ -0,0 +1,219 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#include <string.h>
+
+#include "common.h"
+#include "ids.h"
+#include "tommyhashlin.h"
+
+#define HASH_ID(id)  tommy_hash_u32( 0, id.p_data, id.size )
+
+//---------------------------------------------------------
+typedef struct {
+  sid_t id;
+  uint32_t ref_count;
+  uint32_t dirty_mark;
+  void* slots[ID_SLOT_COUNT];
+  tommy_hashlin_node node;
+} id_entry_t;
+
+tommy_hashlin   ids = {0};
+
+// entries indexed by handle. Handle 0 is never used so a zeroed
+// sid_t always means "not interned"
+static id_entry_t** p_entries = NULL;
+static uint32_t entries_size = 0;
+
+// handles released back to the table, reused before growing it
+static uint32_t* p_free_handles = NULL;
+static uint32_t free_count = 0;
+static uint32_t free_capacity = 0;
+static uint32_t next_handle = 1;
+
+// an entry is dirty when its mark matches the current generation.
+// Moving to the next generation clears every mark at once
+static uint32_t dirty_generation = 1;
+static bool f_any_dirty = false;
+
+//---------------------------------------------------------
+void init_ids( void ) {
+  // init the hash table
+  tommy_hashlin_init( &ids );
+}
+
+//=============================================================================
+// internal utilities for working with the id hash
+
+//---------------------------------------------------------
+static int _comparator(const void* p_arg, const void* p_obj)
+{
+  const sid_t* p_id = p_arg;
+  const id_entry_t* p_entry = p_obj;
+  return (p_id->size != p_entry->id.size)
+    || memcmp(p_id->p_data, p_entry->id.p_data, p_id->size);
+}
+
+//---------------------------------------------------------
+static inline id_entry_t* get_entry(sid_t id)
+{
+  if (id.handle && id.handle < entries_size) {
+    return p_entries[id.handle];
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------
+static uint32_t alloc_handle(void)
+{
+  if (free_count) {
+    return p_free_handles[--free_count];
+  }
+
+  if (next_handle >= entries_size) {
+    uint32_t size = entries_size ? entries_size * 2 : 256;
+    id_entry_t** p = realloc(p_entries, size * sizeof(id_entry_t*));
+    if (!p) {
+      log_error("Unable to grow the id table");
+      return 0;
+    }
+    memset(p + entries_size, 0, (size - entries_size) * sizeof(id_entry_t*));
+    p_entries = p;
+    entries_size = size;
+  }
+
+  return next_handle++;
+}
+
+//---------------------------------------------------------
+static void free_handle(uint32_t handle)
+{
+  // there can never be more free handles than the table has entries
+  if (free_capacity < entries_size) {
+    uint32_t* p = realloc(p_free_handles, entries_size * sizeof(uint32_t));
+    if (!p) {
+      // leak the handle rather than fail. It just won't be reused
+      return;
+    }
+    p_free_handles = p;
+    free_capacity = entries_size;
+  }
+  p_free_handles[free_count++] = handle;
+}
+
+//=============================================================================
+// public api
+
+//---------------------------------------------------------
+sid_t intern_id(sid_t id)
+{
+  // a handle is only a hint. One left over from another id must not
+  // take that id's entry
+  id_entry_t* p_entry = get_entry(id);
+  if (p_entry && _comparator(&id, p_entry)) {
+    p_entry = NULL;
+  }
+
+  if (!p_entry) {
+    p_entry = tommy_hashlin_search(&ids, _comparator, &id, HASH_ID(id));
+  }
+
+  if (!p_entry) {
+    // the +1 is so the id is null terminated
+    int struct_size = ALIGN_UP(sizeof(id_entry_t), 8);
+    p_entry = calloc(1, struct_size + id.size + 1);
+    if (!p_entry) {
+      log_error("Unable to allocate id");
+      id.handle = 0;
+      return id;
+    }
+
+    p_entry->id.size = id.size;
+    p_entry->id.p_data = ((void*)p_entry) + struct_size;
+    memcpy(p_entry->id.p_data, id.p_data, id.size);
+
+    p_entry->id.handle = alloc_handle();
+    if (!p_entry->id.handle) {
+      free(p_entry);
+      id.handle = 0;
+      return id;
+    }
+
+    p_entries[p_entry->id.handle] = p_entry;
+    tommy_hashlin_insert(&ids, &p_entry->node, p_entry, HASH_ID(p_entry->id));
+  }
+
+  p_entry->ref_count++;
+  return p_entry->id;
+}
+
+//---------------------------------------------------------
+void release_id(sid_t id)
+{
+  id_entry_t* p_entry = get_entry(id);
+  if (!p_entry || !p_entry->ref_count) {
+    return;
+  }
+
+  if (--p_entry->ref_count) {
+    return;
+  }
+
+  // nothing holds the handle any more. Resources hold a reference on
+  // their own id, so the slots are already empty.
+  tommy_hashlin_remove_existing(&ids, &p_entry->node);
+  p_entries[p_entry->id.handle] = NULL;
+  free_handle(p_entry->id.handle);
+  free(p_entry);
+}
+
+//---------------------------------------------------------
+void* get_id_slot(sid_t id, id_slot_t slot)
+{
+  id_entry_t* p_entry = get_entry(id);
+  return p_entry ? p_entry->slots[slot] : NULL;
+}
+
+//---------------------------------------------------------
+void set_id_slot(sid_t id, id_slot_t slot, void* p_resource)
+{
+  id_entry_t* p_entry = get_entry(id);
+  if (p_entry) {
+    p_entry->slots[slot] = p_resource;
+  }
+}
+
+//---------------------------------------------------------
+void mark_id_dirty(sid_t id)
+{
+  id_entry_t* p_entry = get_entry(id);
+  if (p_entry) {
+    p_entry->dirty_mark = dirty_generation;
+    f_any_dirty = true;
+  }
+}
+
+//---------------------------------------------------------
+bool is_id_dirty(sid_t id)
+{
+  id_entry_t* p_entry = get_entry(id);
+  return p_entry && (p_entry->dirty_mark == dirty_generation);
+}
+
+//---------------------------------------------------------
+bool any_ids_dirty(void)
+{
+  return f_any_dirty;
+}
+
+//---------------------------------------------------------
+void clear_dirty_ids(void)
+{
+  if (f_any_dirty) {
+    dirty_generation++;
+    f_any_dirty = false;
+  }
+}
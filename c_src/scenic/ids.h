@@ -0,0 +1,42 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Driver-wide table of interned ids. Every script, image and font id
+// that the driver sees gets a small integer handle the first time it
+// is interned. Each handle owns one slot per resource kind, so code that
+// holds an interned sid_t can find the resource without hashing the
+// string again. Slots are updated in place when a resource is replaced
+// or deleted, so interned references never go stale.
+
+#pragma once
+
+#include "scenic_types.h"
+
+typedef enum {
+  ID_SLOT_SCRIPT = 0,
+  ID_SLOT_IMAGE,
+  ID_SLOT_FONT,
+  ID_SLOT_PROFILE,
+  ID_SLOT_COUNT
+} id_slot_t;
+
+void init_ids(void);
+
+// take a reference on an id, creating its handle if needed. The returned
+// sid_t points at the table's own copy of the string and stays valid
+// until the matching release_id.
+sid_t intern_id(sid_t id);
+void release_id(sid_t id);
+
+void* get_id_slot(sid_t id, id_slot_t slot);
+void set_id_slot(sid_t id, id_slot_t slot, void* p_resource);
+
+// change tracking. An id is marked when whatever it names is stored,
+// replaced or deleted, and stays marked until the next frame is drawn
+void mark_id_dirty(sid_t id);
+bool is_id_dirty(sid_t id);
+bool any_ids_dirty(void);
+void clear_dirty_ids(void);
@@ -0,0 +1,31 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Offscreen layers that a script can be drawn into once and then put on
+// screen as a single image. Each device keeps its own kind of layer
+// behind the void pointer. A device that can't make one returns NULL
+// from layer_ops_create and the scripts are drawn directly.
+
+#pragma once
+
+#include <stdint.h>
+
+void* layer_ops_create(void* v_ctx, uint32_t width, uint32_t height);
+void layer_ops_delete(void* v_ctx, void* v_layer);
+
+// Starts drawing into the layer. Returns the context to draw with, with
+// the layer cleared and a fresh state whose units are layer pixels, or
+// NULL if the layer can't be drawn into right now.
+void* layer_ops_begin(void* v_ctx, void* v_layer);
+void layer_ops_end(void* v_ctx, void* v_layer, void* v_layer_ctx);
+
+// draws the whole layer into the rectangle x,y,w,h under the current
+// transform and clip
+void layer_ops_draw(void* v_ctx, void* v_layer, float x, float y, float w, float h);
+
+// device pixels per unit under the current transform, which is the scale
+// a layer needs to be drawn at to look the same as drawing directly
+float layer_ops_scale(void* v_ctx);
@@ -0,0 +1,336 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Where the time drawing scripts goes, for finding the scripts and ops a
+// scene should change to draw faster. While profiling, every script op
+// that is run is counted and timed, and so is every script. The caller
+// asks for the hottest of them, which come back as MSG_OUT_PROFILE.
+//
+// An op's time runs from the end of the op before it to its own end, so
+// the ops of a script add up to the time spent in the script itself. The
+// scripts a script draws are left out of its draw_script op and counted
+// as their own. Scripts are timed both with and without what they draw.
+//
+// Cairo draws bands of the frame on several threads, so the counts are
+// added atomically and the script being drawn is tracked per thread.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comms.h"
+#include "ids.h"
+#include "profile.h"
+#include "script_ops.h"
+#include "trace.h"
+
+// script_op_t fits in a byte
+#define PROFILE_OPS 256
+
+typedef struct _profile_script_t {
+  sid_t id;
+  uint64_t calls;
+  // with and without the scripts it draws
+  int64_t total_ticks;
+  int64_t self_ticks;
+  struct _profile_script_t* p_next;
+} profile_script_t;
+
+typedef struct {
+  uint64_t count;
+  int64_t ticks;
+} profile_op_t;
+
+volatile bool g_profiling = false;
+
+static struct {
+  profile_op_t ops[PROFILE_OPS];
+  // every script seen since profiling started
+  profile_script_t* p_scripts;
+  uint32_t script_count;
+  // the counter and the clock when profiling started, which give the
+  // counter's rate when the profile is sent
+  int64_t start_ticks;
+  int64_t start_ns;
+  // the counter when profiling stopped, or 0 while it runs
+  int64_t stop_ticks;
+} g_profile = {0};
+
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// the script being drawn on this thread and when the last op finished
+static __thread profile_frame_t* p_current = NULL;
+static __thread int64_t last_ticks = 0;
+
+//---------------------------------------------------------
+// Scripts are found through their id's profile slot. The first thread to
+// draw a script makes its entry. The entry holds a reference on the id, so
+// it outlives the script and the id is already interned, so taking the
+// reference doesn't change the id table under the other threads.
+static profile_script_t* get_profile_script(sid_t id)
+{
+  profile_script_t* p_script = get_id_slot(id, ID_SLOT_PROFILE);
+  if (p_script) {
+    // pairs with the release before set_id_slot, so the entry is seen whole
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return p_script;
+  }
+
+  pthread_mutex_lock(&profile_mutex);
+  p_script = get_id_slot(id, ID_SLOT_PROFILE);
+  if (!p_script) {
+    p_script = calloc(1, sizeof(profile_script_t));
+    if (p_script) {
+      p_script->id = intern_id(id);
+      p_script->p_next = g_profile.p_scripts;
+      g_profile.p_scripts = p_script;
+      g_profile.script_count++;
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      set_id_slot(id, ID_SLOT_PROFILE, p_script);
+    }
+  }
+  pthread_mutex_unlock(&profile_mutex);
+
+  return p_script;
+}
+
+//---------------------------------------------------------
+bool profile_enter(profile_frame_t* p_frame, sid_t id)
+{
+  if (!g_profiling || !id.handle) {
+    return false;
+  }
+
+  p_frame->p_script = get_profile_script(id);
+  if (!p_frame->p_script) {
+    return false;
+  }
+
+  int64_t now = trace_now();
+  p_frame->p_parent = p_current;
+  p_frame->start = now;
+  p_frame->child_ticks = 0;
+  p_frame->pending_ticks = 0;
+
+  // the parent is part way through its draw_script op
+  if (p_current) {
+    p_current->pending_ticks += now - last_ticks;
+  }
+  p_current = p_frame;
+  last_ticks = now;
+  return true;
+}
+
+//---------------------------------------------------------
+void profile_op(profile_frame_t* p_frame, uint32_t op)
+{
+  int64_t now = trace_now();
+  profile_op_t* p_op = &g_profile.ops[op % PROFILE_OPS];
+  __atomic_fetch_add(&p_op->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&p_op->ticks, now - last_ticks + p_frame->pending_ticks,
+                     __ATOMIC_RELAXED);
+  p_frame->pending_ticks = 0;
+  last_ticks = now;
+}
+
+//---------------------------------------------------------
+void profile_exit(profile_frame_t* p_frame)
+{
+  int64_t now = trace_now();
+  int64_t total = now - p_frame->start;
+  profile_script_t* p_script = p_frame->p_script;
+  __atomic_fetch_add(&p_script->calls, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&p_script->total_ticks, total, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&p_script->self_ticks, total - p_frame->child_ticks,
+                     __ATOMIC_RELAXED);
+
+  p_current = p_frame->p_parent;
+  if (p_current) {
+    p_current->child_ticks += total;
+  }
+  last_ticks = now;
+}
+
+//---------------------------------------------------------
+static void reset_profile()
+{
+  profile_script_t* p_script = g_profile.p_scripts;
+  while (p_script) {
+    profile_script_t* p_next = p_script->p_next;
+    set_id_slot(p_script->id, ID_SLOT_PROFILE, NULL);
+    release_id(p_script->id);
+    free(p_script);
+    p_script = p_next;
+  }
+  memset(&g_profile, 0, sizeof(g_profile));
+}
+
+//---------------------------------------------------------
+// The message carries 1 to start profiling afresh or 0 to stop. What was
+// gathered is kept after stopping so it can still be asked for
+void start_profile(uint32_t* p_msg_length)
+{
+  uint32_t on = 0;
+  read_bytes_down(&on, sizeof(uint32_t), p_msg_length);
+
+  if (on) {
+    reset_profile();
+    g_profile.start_ticks = trace_now();
+    g_profile.start_ns = trace_clock_ns();
+    g_profiling = true;
+  } else if (g_profiling) {
+    g_profiling = false;
+    g_profile.stop_ticks = trace_now();
+  }
+}
+
+//---------------------------------------------------------
+static int compare_ops(const void* p_a, const void* p_b)
+{
+  int64_t a = (*(const profile_op_t* const*)p_a)->ticks;
+  int64_t b = (*(const profile_op_t* const*)p_b)->ticks;
+  return (a < b) - (a > b);
+}
+
+//---------------------------------------------------------
+static int compare_scripts(const void* p_a, const void* p_b)
+{
+  int64_t a = (*(const profile_script_t* const*)p_a)->self_ticks;
+  int64_t b = (*(const profile_script_t* const*)p_b)->self_ticks;
+  return (a < b) - (a > b);
+}
+
+//---------------------------------------------------------
+static uint8_t* put_u32(uint8_t* p, uint32_t value)
+{
+  memcpy(p, &value, sizeof(uint32_t));
+  return p + sizeof(uint32_t);
+}
+
+//---------------------------------------------------------
+static uint8_t* put_u64(uint8_t* p, uint64_t value)
+{
+  memcpy(p, &value, sizeof(uint64_t));
+  return p + sizeof(uint64_t);
+}
+
+//---------------------------------------------------------
+// the ops' names without the prefix they all share
+static const char* op_name(uint32_t op)
+{
+  const char* p_name = script_op_to_string(op);
+  const char* p_prefix = "script_op_";
+  if (!strncmp(p_name, p_prefix, strlen(p_prefix))) {
+    return p_name + strlen(p_prefix);
+  }
+  return p_name;
+}
+
+//---------------------------------------------------------
+// The message carries how many of the hottest ops and scripts to send.
+// MSG_OUT_PROFILE is
+//   u64 nanoseconds profiled
+//   u32 op count, then for each op from the hottest down
+//     u32 name size, the name, u64 times run, u64 nanoseconds
+//   u32 script count, then for each script from the most time in itself
+//     u32 id size, the id, u64 times drawn, u64 nanoseconds with the
+//     scripts it draws, u64 nanoseconds in itself
+void query_profile(uint32_t* p_msg_length)
+{
+  uint32_t top_n = 0;
+  read_bytes_down(&top_n, sizeof(uint32_t), p_msg_length);
+
+  int64_t now = trace_now();
+  int64_t end = g_profile.stop_ticks ? g_profile.stop_ticks : now;
+  int64_t elapsed_ns = 0;
+  double ns_per_tick = 1.0;
+  if (g_profile.start_ticks) {
+    int64_t ticks = now - g_profile.start_ticks;
+    if (ticks > 0) {
+      ns_per_tick = (double)(trace_clock_ns() - g_profile.start_ns) / ticks;
+    }
+    elapsed_ns = (end - g_profile.start_ticks) * ns_per_tick;
+  }
+
+  // the hottest ops
+  profile_op_t* p_ops[PROFILE_OPS];
+  uint32_t op_count = 0;
+  for (uint32_t i = 0; i < PROFILE_OPS; i++) {
+    if (g_profile.ops[i].count) {
+      p_ops[op_count++] = &g_profile.ops[i];
+    }
+  }
+  qsort(p_ops, op_count, sizeof(profile_op_t*), compare_ops);
+  if (op_count > top_n) {
+    op_count = top_n;
+  }
+
+  // and scripts
+  uint32_t script_count = g_profile.script_count;
+  profile_script_t** p_scripts = NULL;
+  if (script_count) {
+    p_scripts = malloc(script_count * sizeof(profile_script_t*));
+    if (!p_scripts) {
+      log_error("Unable to allocate the profile");
+      return;
+    }
+    uint32_t i = 0;
+    for (profile_script_t* p = g_profile.p_scripts; p; p = p->p_next) {
+      p_scripts[i++] = p;
+    }
+    qsort(p_scripts, script_count, sizeof(profile_script_t*), compare_scripts);
+  }
+  if (script_count > top_n) {
+    script_count = top_n;
+  }
+
+  // id, elapsed, op count and script count
+  uint32_t msg_size =
+    sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint32_t);
+  for (uint32_t i = 0; i < op_count; i++) {
+    uint32_t op = p_ops[i] - g_profile.ops;
+    msg_size += sizeof(uint32_t) + strlen(op_name(op)) + 2 * sizeof(uint64_t);
+  }
+  for (uint32_t i = 0; i < script_count; i++) {
+    msg_size += sizeof(uint32_t) + p_scripts[i]->id.size + 3 * sizeof(uint64_t);
+  }
+
+  uint8_t* p_msg = malloc(msg_size);
+  if (!p_msg) {
+    log_error("Unable to allocate the profile");
+    free(p_scripts);
+    return;
+  }
+
+  uint8_t* p = put_u32(p_msg, MSG_OUT_PROFILE);
+  p = put_u64(p, elapsed_ns);
+
+  p = put_u32(p, op_count);
+  for (uint32_t i = 0; i < op_count; i++) {
+    const char* p_name = op_name(p_ops[i] - g_profile.ops);
+    uint32_t name_size = strlen(p_name);
+    p = put_u32(p, name_size);
+    memcpy(p, p_name, name_size);
+    p += name_size;
+    p = put_u64(p, p_ops[i]->count);
+    p = put_u64(p, p_ops[i]->ticks * ns_per_tick);
+  }
+
+  p = put_u32(p, script_count);
+  for (uint32_t i = 0; i < script_count; i++) {
+    const profile_script_t* p_script = p_scripts[i];
+    p = put_u32(p, p_script->id.size);
+    memcpy(p, p_script->id.p_data, p_script->id.size);
+    p += p_script->id.size;
+    p = put_u64(p, p_script->calls);
+    p = put_u64(p, p_script->total_ticks * ns_per_tick);
+    p = put_u64(p, p_script->self_ticks * ns_per_tick);
+  }
+
+  write_cmd(p_msg, p - p_msg);
+  free(p_msg);
+  free(p_scripts);
+}
@@ -0,0 +1,38 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "scenic_types.h"
+
+struct _profile_script_t;
+
+// one per render_script call, on its stack
+typedef struct _profile_frame_t {
+  struct _profile_script_t* p_script;
+  struct _profile_frame_t* p_parent;
+  int64_t start;
+  // time spent in the scripts this one drew
+  int64_t child_ticks;
+  // time towards the op being run when a child script was entered
+  int64_t pending_ticks;
+} profile_frame_t;
+
+// set while scripts are being profiled
+extern volatile bool g_profiling;
+
+// Call at the start of a script with its own, interned, id. Returns false
+// when not profiling, in which case the other calls are skipped.
+bool profile_enter(profile_frame_t* p_frame, sid_t id);
+// after each op the script runs
+void profile_op(profile_frame_t* p_frame, uint32_t op);
+void profile_exit(profile_frame_t* p_frame);
+
+void start_profile(uint32_t* p_msg_length);
+void query_profile(uint32_t* p_msg_length);
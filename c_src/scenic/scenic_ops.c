@@ -1,9 +1,17 @@
+#include <limits.h>
+#include <pthread.h>
+
+#include "capture.h"
 #include "comms.h"
 #include "device.h"
 #include "font.h"
 #include "image.h"
+#include "profile.h"
 #include "scenic_ops.h"
 #include "script.h"
+#include "shm.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
 
 extern device_info_t g_device_info;
@@ -33,6 +41,7 @@ void scenic_ops_reset(const driver_data_t* p_data)
     log_info("%s", __func__);
   }
   reset_scripts();
+  invalidate_frame();
 }
 
 inline
@@ -59,7 +68,7 @@ void scenic_ops_render(uint32_t* p_msg_length, driver_data_t* p_data)
   if (p_data->debug_mode) {
     log_info("%s", __func__);
   }
-  render(p_data);
+  request_render(p_data);
 }
 
 inline
@@ -89,6 +98,84 @@ void scenic_ops_quit(driver_data_t* p_data)
   receive_quit(p_data);
 }
 
+inline
+void scenic_ops_query_stats(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+  query_stats(p_msg_length, p_data);
+}
+
+inline
+void scenic_ops_start_trace(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+  start_trace(p_msg_length);
+}
+
+inline
+void scenic_ops_dump_trace(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+  dump_trace(p_msg_length);
+}
+
+inline
+void scenic_ops_start_profile(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+  start_profile(p_msg_length);
+}
+
+inline
+void scenic_ops_query_profile(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+  query_profile(p_msg_length);
+}
+
+// devices that draw into memory can write out what they drew
+__attribute__((weak))
+void device_dump_frame(const char* path)
+{
+  log_error("This device can't dump frames");
+}
+
+inline
+void scenic_ops_dump_frame(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s", __func__);
+  }
+
+  // the rest of the message is the path
+  uint32_t path_size = *p_msg_length;
+  if (!path_size || (path_size >= PATH_MAX)) {
+    log_error("dump_frame needs a path shorter than %d bytes", PATH_MAX);
+    skip_bytes_down(p_msg_length);
+    return;
+  }
+  char* p_path = read_bytes_in_place(path_size, p_msg_length);
+  if (!p_path) {
+    log_error("dump_frame needs a path");
+    return;
+  }
+  char path[PATH_MAX];
+  memcpy(path, p_path, path_size);
+  path[path_size] = 0;
+
+  device_dump_frame(path);
+}
+
 inline
 void scenic_ops_put_font(uint32_t* p_msg_length, driver_data_t* p_data)
 {
@@ -107,6 +194,24 @@ void scenic_ops_put_image(uint32_t* p_msg_length, driver_data_t* p_data)
   put_image(p_msg_length, p_data->v_ctx);
 }
 
+inline
+void scenic_ops_put_image_shm(uint32_t* p_msg_length, driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s(*%d,%p)", __func__, *p_msg_length, p_data->v_ctx);
+  }
+  put_image_shm(p_msg_length, p_data->v_ctx);
+}
+
+inline
+void scenic_ops_put_image_region(uint32_t* p_msg_length, driver_data_t* p_data)
+{
+  if (p_data->debug_mode) {
+    log_info("%s(*%d,%p)", __func__, *p_msg_length, p_data->v_ctx);
+  }
+  put_image_region(p_msg_length, p_data->v_ctx);
+}
+
 inline
 void scenic_ops_crash()
 {
@@ -115,6 +220,8 @@ void scenic_ops_crash()
 
 void dispatch_scenic_ops(uint32_t msg_length, driver_data_t* p_data)
 {
+  int64_t trace_start = trace_begin();
+
   scenic_op_t op;
   read_bytes_down(&op, sizeof(uint32_t), &msg_length);
 
@@ -147,12 +254,36 @@ void dispatch_scenic_ops(uint32_t msg_length, driver_data_t* p_data)
   case scenic_op_quit:
     scenic_ops_quit(p_data);
     break;
+  case scenic_op_query_stats:
+    scenic_ops_query_stats(&msg_length, p_data);
+    break;
+  case scenic_op_start_trace:
+    scenic_ops_start_trace(&msg_length, p_data);
+    break;
+  case scenic_op_dump_trace:
+    scenic_ops_dump_trace(&msg_length, p_data);
+    break;
+  case scenic_op_start_profile:
+    scenic_ops_start_profile(&msg_length, p_data);
+    break;
+  case scenic_op_query_profile:
+    scenic_ops_query_profile(&msg_length, p_data);
+    break;
+  case scenic_op_dump_frame:
+    scenic_ops_dump_frame(&msg_length, p_data);
+    break;
   case scenic_op_put_font:
     scenic_ops_put_font(&msg_length, p_data);
     break;
   case scenic_op_put_image:
     scenic_ops_put_image(&msg_length, p_data);
     break;
+  case scenic_op_put_image_shm:
+    scenic_ops_put_image_shm(&msg_length, p_data);
+    break;
+  case scenic_op_put_image_region:
+    scenic_ops_put_image_region(&msg_length, p_data);
+    break;
   case scenic_op_crash:
     scenic_ops_crash();
     break;
@@ -170,6 +301,7 @@ void dispatch_scenic_ops(uint32_t msg_length, driver_data_t* p_data)
   }
 
   check_gl_error();
+  trace_end(trace_start, trace_dispatch, op, NULL, 0);
 }
 
 void* scenic_loop(void* user_data)
@@ -186,14 +318,20 @@ void* scenic_loop(void* user_data)
   }
 
   reset_images(p_data->v_ctx);
+  shm_close_all();
+  stop_capture();
 
   device_close(&g_device_info);
 
   return NULL;
 }
 
+// Devices may render parts of a frame on other threads, any of which
+// can log, so messages to the caller are written one at a time
+static pthread_mutex_t cmd_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 __attribute__((weak))
-void scenic_cmd_lock() { }
+void scenic_cmd_lock() { pthread_mutex_lock(&cmd_mutex); }
 
 __attribute__((weak))
-void scenic_cmd_unlock() { }
+void scenic_cmd_unlock() { pthread_mutex_unlock(&cmd_mutex); }
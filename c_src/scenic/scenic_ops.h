@@ -15,11 +15,18 @@ typedef enum {
   //scenic_op_input = 0x0a,
 
   scenic_op_quit = 0x20,
+  scenic_op_query_stats = 0x21,
+  scenic_op_start_trace = 0x2a,
+  scenic_op_dump_trace = 0x2b,
+  scenic_op_start_profile = 0x2c,
+  scenic_op_query_profile = 0x2d,
+  scenic_op_dump_frame = 0x2e,
 
   scenic_op_put_font = 0x40,
   scenic_op_put_image = 0x41,
+  scenic_op_put_image_shm = 0x42,
+  scenic_op_put_image_region = 0x43,
 
-  // scenic_op_query_stats = 0x21,
   // scenic_op_reshap = 0x22,
   // scenic_op_position = 0x23,
   // scenic_op_focus = 0x24,
@@ -50,8 +57,16 @@ void scenic_ops_render(uint32_t* p_msg_length, driver_data_t* p_data);
 void scenic_ops_update_cursor(uint32_t* p_msg_length, driver_data_t* p_data);
 void scenic_ops_clear_color(uint32_t* p_msg_length, const driver_data_t* p_data);
 void scenic_ops_quit(driver_data_t* p_data);
+void scenic_ops_query_stats(uint32_t* p_msg_length, const driver_data_t* p_data);
+void scenic_ops_start_trace(uint32_t* p_msg_length, const driver_data_t* p_data);
+void scenic_ops_dump_trace(uint32_t* p_msg_length, const driver_data_t* p_data);
+void scenic_ops_start_profile(uint32_t* p_msg_length, const driver_data_t* p_data);
+void scenic_ops_query_profile(uint32_t* p_msg_length, const driver_data_t* p_data);
+void scenic_ops_dump_frame(uint32_t* p_msg_length, const driver_data_t* p_data);
 void scenic_ops_put_font(uint32_t* p_msg_length, driver_data_t* p_data);
 void scenic_ops_put_image(uint32_t* p_msg_length, driver_data_t* p_data);
+void scenic_ops_put_image_shm(uint32_t* p_msg_length, driver_data_t* p_data);
+void scenic_ops_put_image_region(uint32_t* p_msg_length, driver_data_t* p_data);
 void scenic_ops_crash();
 
 void dispatch_scenic_ops(uint32_t msg_length, driver_data_t* p_data);
@@ -31,6 +31,16 @@ PACK(typedef struct Vector2f
 }) Vector2f;
 
 
+//---------------------------------------------------------
+// axis aligned box. It is empty when x0 > x1
+typedef struct {
+  float x0;
+  float y0;
+  float x1;
+  float y1;
+} bbox_t;
+
+
 //---------------------------------------------------------
 // the data pointed to by the window private data pointer
 typedef struct {
@@ -47,6 +57,14 @@ typedef struct {
   float cursor_pos[2];
   uint32_t f_show_cursor;
   int debug_mode;
+  // area of the frame being rendered that changed since the last one,
+  // in script coordinates before the global transform
+  bbox_t damage;
+  // a render has been asked for, but waits until the messages already
+  // queued behind it have been applied
+  bool f_render_pending;
+  // render requests that were folded into a later one
+  uint32_t frames_dropped;
 } driver_data_t;
 
 
@@ -56,6 +74,8 @@ typedef struct {
   int height;
   float ratio;
   void* v_ctx;
+  // set by devices that only repaint the damaged part of each frame
+  bool f_partial_render;
 } device_info_t;
 
 typedef struct {
@@ -70,6 +90,17 @@ typedef struct {
   int height;
   int resizable;
   char* fbdev;
+  int vsync;
+  int render_threads;
+  int dither;
+  // megabytes for offscreen layers of unchanging scripts. 0 is off
+  int layer_cache;
+  // frames a second the headless device presents at. 0 is as fast as
+  // frames come
+  int refresh_rate;
+  // file to write the messages from the caller to, for scenic_replay.
+  // Empty for none
+  char* capture;
   char* title;
 } device_opts_t;
 
@@ -82,4 +113,10 @@ typedef struct _data_t {
   uint32_t size;
 } data_t;
 
-typedef data_t sid_t;
+// ids share the size/pointer layout of data_t. The handle is set once
+// the id has been interned (see ids.h) and is 0 otherwise.
+typedef struct {
+  void* p_data;
+  uint32_t size;
+  uint32_t handle;
+} sid_t;
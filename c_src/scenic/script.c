@@ -4,191 +4,1747 @@
 #
 */
 
+#include <math.h>
+#include <pthread.h>
 #include <string.h>
 
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && defined(__SSE2__)
+  #include <emmintrin.h>
+  #define SCRIPT_SSE2
+#elif (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define SCRIPT_NEON
+#endif
+
 #include "common.h"
 #include "comms.h"
+#include "bounds.h"
 #include "font.h"
+#include "ids.h"
 #include "image.h"
+#include "layer_ops.h"
+#include "profile.h"
 #include "script_ops.h"
 #include "script.h"
+#include "trace.h"
 #include "utils.h"
 
-extern device_opts_t g_opts;
+extern device_opts_t g_opts;
+
+//---------------------------------------------------------
+// A script op decoded from the big-endian wire format into host form.
+// Ops are fixed size so render_script can walk them as a plain array.
+// Text and sprites point into the blob area that trails the op array in
+// the same allocation. Ids are interned, so they resolve by handle.
+typedef struct {
+  uint16_t op;
+  uint16_t param;
+  union {
+    float f[8];
+    coordinates_t pt[4];
+    color_rgba_t color;
+    struct {
+      float f[4];
+      color_rgba_t start;
+      color_rgba_t end;
+    } gradient;
+    struct {
+      coordinates_t c;
+      float radius;
+      float a0;
+      float a1;
+      sweep_dir_t sweep_dir;
+    } arc;
+    struct {
+      sid_t id;
+      uint32_t count;
+      const sprite_t* p_sprites;
+    } sprites;
+    data_t text;
+    sid_t id;
+  } args;
+} compiled_op_t;
+
+//---------------------------------------------------------
+// Every script, image or font a script names, collected when it is
+// compiled. This is the edge list of the script graph, so change
+// tracking can walk it without decoding any ops.
+typedef struct {
+  sid_t id;
+  id_slot_t kind;
+  // for scripts, the transform and state they are drawn with. A negative
+  // size means the value is inherited from whoever draws this script
+  matrix_t tx;
+  float stroke_width;
+  float font_size;
+  // the STYLE_ bits set by the script before it draws this one
+  uint32_t styles;
+  // drawn inside a push/pop, so state it leaves behind is thrown away
+  bool f_contained;
+} script_ref_t;
+
+//---------------------------------------------------------
+// Conservative extent of what a script draws itself, in its own space.
+// Strokes and text that use a width or size inherited from the caller
+// are kept apart so they can be padded once that value is known.
+typedef struct {
+  bbox_t box;
+  bbox_t stroke_box;
+  float stroke_scale;
+  bbox_t text_box;
+  float text_reach;
+  bool f_unbounded;
+  // changes state outside of any push/pop, which then carries on into
+  // whatever draws the script
+  bool f_leaks_state;
+  // the STYLE_ bits it draws with before setting them itself
+  uint32_t inherits;
+} script_bounds_t;
+
+//---------------------------------------------------------
+typedef struct _script_t {
+  sid_t id;
+  // bytes allocated for the script, ops and all
+  uint32_t size;
+  uint32_t op_count;
+  compiled_op_t* p_ops;
+  uint32_t ref_count;
+  script_ref_t* p_refs;
+  uint32_t visit_mark;
+  script_bounds_t bounds;
+  // where the script was drawn on screen, this frame and the one before
+  uint32_t frame_mark;
+  bool f_damaged;
+  bbox_t screen_box;
+  bbox_t last_screen_box;
+  bool f_in_damage;
+  // extent of the script and everything it draws, in its own space.
+  // Valid while tree_mark is the current tree generation and for the
+  // stroke width and font size it was worked out with
+  uint32_t tree_mark;
+  float tree_stroke_width;
+  float tree_font_size;
+  bbox_t tree_box;
+  bool f_tree_leaks_state;
+  uint32_t tree_inherits;
+  uint32_t tree_ops;
+  bool f_in_tree;
+  struct _layer_t* p_layer;
+  tommy_hashlin_node  node;
+} script_t;
+
+//---------------------------------------------------------
+// An offscreen copy of what a script draws. See draw_layer
+typedef struct _layer_t {
+  // NULL once the script is gone
+  script_t* p_script;
+  // the device's copy, or NULL until it has been drawn
+  void* v_layer;
+  uint32_t width;
+  uint32_t height;
+  // the extent of the tree it holds, where its top left corner sits in
+  // the script's space and the device pixels per unit it was drawn at
+  bbox_t box;
+  float x;
+  float y;
+  float scale;
+  // frames the script has been drawn since it last changed
+  uint32_t frames;
+  uint32_t last_frame;
+  // the frame the pixels were last put on screen. They don't change again
+  // until the next one
+  uint32_t shown_frame;
+  // most recently used first
+  struct _layer_t* p_prev;
+  struct _layer_t* p_next;
+} layer_t;
+
+
+// #define HASH_ID(id)  tommy_inthash_u32(id)
+#define HASH_ID(id)  tommy_hash_u32( 0, id.p_data, id.size )
+
+tommy_hashlin   scripts = {0};
+
+// screen area uncovered by scripts deleted since the last frame
+static bbox_t deleted_damage = {0};
+
+// moves on whenever a script is stored or deleted, which invalidates
+// every cached tree_box at once
+static uint32_t tree_generation = 1;
+
+
+//---------------------------------------------------------
+void init_scripts( void ) {
+  // init the hash table
+  tommy_hashlin_init( &scripts );
+  deleted_damage = bbox_empty;
+}
+
+//=============================================================================
+// compiling the wire format
+
+// the wire bytes are read where they sit in the input buffer, so they
+// may not be aligned
+static inline uint8_t get_byte(void* p, uint32_t offset)
+{
+  return *((uint8_t*)(p + offset));
+}
+
+static inline uint16_t get_uint16(void* p, uint32_t offset)
+{
+  uint16_t v;
+  memcpy(&v, p + offset, sizeof(v));
+  return ntoh_ui16(v);
+}
+
+static inline uint32_t get_uint32(void* p, uint32_t offset)
+{
+  uint32_t v;
+  memcpy(&v, p + offset, sizeof(v));
+  return ntoh_ui32(v);
+}
+
+static inline float get_float(void* p, uint32_t offset)
+{
+  float v;
+  memcpy(&v, p + offset, sizeof(v));
+  return ntoh_f32(v);
+}
+
+// Copies count big-endian 32 bit words into host order, four at a time
+// where the cpu can. A sprite is nine floats on the wire in the same
+// order as sprite_t, so a whole sprite array goes through in one pass
+static void get_words(void* p_dst, void* p, uint32_t offset, uint32_t count)
+{
+  uint8_t* p_src = p + offset;
+  uint32_t i = 0;
+
+#if defined(SCRIPT_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p_src + i * 4));
+    // swap the bytes in each half, then the halves
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    _mm_storeu_si128((__m128i*)((uint8_t*)p_dst + i * 4), v);
+  }
+#elif defined(SCRIPT_NEON)
+  for (; i + 4 <= count; i += 4) {
+    uint8x16_t v = vld1q_u8(p_src + i * 4);
+    vst1q_u8((uint8_t*)p_dst + i * 4, vrev32q_u8(v));
+  }
+#endif
+
+  for (; i < count; i++) {
+    uint32_t v = get_uint32(p_src, i * 4);
+    memcpy((uint8_t*)p_dst + i * 4, &v, sizeof(v));
+  }
+}
+
+static inline color_rgba_t get_color(void* p, uint32_t offset)
+{
+  return (color_rgba_t){
+    get_byte(p, offset),
+    get_byte(p, offset + 1),
+    get_byte(p, offset + 2),
+    get_byte(p, offset + 3)
+  };
+}
+
+int padded_advance(int size)
+{
+  switch( size % 4 ) {
+    case 0: return size;
+    case 1: return size + 3;
+    case 2: return size + 2;
+    case 3: return size + 1;
+    default: return size;
+  };
+}
+
+//---------------------------------------------------------
+// Walk the wire bytes of a script. When p_ops is NULL this only validates
+// the stream and measures how many ops, refs and blob bytes it needs, so
+// the same code sizes the allocation and then fills it in.
+static void compile_ops(void* p, uint32_t size,
+                        compiled_op_t* p_ops, script_ref_t* p_refs, void* p_blob,
+                        uint32_t* p_op_count, uint32_t* p_ref_count,
+                        uint32_t* p_blob_size)
+{
+  uint32_t i = 0;
+  uint32_t n = 0;
+  uint32_t refs = 0;
+  uint32_t blob = 0;
+
+  while (i + 4 <= size) {
+    script_op_t op = (script_op_t)get_uint16(p, i);
+    uint16_t param = get_uint16(p, i + 2);
+    i += 4;
+
+    // bytes of operands that follow the op header in the stream
+    uint32_t operands = 0;
+    switch(op) {
+      case SCRIPT_OP_DRAW_CIRCLE:
+      case SCRIPT_OP_ROTATE:
+      case SCRIPT_OP_FILL_COLOR:
+      case SCRIPT_OP_STROKE_COLOR:
+        operands = 4; break;
+      case SCRIPT_OP_DRAW_RECT:
+      case SCRIPT_OP_DRAW_ARC:
+      case SCRIPT_OP_DRAW_SECTOR:
+      case SCRIPT_OP_DRAW_ELLIPSE:
+      case SCRIPT_OP_MOVE_TO:
+      case SCRIPT_OP_LINE_TO:
+      case SCRIPT_OP_SCISSOR:
+      case SCRIPT_OP_SCALE:
+      case SCRIPT_OP_TRANSLATE:
+        operands = 8; break;
+      case SCRIPT_OP_DRAW_RRECT:
+        operands = 12; break;
+      case SCRIPT_OP_DRAW_LINE:
+      case SCRIPT_OP_QUADRATIC_TO:
+        operands = 16; break;
+      case SCRIPT_OP_ARC_TO:
+        operands = 20; break;
+      case SCRIPT_OP_DRAW_TRIANGLE:
+      case SCRIPT_OP_DRAW_RRECTV:
+      case SCRIPT_OP_BEZIER_TO:
+      case SCRIPT_OP_ARC:
+      case SCRIPT_OP_TRANSFORM:
+      case SCRIPT_OP_FILL_LINEAR:
+      case SCRIPT_OP_FILL_RADIAL:
+      case SCRIPT_OP_STROKE_LINEAR:
+      case SCRIPT_OP_STROKE_RADIAL:
+        operands = 24; break;
+      case SCRIPT_OP_DRAW_QUAD:
+        operands = 32; break;
+      case SCRIPT_OP_DRAW_TEXT:
+      case SCRIPT_OP_DRAW_SCRIPT:
+      case SCRIPT_OP_FILL_IMAGE:
+      case SCRIPT_OP_FILL_STREAM:
+      case SCRIPT_OP_STROKE_IMAGE:
+      case SCRIPT_OP_STROKE_STREAM:
+      case SCRIPT_OP_FONT:
+        operands = padded_advance(param); break;
+      case SCRIPT_OP_DRAW_SPRITES:
+        // assume the worst until the sprite count is known to fit
+        operands = size;
+        if ((i + 4 <= size) && (get_uint32(p, i) <= (size - i) / 36)) {
+          operands = sizeof(uint32_t) + padded_advance(param)
+            + get_uint32(p, i) * 36;
+        }
+        break;
+      case SCRIPT_OP_BEGIN_PATH:
+      case SCRIPT_OP_CLOSE_PATH:
+      case SCRIPT_OP_FILL_PATH:
+      case SCRIPT_OP_STROKE_PATH:
+      case SCRIPT_OP_PUSH_STATE:
+      case SCRIPT_OP_POP_STATE:
+      case SCRIPT_OP_POP_PUSH_STATE:
+      case SCRIPT_OP_STROKE_WIDTH:
+      case SCRIPT_OP_LINE_CAP:
+      case SCRIPT_OP_LINE_JOIN:
+      case SCRIPT_OP_MITER_LIMIT:
+      case SCRIPT_OP_FONT_SIZE:
+      case SCRIPT_OP_TEXT_ALIGN:
+      case SCRIPT_OP_TEXT_BASE:
+        break;
+      default:
+        // only complain once, while measuring
+        if (!p_ops) {
+          log_error("Unknown script_op: %d", op);
+        }
+        continue;
+    }
+
+    if (operands > size - i) {
+      if (!p_ops) {
+        log_error("Truncated script_op: %d", op);
+      }
+      break;
+    }
+
+    // measuring only. account for the blob space and move on
+    if (!p_ops) {
+      switch(op) {
+        case SCRIPT_OP_DRAW_SPRITES:
+          blob += get_uint32(p, i) * sizeof(sprite_t);
+          refs++;
+          break;
+        case SCRIPT_OP_DRAW_TEXT:
+          blob += padded_advance(param);
+          break;
+        case SCRIPT_OP_DRAW_SCRIPT:
+        case SCRIPT_OP_FILL_IMAGE:
+        case SCRIPT_OP_FILL_STREAM:
+        case SCRIPT_OP_STROKE_IMAGE:
+        case SCRIPT_OP_STROKE_STREAM:
+        case SCRIPT_OP_FONT:
+          refs++;
+          break;
+        default:
+          break;
+      }
+      i += operands;
+      n++;
+      continue;
+    }
+
+    compiled_op_t* p_op = &p_ops[n++];
+    p_op->op = op;
+    p_op->param = param;
+
+    switch(op) {
+      case SCRIPT_OP_DRAW_LINE:
+      case SCRIPT_OP_DRAW_TRIANGLE:
+      case SCRIPT_OP_DRAW_QUAD:
+      case SCRIPT_OP_DRAW_RECT:
+      case SCRIPT_OP_DRAW_RRECT:
+      case SCRIPT_OP_DRAW_RRECTV:
+      case SCRIPT_OP_DRAW_ARC:
+      case SCRIPT_OP_DRAW_SECTOR:
+      case SCRIPT_OP_DRAW_CIRCLE:
+      case SCRIPT_OP_DRAW_ELLIPSE:
+      case SCRIPT_OP_MOVE_TO:
+      case SCRIPT_OP_LINE_TO:
+      case SCRIPT_OP_ARC_TO:
+      case SCRIPT_OP_BEZIER_TO:
+      case SCRIPT_OP_QUADRATIC_TO:
+      case SCRIPT_OP_SCISSOR:
+      case SCRIPT_OP_TRANSFORM:
+      case SCRIPT_OP_SCALE:
+      case SCRIPT_OP_ROTATE:
+      case SCRIPT_OP_TRANSLATE:
+        // operands are all floats. The point and float views of the
+        // union share the same storage
+        for (uint32_t f = 0; f < operands / 4; f++) {
+          p_op->args.f[f] = get_float(p, i + f * 4);
+        }
+        break;
+      case SCRIPT_OP_ARC:
+        p_op->args.arc.c.x = get_float(p, i);
+        p_op->args.arc.c.y = get_float(p, i + 4);
+        p_op->args.arc.radius = get_float(p, i + 8);
+        p_op->args.arc.a0 = get_float(p, i + 12);
+        p_op->args.arc.a1 = get_float(p, i + 16);
+        p_op->args.arc.sweep_dir = get_uint32(p, i + 20);
+        break;
+      case SCRIPT_OP_FILL_COLOR:
+      case SCRIPT_OP_STROKE_COLOR:
+        p_op->args.color = get_color(p, i);
+        break;
+      case SCRIPT_OP_FILL_LINEAR:
+      case SCRIPT_OP_FILL_RADIAL:
+      case SCRIPT_OP_STROKE_LINEAR:
+      case SCRIPT_OP_STROKE_RADIAL:
+        for (uint32_t f = 0; f < 4; f++) {
+          p_op->args.gradient.f[f] = get_float(p, i + f * 4);
+        }
+        p_op->args.gradient.start = get_color(p, i + 16);
+        p_op->args.gradient.end = get_color(p, i + 20);
+        break;
+      case SCRIPT_OP_STROKE_WIDTH:
+      case SCRIPT_OP_FONT_SIZE:
+        p_op->args.f[0] = param / 4.0;
+        break;
+      case SCRIPT_OP_DRAW_TEXT:
+        p_op->args.text.size = param;
+        p_op->args.text.p_data = p_blob + blob;
+        memcpy(p_blob + blob, p + i, param);
+        blob += padded_advance(param);
+        break;
+      case SCRIPT_OP_DRAW_SCRIPT:
+      case SCRIPT_OP_FILL_IMAGE:
+      case SCRIPT_OP_FILL_STREAM:
+      case SCRIPT_OP_STROKE_IMAGE:
+      case SCRIPT_OP_STROKE_STREAM:
+      case SCRIPT_OP_FONT:
+        // the script holds a reference on every id it names until it
+        // is freed. See release_ops
+        p_op->args.id = intern_id((sid_t){p + i, param, 0});
+        p_refs[refs].id = p_op->args.id;
+        p_refs[refs++].kind = (op == SCRIPT_OP_DRAW_SCRIPT) ? ID_SLOT_SCRIPT
+          : (op == SCRIPT_OP_FONT) ? ID_SLOT_FONT : ID_SLOT_IMAGE;
+        break;
+      case SCRIPT_OP_DRAW_SPRITES:
+        {
+          uint32_t count = get_uint32(p, i);
+          uint32_t s = i + sizeof(uint32_t);
+
+          p_op->args.sprites.id = intern_id((sid_t){p + s, param, 0});
+          p_refs[refs].id = p_op->args.sprites.id;
+          p_refs[refs++].kind = ID_SLOT_IMAGE;
+          s += padded_advance(param);
+
+          sprite_t* p_sprites = p_blob + blob;
+          get_words(p_sprites, p, s, count * 9);
+          blob += count * sizeof(sprite_t);
+
+          p_op->args.sprites.count = count;
+          p_op->args.sprites.p_sprites = p_sprites;
+        }
+        break;
+      default:
+        break;
+    }
+
+    i += operands;
+  }
+
+  *p_op_count = n;
+  *p_ref_count = refs;
+  *p_blob_size = blob;
+}
+
+//=============================================================================
+// bounds
+
+// stroke outlines reach half the line width past the path, or up to the
+// miter limit times that at sharp joins. 10 is the cairo default limit
+#define STROKE_PAD 5.0f
+// generous per-byte advance and line height for text, in ems
+#define TEXT_EM_WIDTH 1.5f
+#define TEXT_EM_HEIGHT 1.5f
+// nanovg breaks text into rows at newlines and at this width, and draws
+// each row a line below the last
+#define TEXT_WRAP_WIDTH 1000.0f
+// state assumed for the top of the tree. Matches the renderer defaults
+#define DEFAULT_STROKE_WIDTH 2.0f
+#define DEFAULT_FONT_SIZE 20.0f
+#define BOUNDS_STATE_DEPTH 64
+#define MAX_SCRIPT_DEPTH 256
+
+// The parts of the drawing state a script can pick up from whoever draws
+// it. A script that sets everything it draws with draws the same thing
+// wherever it is drawn from.
+#define STYLE_FILL 0x0001
+#define STYLE_STROKE 0x0002
+#define STYLE_STROKE_WIDTH 0x0004
+#define STYLE_LINE_CAP 0x0008
+#define STYLE_LINE_JOIN 0x0010
+#define STYLE_MITER_LIMIT 0x0020
+#define STYLE_FONT 0x0040
+#define STYLE_FONT_SIZE 0x0080
+#define STYLE_TEXT_ALIGN 0x0100
+#define STYLE_TEXT_BASE 0x0200
+// nanovg replaces the scissor where cairo intersects with it, so a script
+// that sets one can reach past the scissor it is drawn inside of
+#define STYLE_SCISSOR 0x0400
+
+#define STYLE_STROKES (STYLE_STROKE | STYLE_STROKE_WIDTH | STYLE_LINE_CAP \
+                       | STYLE_LINE_JOIN | STYLE_MITER_LIMIT)
+#define STYLE_TEXT (STYLE_FILL | STYLE_FONT | STYLE_FONT_SIZE \
+                    | STYLE_TEXT_ALIGN | STYLE_TEXT_BASE)
+
+typedef struct {
+  matrix_t tx;
+  float stroke_width;
+  float font_size;
+  // the STYLE_ bits set so far
+  uint32_t styles;
+} bounds_state_t;
+
+//---------------------------------------------------------
+static inline void use_styles(script_bounds_t* p_bounds, const bounds_state_t* p_st,
+                              uint32_t styles)
+{
+  p_bounds->inherits |= styles & ~p_st->styles;
+}
+
+static inline uint32_t shape_styles(uint16_t param)
+{
+  return ((param & FLAG_FILL) ? STYLE_FILL : 0)
+    | ((param & FLAG_STROKE) ? STYLE_STROKES : 0);
+}
+
+//---------------------------------------------------------
+static void add_shape(script_bounds_t* p_bounds, const bounds_state_t* p_st,
+                      bbox_t local, bool stroke)
+{
+  p_bounds->box = bbox_union(p_bounds->box, bbox_transform(p_st->tx, local));
+  if (!stroke) {
+    return;
+  }
+
+  if (p_st->stroke_width >= 0) {
+    bbox_t outline = bbox_pad(local, p_st->stroke_width * STROKE_PAD);
+    p_bounds->box = bbox_union(p_bounds->box, bbox_transform(p_st->tx, outline));
+  } else {
+    p_bounds->stroke_box = bbox_union(p_bounds->stroke_box,
+                                      bbox_transform(p_st->tx, local));
+    p_bounds->stroke_scale = fmaxf(p_bounds->stroke_scale,
+                                   matrix_max_scale(p_st->tx));
+  }
+}
+
+//---------------------------------------------------------
+// the path is already in script space, so the stroke is padded there
+static void add_path(script_bounds_t* p_bounds, const bounds_state_t* p_st,
+                     bbox_t path, bool stroke)
+{
+  p_bounds->box = bbox_union(p_bounds->box, path);
+  if (!stroke) {
+    return;
+  }
+
+  float scale = matrix_max_scale(p_st->tx);
+  if (p_st->stroke_width >= 0) {
+    bbox_t outline = bbox_pad(path, p_st->stroke_width * STROKE_PAD * scale);
+    p_bounds->box = bbox_union(p_bounds->box, outline);
+  } else {
+    p_bounds->stroke_box = bbox_union(p_bounds->stroke_box, path);
+    p_bounds->stroke_scale = fmaxf(p_bounds->stroke_scale, scale);
+  }
+}
+
+//---------------------------------------------------------
+// The rows a run of text can take, drawn at font size s. Within a line
+// wrapped at the row width, each two rows together are wider than a row,
+// else the second would have fitted on the first. So a line of width W
+// is at most 2W/TEXT_WRAP_WIDTH + 1 rows, and never more than its bytes.
+static float text_rows(const char* p_text, uint32_t bytes, float s)
+{
+  float rows = 0;
+  uint32_t start = 0;
+  for (uint32_t i = 0; i <= bytes; i++) {
+    if ((i < bytes) && (p_text[i] != '\n')) {
+      continue;
+    }
+    uint32_t line_bytes = i - start;
+    float line_width = TEXT_EM_WIDTH * line_bytes * s;
+    if (!line_bytes || (line_width <= TEXT_WRAP_WIDTH)) {
+      rows += 1;
+    } else {
+      rows += fminf(ceilf(2 * line_width / TEXT_WRAP_WIDTH) + 1, line_bytes);
+    }
+    start = i + 1;
+  }
+  return rows;
+}
+
+//---------------------------------------------------------
+// Text can be aligned and based either way around its origin, and any
+// rows after the first go down from there
+static void add_text(script_bounds_t* p_bounds, const bounds_state_t* p_st,
+                     const char* p_text, uint32_t bytes)
+{
+  float w = TEXT_EM_WIDTH * bytes;
+  float h = TEXT_EM_HEIGHT;
+
+  if (p_st->font_size >= 0) {
+    float s = p_st->font_size;
+    float rows = text_rows(p_text, bytes, s);
+    bbox_t local = {-w * s, -h * s, w * s, rows * h * s};
+    p_bounds->box = bbox_union(p_bounds->box, bbox_transform(p_st->tx, local));
+  } else {
+    // Padded all round once the size is known. Text has no more rows than
+    // bytes, so reaching as far as all its bytes are wide also reaches
+    // its last row, wherever it wraps
+    p_bounds->text_box = bbox_add_point(p_bounds->text_box,
+                                        p_st->tx.e, p_st->tx.f);
+    p_bounds->text_reach = fmaxf(p_bounds->text_reach,
+                                 matrix_max_scale(p_st->tx) * hypotf(w, h));
+  }
+}
+
+static inline bbox_t bbox_of_rect(float x, float y, float w, float h)
+{
+  return (bbox_t){fminf(x, x + w), fminf(y, y + h), fmaxf(x, x + w), fmaxf(y, y + h)};
+}
+
+static inline bbox_t bbox_add_coordinates(bbox_t box, matrix_t m, coordinates_t pt)
+{
+  return bbox_add_point(box,
+                        m.a * pt.x + m.c * pt.y + m.e,
+                        m.b * pt.x + m.d * pt.y + m.f);
+}
+
+//---------------------------------------------------------
+// Simulate the state stack of a compiled script to find what it covers.
+// Also records the transform and state each child script is drawn with.
+static void compute_bounds(script_t* p_script)
+{
+  script_bounds_t* p_bounds = &p_script->bounds;
+  *p_bounds = (script_bounds_t){
+    bbox_empty, bbox_empty, 0.0f, bbox_empty, 0.0f, false, false, 0
+  };
+
+  bounds_state_t stack[BOUNDS_STATE_DEPTH];
+  int depth = 0;
+  bounds_state_t st = {matrix_identity, -1.0f, -1.0f, 0};
+  bbox_t path = bbox_empty;
+  uint32_t ref = 0;
+
+  for (uint32_t n = 0; n < p_script->op_count; n++) {
+    const compiled_op_t* p_op = &p_script->p_ops[n];
+    uint16_t param = p_op->param;
+    const float* f = p_op->args.f;
+    const coordinates_t* pt = p_op->args.pt;
+    bbox_t local = bbox_empty;
+
+    switch(p_op->op) {
+      case SCRIPT_OP_DRAW_LINE:
+        local = bbox_add_point(local, pt[0].x, pt[0].y);
+        local = bbox_add_point(local, pt[1].x, pt[1].y);
+        add_shape(p_bounds, &st, local, true);
+        use_styles(p_bounds, &st, shape_styles(param));
+        break;
+      case SCRIPT_OP_DRAW_TRIANGLE:
+      case SCRIPT_OP_DRAW_QUAD:
+        {
+          int corners = (p_op->op == SCRIPT_OP_DRAW_TRIANGLE) ? 3 : 4;
+          for (int c = 0; c < corners; c++) {
+            local = bbox_add_point(local, pt[c].x, pt[c].y);
+          }
+          add_shape(p_bounds, &st, local, (param & FLAG_STROKE));
+          use_styles(p_bounds, &st, shape_styles(param));
+        }
+        break;
+      case SCRIPT_OP_DRAW_RECT:
+      case SCRIPT_OP_DRAW_RRECT:
+      case SCRIPT_OP_DRAW_RRECTV:
+        add_shape(p_bounds, &st, bbox_of_rect(0, 0, f[0], f[1]), (param & FLAG_STROKE));
+        use_styles(p_bounds, &st, shape_styles(param));
+        break;
+      case SCRIPT_OP_DRAW_ARC:
+      case SCRIPT_OP_DRAW_SECTOR:
+      case SCRIPT_OP_DRAW_CIRCLE:
+        {
+          float r = fabsf(f[0]);
+          add_shape(p_bounds, &st, (bbox_t){-r, -r, r, r}, (param & FLAG_STROKE));
+          use_styles(p_bounds, &st, shape_styles(param));
+        }
+        break;
+      case SCRIPT_OP_DRAW_ELLIPSE:
+        {
+          float rx = fabsf(f[0]);
+          float ry = fabsf(f[1]);
+          add_shape(p_bounds, &st, (bbox_t){-rx, -ry, rx, ry}, (param & FLAG_STROKE));
+          use_styles(p_bounds, &st, shape_styles(param));
+        }
+        break;
+      case SCRIPT_OP_DRAW_TEXT:
+        add_text(p_bounds, &st, p_op->args.text.p_data, p_op->args.text.size);
+        use_styles(p_bounds, &st, STYLE_TEXT);
+        break;
+      case SCRIPT_OP_DRAW_SPRITES:
+        for (uint32_t i = 0; i < p_op->args.sprites.count; i++) {
+          const sprite_t* p_sprite = &p_op->args.sprites.p_sprites[i];
+          local = bbox_union(local, bbox_of_rect(p_sprite->dx, p_sprite->dy,
+                                                 p_sprite->dw, p_sprite->dh));
+        }
+        add_shape(p_bounds, &st, local, false);
+        ref++;
+        break;
+      case SCRIPT_OP_DRAW_SCRIPT:
+        p_script->p_refs[ref].tx = st.tx;
+        p_script->p_refs[ref].stroke_width = st.stroke_width;
+        p_script->p_refs[ref].font_size = st.font_size;
+        p_script->p_refs[ref].styles = st.styles;
+        p_script->p_refs[ref].f_contained = (depth > 0);
+        ref++;
+        break;
+      case SCRIPT_OP_FILL_IMAGE:
+      case SCRIPT_OP_FILL_STREAM:
+        st.styles |= STYLE_FILL;
+        ref++;
+        break;
+      case SCRIPT_OP_STROKE_IMAGE:
+      case SCRIPT_OP_STROKE_STREAM:
+        st.styles |= STYLE_STROKE;
+        ref++;
+        break;
+      case SCRIPT_OP_FONT:
+        st.styles |= STYLE_FONT;
+        ref++;
+        break;
+
+      case SCRIPT_OP_BEGIN_PATH:
+        path = bbox_empty;
+        break;
+      case SCRIPT_OP_MOVE_TO:
+      case SCRIPT_OP_LINE_TO:
+        path = bbox_add_coordinates(path, st.tx, pt[0]);
+        break;
+      case SCRIPT_OP_ARC_TO:
+      case SCRIPT_OP_QUADRATIC_TO:
+        // the curve stays inside the hull of its control points
+        path = bbox_add_coordinates(path, st.tx, pt[0]);
+        path = bbox_add_coordinates(path, st.tx, pt[1]);
+        break;
+      case SCRIPT_OP_BEZIER_TO:
+        path = bbox_add_coordinates(path, st.tx, pt[0]);
+        path = bbox_add_coordinates(path, st.tx, pt[1]);
+        path = bbox_add_coordinates(path, st.tx, pt[2]);
+        break;
+      case SCRIPT_OP_ARC:
+        {
+          coordinates_t c = p_op->args.arc.c;
+          float r = fabsf(p_op->args.arc.radius);
+          local = (bbox_t){c.x - r, c.y - r, c.x + r, c.y + r};
+          path = bbox_union(path, bbox_transform(st.tx, local));
+        }
+        break;
+      case SCRIPT_OP_FILL_PATH:
+        add_path(p_bounds, &st, path, false);
+        use_styles(p_bounds, &st, STYLE_FILL);
+        break;
+      case SCRIPT_OP_STROKE_PATH:
+        add_path(p_bounds, &st, path, true);
+        use_styles(p_bounds, &st, STYLE_STROKES);
+        break;
+
+      case SCRIPT_OP_POP_STATE:
+        if (depth > 0) {
+          st = stack[--depth];
+        }
+        break;
+      case SCRIPT_OP_POP_PUSH_STATE:
+        if (depth > 0) {
+          st = stack[--depth];
+        }
+        // [[fallthrough]];
+      case SCRIPT_OP_PUSH_STATE:
+        if (depth >= BOUNDS_STATE_DEPTH) {
+          // too deep to follow. Treat the script as covering everything
+          p_bounds->f_unbounded = true;
+          p_bounds->f_leaks_state = true;
+          return;
+        }
+        stack[depth++] = st;
+        break;
+
+      case SCRIPT_OP_TRANSFORM:
+        st.tx = matrix_multiply(st.tx, (matrix_t){f[0], f[1], f[2], f[3], f[4], f[5]});
+        break;
+      case SCRIPT_OP_SCALE:
+        st.tx = matrix_scale(st.tx, f[0], f[1]);
+        break;
+      case SCRIPT_OP_ROTATE:
+        st.tx = matrix_rotate(st.tx, f[0]);
+        break;
+      case SCRIPT_OP_TRANSLATE:
+        st.tx = matrix_translate(st.tx, f[0], f[1]);
+        break;
+
+      case SCRIPT_OP_SCISSOR:
+        p_bounds->inherits |= STYLE_SCISSOR;
+        break;
+
+      case SCRIPT_OP_FILL_COLOR:
+      case SCRIPT_OP_FILL_LINEAR:
+      case SCRIPT_OP_FILL_RADIAL:
+        st.styles |= STYLE_FILL;
+        break;
+      case SCRIPT_OP_STROKE_COLOR:
+      case SCRIPT_OP_STROKE_LINEAR:
+      case SCRIPT_OP_STROKE_RADIAL:
+        st.styles |= STYLE_STROKE;
+        break;
+      case SCRIPT_OP_STROKE_WIDTH:
+        st.stroke_width = f[0];
+        st.styles |= STYLE_STROKE_WIDTH;
+        break;
+      case SCRIPT_OP_LINE_CAP:
+        st.styles |= STYLE_LINE_CAP;
+        break;
+      case SCRIPT_OP_LINE_JOIN:
+        st.styles |= STYLE_LINE_JOIN;
+        break;
+      case SCRIPT_OP_MITER_LIMIT:
+        st.styles |= STYLE_MITER_LIMIT;
+        break;
+      case SCRIPT_OP_FONT_SIZE:
+        st.font_size = f[0];
+        st.styles |= STYLE_FONT_SIZE;
+        break;
+      case SCRIPT_OP_TEXT_ALIGN:
+        st.styles |= STYLE_TEXT_ALIGN;
+        break;
+      case SCRIPT_OP_TEXT_BASE:
+        st.styles |= STYLE_TEXT_BASE;
+        break;
+
+      default:
+        break;
+    }
+
+    // the current path is not part of the saved state, and every
+    // primitive starts a new one, so only the style and transform count
+    if (depth == 0) {
+      switch(p_op->op) {
+        case SCRIPT_OP_SCISSOR:
+        case SCRIPT_OP_TRANSFORM:
+        case SCRIPT_OP_SCALE:
+        case SCRIPT_OP_ROTATE:
+        case SCRIPT_OP_TRANSLATE:
+        case SCRIPT_OP_FILL_COLOR:
+        case SCRIPT_OP_FILL_LINEAR:
+        case SCRIPT_OP_FILL_RADIAL:
+        case SCRIPT_OP_FILL_IMAGE:
+        case SCRIPT_OP_FILL_STREAM:
+        case SCRIPT_OP_STROKE_WIDTH:
+        case SCRIPT_OP_STROKE_COLOR:
+        case SCRIPT_OP_STROKE_LINEAR:
+        case SCRIPT_OP_STROKE_RADIAL:
+        case SCRIPT_OP_STROKE_IMAGE:
+        case SCRIPT_OP_STROKE_STREAM:
+        case SCRIPT_OP_LINE_CAP:
+        case SCRIPT_OP_LINE_JOIN:
+        case SCRIPT_OP_MITER_LIMIT:
+        case SCRIPT_OP_FONT:
+        case SCRIPT_OP_FONT_SIZE:
+        case SCRIPT_OP_TEXT_ALIGN:
+        case SCRIPT_OP_TEXT_BASE:
+          p_bounds->f_leaks_state = true;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------
+// the script's own drawing on screen, given where it is drawn from and
+// the stroke width and font size it inherits. Damage and culling both
+// use it, so text is covered down to its last row for both
+static bbox_t own_screen_box(const script_bounds_t* p_bounds,
+                             matrix_t m, float stroke_width, float font_size)
+{
+  if (p_bounds->f_unbounded) {
+    return bbox_infinite;
+  }
+
+  bbox_t box = p_bounds->box;
+  box = bbox_union(box, bbox_pad(p_bounds->stroke_box,
+                                 stroke_width * STROKE_PAD * p_bounds->stroke_scale));
+  box = bbox_union(box, bbox_pad(p_bounds->text_box,
+                                 font_size * p_bounds->text_reach));
+  return bbox_transform(m, box);
+}
+
+//=============================================================================
+// internal utilities for working with the script hash
+
+// isolate all knowledge of the hash table implementation to these functions
+
+//---------------------------------------------------------
+static int _comparator(const void* p_arg, const void* p_obj)
+{
+  const sid_t* p_id = p_arg;
+  const script_t* p_script = p_obj;
+  return (p_id->size != p_script->id.size)
+    || memcmp(p_id->p_data, p_script->id.p_data, p_id->size);
+}
+
+//---------------------------------------------------------
+script_t* get_script(sid_t id)
+{
+  // interned ids resolve straight through their handle
+  if (id.handle) {
+    return get_id_slot(id, ID_SLOT_SCRIPT);
+  }
+  return tommy_hashlin_search(&scripts,
+                              _comparator,
+                              &id,
+                              HASH_ID(id));
+}
+
+//---------------------------------------------------------
+// drop the references a compiled script holds on the ids it names
+static void release_ops(script_t* p_script)
+{
+  for (uint32_t n = 0; n < p_script->op_count; n++) {
+    compiled_op_t* p_op = &p_script->p_ops[n];
+    switch(p_op->op) {
+      case SCRIPT_OP_DRAW_SPRITES:
+        release_id(p_op->args.sprites.id);
+        break;
+      case SCRIPT_OP_DRAW_SCRIPT:
+      case SCRIPT_OP_FILL_IMAGE:
+      case SCRIPT_OP_FILL_STREAM:
+      case SCRIPT_OP_STROKE_IMAGE:
+      case SCRIPT_OP_STROKE_STREAM:
+      case SCRIPT_OP_FONT:
+        release_id(p_op->args.id);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+static void script_free(script_t* p_script)
+{
+  // the layer goes at the start of the next frame, where the device
+  // can release what it holds
+  if (p_script->p_layer) {
+    p_script->p_layer->p_script = NULL;
+  }
+  set_id_slot(p_script->id, ID_SLOT_SCRIPT, NULL);
+  release_ops(p_script);
+  release_id(p_script->id);
+  free(p_script);
+}
+
+//---------------------------------------------------------
+void do_delete_script(sid_t id)
+{
+  script_t* p_script = get_script(id);
+  if (p_script) {
+    if (g_opts.debug_mode) {
+      log_debug("%s id:'%.*s'", __func__,
+                id.size, id.p_data);
+    }
+
+    tommy_hashlin_remove_existing(&scripts,
+                                  &p_script->node);
+    mark_id_dirty(p_script->id);
+    deleted_damage = bbox_union(deleted_damage, p_script->screen_box);
+    tree_generation++;
+    script_free(p_script);
+  }
+}
+
+//---------------------------------------------------------
+void put_script(uint32_t* p_msg_length)
+{
+  // read in the length of the id, which is in the first four bytes
+  uint32_t id_length;
+  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
+  if (id_length > *p_msg_length) {
+    log_error("Invalid script id length: %d", id_length);
+    return;
+  }
+
+  // the id and the raw script are used where they sit in the input
+  // buffer. The wire bytes are only needed until they are compiled.
+  int id_size = ALIGN_UP(id_length, 8);
+  uint32_t wire_size = *p_msg_length - id_length;
+  void* p_id = read_bytes_in_place(*p_msg_length, p_msg_length);
+  if ( !p_id ) {
+    log_error("Unable to read script");
+    return;
+  }
+  void* p_wire = p_id + id_length;
+
+  // measure the compiled form
+  uint32_t op_count;
+  uint32_t ref_count;
+  uint32_t blob_size;
+  compile_ops(p_wire, wire_size, NULL, NULL, NULL,
+              &op_count, &ref_count, &blob_size);
+
+  // initialize a record to hold the script
+  int struct_size = ALIGN_UP(sizeof(script_t), 8);
+  int ops_size = op_count * sizeof(compiled_op_t);
+  int refs_size = ref_count * sizeof(script_ref_t);
+  int alloc_size = struct_size + id_size + ops_size + refs_size + blob_size;
+  script_t *p_script = malloc(alloc_size);
+  if ( !p_script ) {
+    log_error("Unable to allocate script");
+    return;
+  }
+
+  p_script->size = alloc_size;
+
+  // initialize the id. The memory is fresh from malloc, so the handle
+  // has to be cleared before it is interned
+  p_script->id = (sid_t){((void*)p_script) + struct_size, id_length, 0};
+  memcpy(p_script->id.p_data, p_id, id_length);
+  p_script->id.handle = intern_id(p_script->id).handle;
+
+  // compile the ops
+  p_script->p_ops = ((void*)p_script) + struct_size + id_size;
+  p_script->p_refs = ((void*)p_script->p_ops) + ops_size;
+  p_script->visit_mark = 0;
+  compile_ops(p_wire, wire_size,
+              p_script->p_ops, p_script->p_refs,
+              ((void*)p_script->p_refs) + refs_size,
+              &p_script->op_count, &p_script->ref_count, &blob_size);
+
+  compute_bounds(p_script);
+  p_script->frame_mark = 0;
+  p_script->f_damaged = false;
+  p_script->screen_box = bbox_empty;
+  p_script->last_screen_box = bbox_empty;
+  p_script->f_in_damage = false;
+  p_script->tree_mark = 0;
+  p_script->tree_inherits = 0;
+  p_script->tree_ops = 0;
+  p_script->f_in_tree = false;
+  p_script->p_layer = NULL;
+
+  // if there is already is a script with the same id, delete it
+  do_delete_script(p_script->id);
+  mark_id_dirty(p_script->id);
+
+  if (g_opts.debug_mode) {
+    log_debug("%s id:'%.*s' ops:%d", __func__,
+              p_script->id.size, p_script->id.p_data, p_script->op_count);
+  }
+
+  // insert the script into the tommy hash
+  tommy_hashlin_insert(&scripts,
+                       &p_script->node,
+                       p_script,
+                       HASH_ID(p_script->id));
+  set_id_slot(p_script->id, ID_SLOT_SCRIPT, p_script);
+  tree_generation++;
+}
+
+//---------------------------------------------------------
+void delete_script(uint32_t* p_msg_length)
+{
+  sid_t id = {0};
+
+  // read in the length of the id, which is in the first four bytes
+  read_bytes_down(&id.size, sizeof(uint32_t), p_msg_length);
+
+  // the id is used where it sits in the input buffer. One that runs past
+  // the end of the message can't name a script, so the rest is dropped
+  id.p_data = read_bytes_in_place(id.size, p_msg_length);
+  if (!id.p_data) {
+    read_bytes_in_place(*p_msg_length, p_msg_length);
+    return;
+  }
+
+  do_delete_script(id);
+}
+
+//---------------------------------------------------------
+void reset_scripts() {
+  // deallocates all the objects iterating the hashtable
+  tommy_hashlin_foreach( &scripts, (tommy_foreach_func*)script_free );
+
+  // deallocates the hashtable
+  tommy_hashlin_done( &scripts );
+
+  // re-init the hash table
+  tommy_hashlin_init( &scripts );
+  tree_generation++;
+}
+
+//---------------------------------------------------------
+static void add_script_size(uint64_t* p_bytes, script_t* p_script)
+{
+  *p_bytes += p_script->size;
+}
+
+void script_stats(uint32_t* p_count, uint64_t* p_bytes)
+{
+  *p_count = tommy_hashlin_count(&scripts);
+  *p_bytes = 0;
+  tommy_hashlin_foreach_arg(&scripts,
+                            (tommy_foreach_arg_func*)add_script_size, p_bytes);
+}
+
+
+//=============================================================================
+// change tracking
+
+static uint32_t visit_mark = 0;
+
+//---------------------------------------------------------
+static bool tree_changed(sid_t id)
+{
+  if (is_id_dirty(id)) {
+    return true;
+  }
+
+  // each script only needs to be checked once per walk, no matter how
+  // many times it is drawn. This also stops reference cycles.
+  script_t* p_script = get_script(id);
+  if (!p_script || p_script->visit_mark == visit_mark) {
+    return false;
+  }
+  p_script->visit_mark = visit_mark;
+
+  for (uint32_t i = 0; i < p_script->ref_count; i++) {
+    const script_ref_t* p_ref = &p_script->p_refs[i];
+    if (p_ref->kind == ID_SLOT_SCRIPT) {
+      if (tree_changed(p_ref->id)) {
+        return true;
+      }
+    } else if (is_id_dirty(p_ref->id)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------
+// true if the script, or anything it draws directly or through other
+// scripts, was stored, replaced or deleted since the last frame
+bool script_changed(sid_t id)
+{
+  if (!any_ids_dirty()) {
+    return false;
+  }
+  visit_mark++;
+  return tree_changed(id);
+}
+
+//=============================================================================
+// damage
+
+static uint32_t frame_mark = 0;
+
+//---------------------------------------------------------
+static bool refs_dirty(const script_t* p_script)
+{
+  for (uint32_t i = 0; i < p_script->ref_count; i++) {
+    const script_ref_t* p_ref = &p_script->p_refs[i];
+    if (p_ref->kind != ID_SLOT_SCRIPT && is_id_dirty(p_ref->id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//---------------------------------------------------------
+// Screen box of one drawing of a script, including everything it draws.
+// Records where each script landed this frame and adds the old and new
+// boxes of the ones that changed to the damage. *p_changed is set if
+// anything in the tree changed, and *p_leaks if the tree changes the
+// state of whatever draws it, as tree_box works out.
+//
+// What a script draws after a child that leaks state lands wherever that
+// state puts it, so the script's box is taken to be everything, and the
+// whole frame is damaged when anything in its tree changes.
+static bbox_t visit_damage(sid_t id, matrix_t m,
+                           float stroke_width, float font_size,
+                           int depth, bbox_t* p_damage,
+                           bool* p_changed, bool* p_leaks)
+{
+  script_t* p_script = get_script(id);
+  if (!p_script) {
+    return bbox_empty;
+  }
+
+  // scripts that draw themselves can't be bounded
+  if (p_script->f_in_damage || depth > MAX_SCRIPT_DEPTH) {
+    *p_leaks = true;
+    return bbox_infinite;
+  }
+  p_script->f_in_damage = true;
+
+  bool first = (p_script->frame_mark != frame_mark);
+  if (first) {
+    p_script->frame_mark = frame_mark;
+    p_script->last_screen_box = p_script->screen_box;
+    p_script->screen_box = bbox_empty;
+    p_script->f_damaged = is_id_dirty(p_script->id) || refs_dirty(p_script);
+  }
+
+  bbox_t box = own_screen_box(&p_script->bounds, m, stroke_width, font_size);
+  bool f_changed = p_script->f_damaged;
+  bool f_leaks = p_script->bounds.f_leaks_state;
+  bool f_child_leaks_any = false;
+
+  for (uint32_t i = 0; i < p_script->ref_count; i++) {
+    const script_ref_t* p_ref = &p_script->p_refs[i];
+    if (p_ref->kind != ID_SLOT_SCRIPT) {
+      continue;
+    }
+    bool f_child_changed = false;
+    bool f_child_leaks = false;
+    bbox_t child_box = visit_damage(
+      p_ref->id,
+      matrix_multiply(m, p_ref->tx),
+      (p_ref->stroke_width >= 0) ? p_ref->stroke_width : stroke_width,
+      (p_ref->font_size >= 0) ? p_ref->font_size : font_size,
+      depth + 1, p_damage, &f_child_changed, &f_child_leaks);
+    if (!p_ref->f_contained && f_child_leaks) {
+      f_child_leaks_any = true;
+    }
+    box = bbox_union(box, child_box);
+    f_changed = f_changed || f_child_changed;
+  }
+
+  if (f_child_leaks_any) {
+    box = bbox_infinite;
+    f_leaks = true;
+    if (f_changed) {
+      *p_damage = bbox_infinite;
+    }
+  }
+
+  p_script->f_in_damage = false;
+  p_script->screen_box = bbox_union(p_script->screen_box, box);
+  *p_changed = *p_changed || f_changed;
+  *p_leaks = *p_leaks || f_leaks;
+
+  if (p_script->f_damaged) {
+    *p_damage = bbox_union(*p_damage, box);
+    if (first) {
+      *p_damage = bbox_union(*p_damage, p_script->last_screen_box);
+    }
+  }
+
+  return box;
+}
 
 //---------------------------------------------------------
-typedef struct _script_t {
-  sid_t id;
-  data_t script;
-  tommy_hashlin_node  node;
-} script_t;
+// start working out the damage for a new frame. Must be called before
+// the dirty ids are cleared
+void start_script_damage(bbox_t* p_damage)
+{
+  frame_mark++;
+  *p_damage = deleted_damage;
+  deleted_damage = bbox_empty;
+}
 
+//---------------------------------------------------------
+// add the damage from the tree of scripts drawn from id at offset x,y
+void add_script_damage(sid_t id, float x, float y, bbox_t* p_damage)
+{
+  bool f_changed = false;
+  bool f_leaks = false;
+  visit_damage(id, matrix_translate(matrix_identity, x, y),
+               DEFAULT_STROKE_WIDTH, DEFAULT_FONT_SIZE, 0, p_damage,
+               &f_changed, &f_leaks);
+}
 
-// #define HASH_ID(id)  tommy_inthash_u32(id)
-#define HASH_ID(id)  tommy_hash_u32( 0, id.p_data, id.size )
+//=============================================================================
+// culling
 
-tommy_hashlin   scripts = {0};
+#define RENDER_STATE_DEPTH 256
+
+//---------------------------------------------------------
+// The part of the renderer state that decides where things land. It is
+// followed op by op as scripts are rendered, including into the scripts
+// they draw. If the state stack gets too deep to follow, nothing more is
+// culled until a pop brings back a known state.
+typedef struct {
+  matrix_t tx;
+  bbox_t clip;
+  float stroke_width;
+  float font_size;
+  bool f_known;
+} render_state_t;
+
+// Each thread rendering part of the frame follows the state on its own
+static __thread bbox_t render_view = {0};
+static __thread render_state_t render_state = {0};
+static __thread render_state_t render_stack[RENDER_STATE_DEPTH];
+static __thread uint32_t render_depth = 0;
+// pushes past the end of render_stack
+static __thread uint32_t render_overflow = 0;
 
+// tree_box fills in its cache as it goes, so threads take turns at it
+static pthread_mutex_t tree_box_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 //---------------------------------------------------------
-void init_scripts( void ) {
-  // init the hash table
-  tommy_hashlin_init( &scripts );
-}
+// Extent of everything a script draws, in its own space. Also works out
+// which styles the tree takes from whoever draws it and how many ops it
+// runs. The result is cached until a script is stored or deleted.
+static bbox_t tree_box(script_t* p_script,
+                       float stroke_width, float font_size, int depth)
+{
+  if ((p_script->tree_mark == tree_generation)
+      && (p_script->tree_stroke_width == stroke_width)
+      && (p_script->tree_font_size == font_size)) {
+    return p_script->tree_box;
+  }
 
-//=============================================================================
-// internal utilities for working with the script hash
+  // scripts that draw themselves can't be bounded
+  if (p_script->f_in_tree || depth > MAX_SCRIPT_DEPTH) {
+    p_script->f_tree_leaks_state = true;
+    return bbox_infinite;
+  }
+  p_script->f_in_tree = true;
 
-// isolate all knowledge of the hash table implementation to these functions
+  bbox_t box = own_screen_box(&p_script->bounds, matrix_identity,
+                              stroke_width, font_size);
+  bool f_leaks = p_script->bounds.f_leaks_state;
+  uint32_t inherits = p_script->bounds.inherits;
+  uint32_t ops = p_script->op_count;
+
+  for (uint32_t i = 0; i < p_script->ref_count; i++) {
+    const script_ref_t* p_ref = &p_script->p_refs[i];
+    if (p_ref->kind != ID_SLOT_SCRIPT) {
+      continue;
+    }
+    script_t* p_child = get_script(p_ref->id);
+    if (!p_child) {
+      continue;
+    }
+    bbox_t child_box = tree_box(
+      p_child,
+      (p_ref->stroke_width >= 0) ? p_ref->stroke_width : stroke_width,
+      (p_ref->font_size >= 0) ? p_ref->font_size : font_size,
+      depth + 1);
+    box = bbox_union(box, bbox_transform(p_ref->tx, child_box));
+    if (!p_ref->f_contained && p_child->f_tree_leaks_state) {
+      f_leaks = true;
+    }
+    // the child can use whatever this script set before drawing it
+    inherits |= p_child->tree_inherits & ~p_ref->styles;
+    ops = (ops + p_child->tree_ops < ops) ? UINT32_MAX : ops + p_child->tree_ops;
+  }
+
+  p_script->f_in_tree = false;
+  p_script->tree_mark = tree_generation;
+  p_script->tree_stroke_width = stroke_width;
+  p_script->tree_font_size = font_size;
+  p_script->tree_box = box;
+  p_script->f_tree_leaks_state = f_leaks;
+  p_script->tree_inherits = inherits;
+  p_script->tree_ops = ops;
+  return box;
+}
 
 //---------------------------------------------------------
-static int _comparator(const void* p_arg, const void* p_obj)
+static void render_push_state(void)
 {
-  const sid_t* p_id = p_arg;
-  const script_t* p_script = p_obj;
-  return (p_id->size != p_script->id.size)
-    || memcmp(p_id->p_data, p_script->id.p_data, p_id->size);
+  if (render_overflow || render_depth >= RENDER_STATE_DEPTH) {
+    render_overflow++;
+    render_state.f_known = false;
+    return;
+  }
+  render_stack[render_depth++] = render_state;
 }
 
 //---------------------------------------------------------
-script_t* get_script(sid_t id)
+static void render_pop_state(void)
 {
-  return tommy_hashlin_search(&scripts,
-                              _comparator,
-                              &id,
-                              HASH_ID(id));
+  if (render_overflow) {
+    render_overflow--;
+    return;
+  }
+  if (render_depth > 0) {
+    render_state = render_stack[--render_depth];
+  }
 }
 
 //---------------------------------------------------------
-void do_delete_script(sid_t id)
+// true if the script, and everything it draws, would land outside of
+// the clip. Scripts that change the state of whatever draws them are
+// never culled, since what comes after depends on them.
+static bool cull_script(sid_t id)
 {
   script_t* p_script = get_script(id);
-  if (p_script) {
-    if (g_opts.debug_mode) {
-      log_debug("%s id:'%.*s'", __func__,
-                id.size, id.p_data);
-    }
+  if (!p_script || !render_state.f_known) {
+    return false;
+  }
 
-    tommy_hashlin_remove_existing(&scripts,
-                                  &p_script->node);
-    free(p_script);
+  pthread_mutex_lock(&tree_box_mutex);
+  bbox_t box = tree_box(p_script, render_state.stroke_width,
+                        render_state.font_size, 0);
+  bool f_leaks = p_script->f_tree_leaks_state;
+  pthread_mutex_unlock(&tree_box_mutex);
+  if (f_leaks) {
+    return false;
   }
+  return !bbox_intersects(bbox_transform(render_state.tx, box),
+                          render_state.clip);
 }
 
 //---------------------------------------------------------
-void put_script(uint32_t* p_msg_length)
+// set up culling for the tree of scripts about to be drawn from x,y.
+// view is the visible area in script coordinates
+void begin_script_render(bbox_t view, float x, float y)
 {
-  // read in the length of the id, which is in the first four bytes
-  uint32_t id_length;
-  read_bytes_down(&id_length, sizeof(uint32_t), p_msg_length);
+  render_view = view;
+  render_state = (render_state_t){
+    matrix_translate(matrix_identity, x, y),
+    view,
+    DEFAULT_STROKE_WIDTH,
+    DEFAULT_FONT_SIZE,
+    true
+  };
+  render_depth = 0;
+  render_overflow = 0;
+}
 
-  // initialize a record to hold the script
-  int struct_size = ALIGN_UP(sizeof(script_t), 8);
-  int id_size = ALIGN_UP(id_length, 8);
-  int alloc_size = struct_size + id_size + *p_msg_length;
-  script_t *p_script = malloc(alloc_size);
-  if ( !p_script ) {
-    log_error("Unable to allocate script");
-    return;
-  }
+//=============================================================================
+// layers
 
-  // initialize the id
-  p_script->id.size = id_length;
-  p_script->id.p_data = ((void*)p_script) + struct_size;
-  read_bytes_down(p_script->id.p_data, id_length, p_msg_length);
+// Scripts whose trees don't change can be drawn once into an offscreen
+// layer and then put on screen as a single image, frame after frame. Only
+// trees that set every style they draw with and leave no state behind are
+// layered, since those look the same wherever they are drawn from. A
+// layer is dropped when anything in its tree is stored or deleted, and
+// drawn again when the scale it is drawn at moves too far from the one it
+// was made at. Layers share a memory budget and the least recently used
+// ones go first when it runs out.
 
-  // initialize the data
-  p_script->script.size = *p_msg_length;
-  p_script->script.p_data = ((void*)p_script) + struct_size + id_size;
-  read_bytes_down(p_script->script.p_data, *p_msg_length, p_msg_length);
+// frames a script has to be drawn before it gets a layer, so scripts that
+// change all the time are never worth one
+#define LAYER_WARMUP_FRAMES 3
+// trees smaller than this are as quick to draw as to composite
+#define LAYER_MIN_OPS 32
+// largest layer on either side, in pixels. Most GL devices can do this
+#define LAYER_MAX_SIZE 2048
+// how far the scale can move before the layer is drawn again
+#define LAYER_SCALE_TOLERANCE 0.1f
 
-  // if there is already is a script with the same id, delete it
-  do_delete_script(p_script->id);
+static struct {
+  size_t budget;
+  size_t used;
+  uint32_t frame;
+  layer_t* p_head;
+  layer_t* p_tail;
+  pthread_mutex_t mutex;
+} g_layers = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
 
-  if (g_opts.debug_mode) {
-    log_debug("%s id:'%.*s'", __func__,
-              p_script->id.size, p_script->id.p_data);
+// set while a layer is being drawn. Scripts inside of one are drawn
+// straight into it
+static __thread bool f_drawing_layer = false;
+
+//---------------------------------------------------------
+static void layer_unlink(layer_t* p_layer)
+{
+  if (p_layer->p_prev) {
+    p_layer->p_prev->p_next = p_layer->p_next;
+  } else {
+    g_layers.p_head = p_layer->p_next;
   }
+  if (p_layer->p_next) {
+    p_layer->p_next->p_prev = p_layer->p_prev;
+  } else {
+    g_layers.p_tail = p_layer->p_prev;
+  }
+  p_layer->p_prev = NULL;
+  p_layer->p_next = NULL;
+}
 
-  // insert the script into the tommy hash
-  tommy_hashlin_insert(&scripts,
-                       &p_script->node,
-                       p_script,
-                       HASH_ID(p_script->id));
+//---------------------------------------------------------
+static void layer_push_front(layer_t* p_layer)
+{
+  p_layer->p_next = g_layers.p_head;
+  if (g_layers.p_head) {
+    g_layers.p_head->p_prev = p_layer;
+  } else {
+    g_layers.p_tail = p_layer;
+  }
+  g_layers.p_head = p_layer;
 }
 
 //---------------------------------------------------------
-void delete_script(uint32_t* p_msg_length)
+static void layer_release(void* v_ctx, layer_t* p_layer)
 {
-  sid_t id;
+  if (p_layer->v_layer) {
+    layer_ops_delete(v_ctx, p_layer->v_layer);
+    g_layers.used -= (size_t)p_layer->width * p_layer->height * 4;
+    p_layer->v_layer = NULL;
+  }
+}
 
-  // read in the length of the id, which is in the first four bytes
-  read_bytes_down(&id.size, sizeof(uint32_t), p_msg_length);
+//---------------------------------------------------------
+// Frees the pixels of least recently used layers until bytes more fit in
+// the budget. Layers already on screen this frame are kept.
+static bool layer_make_room(void* v_ctx, size_t bytes)
+{
+  layer_t* p_layer = g_layers.p_tail;
+  while (p_layer && (g_layers.used + bytes > g_layers.budget)) {
+    if (p_layer->shown_frame != g_layers.frame) {
+      layer_release(v_ctx, p_layer);
+    }
+    p_layer = p_layer->p_prev;
+  }
+  return g_layers.used + bytes <= g_layers.budget;
+}
 
-  // create a temporary buffer and read the id into it
-  id.p_data = malloc(id.size);
-  if (!id.p_data) {
-    log_error("Unable to allocate buffer for the id");
-    return;
+//---------------------------------------------------------
+// Draws the script's tree into the layer, in layer pixels, with the
+// culling state of the frame set aside.
+static bool layer_draw_tree(void* v_ctx, layer_t* p_layer)
+{
+  void* v_layer_ctx = layer_ops_begin(v_ctx, p_layer->v_layer);
+  if (!v_layer_ctx) {
+    return false;
   }
 
-  // read in the body of the id
-  read_bytes_down(id.p_data, id.size, p_msg_length);
+  matrix_t tx = matrix_translate(
+    matrix_scale(matrix_identity, p_layer->scale, p_layer->scale),
+    -p_layer->x, -p_layer->y);
+  script_ops_transform(v_layer_ctx, tx.a, tx.b, tx.c, tx.d, tx.e, tx.f);
 
-  // delete and free
-  do_delete_script(id);
+  bbox_t view = render_view;
+  render_state_t state = render_state;
+  uint32_t depth = render_depth;
+  uint32_t overflow = render_overflow;
 
-  free(id.p_data);
-}
+  render_view = (bbox_t){0, 0, p_layer->width, p_layer->height};
+  render_state = (render_state_t){
+    tx, render_view, state.stroke_width, state.font_size, true
+  };
+  render_overflow = 0;
 
-//---------------------------------------------------------
-void reset_scripts() {
-  // deallocates all the objects iterating the hashtable
-  tommy_hashlin_foreach( &scripts, free );
+  f_drawing_layer = true;
+  render_script(v_layer_ctx, p_layer->p_script->id);
+  f_drawing_layer = false;
 
-  // deallocates the hashtable
-  tommy_hashlin_done( &scripts );
+  render_view = view;
+  render_state = state;
+  render_depth = depth;
+  render_overflow = overflow;
 
-  // re-init the hash table
-  tommy_hashlin_init( &scripts );
+  layer_ops_end(v_ctx, p_layer->v_layer, v_layer_ctx);
+  return true;
 }
 
+//---------------------------------------------------------
+// true if the layer holds the tree, in box, at close enough to scale.
+// Draws it again if it doesn't and it is allowed to.
+static bool layer_update(void* v_ctx, layer_t* p_layer, bbox_t box, float scale)
+{
+  if (p_layer->v_layer
+      && !memcmp(&box, &p_layer->box, sizeof(bbox_t))
+      && (fabsf(scale / p_layer->scale - 1.0f) <= LAYER_SCALE_TOLERANCE)) {
+    return true;
+  }
 
-//=============================================================================
-// rendering
+  // it has already been put on screen this frame at another scale. Only
+  // one of them can come from the layer
+  if (p_layer->v_layer && (p_layer->shown_frame == g_layers.frame)) {
+    return false;
+  }
 
-static inline uint8_t get_byte(void* p, uint32_t offset)
-{
-  return *((uint8_t*)(p + offset));
-}
+  // pad a pixel all round for the antialiasing at the edges
+  bbox_t padded = bbox_pad(box, 1.0f / scale);
+  float w = ceilf((padded.x1 - padded.x0) * scale);
+  float h = ceilf((padded.y1 - padded.y0) * scale);
+  if (!(w >= 1.0f && w <= LAYER_MAX_SIZE && h >= 1.0f && h <= LAYER_MAX_SIZE)) {
+    layer_release(v_ctx, p_layer);
+    return false;
+  }
 
-static inline uint16_t get_uint16(void* p, uint32_t offset)
-{
-  return ntoh_ui16(*((uint16_t*)(p + offset)));
+  if (!p_layer->v_layer || (p_layer->width != w) || (p_layer->height != h)) {
+    layer_release(v_ctx, p_layer);
+    size_t bytes = (size_t)w * h * 4;
+    if (!layer_make_room(v_ctx, bytes)) {
+      return false;
+    }
+    p_layer->v_layer = layer_ops_create(v_ctx, w, h);
+    if (!p_layer->v_layer) {
+      return false;
+    }
+    p_layer->width = w;
+    p_layer->height = h;
+    g_layers.used += bytes;
+  }
+
+  p_layer->box = box;
+  p_layer->x = padded.x0;
+  p_layer->y = padded.y0;
+  p_layer->scale = scale;
+  if (!layer_draw_tree(v_ctx, p_layer)) {
+    layer_release(v_ctx, p_layer);
+    return false;
+  }
+  return true;
 }
 
-static inline uint32_t get_uint32(void* p, uint32_t offset)
+//---------------------------------------------------------
+// Puts the script on screen from its layer, making or updating the layer
+// first if needed. Returns false if the script has to be drawn directly.
+static bool draw_layer(void* v_ctx, sid_t id)
 {
-  return ntoh_ui32(*((uint32_t*)(p + offset)));
+  if (!g_layers.budget || f_drawing_layer) {
+    return false;
+  }
+
+  script_t* p_script = get_script(id);
+  if (!p_script) {
+    return false;
+  }
+
+  pthread_mutex_lock(&tree_box_mutex);
+  bbox_t box = tree_box(p_script, render_state.stroke_width,
+                        render_state.font_size, 0);
+  bool f_layer = !p_script->f_tree_leaks_state
+    && !p_script->tree_inherits
+    && (p_script->tree_ops >= LAYER_MIN_OPS);
+  pthread_mutex_unlock(&tree_box_mutex);
+  if (!f_layer || bbox_is_empty(box) || bbox_is_infinite(box)) {
+    return false;
+  }
+
+  float scale = layer_ops_scale(v_ctx);
+  if (!(scale > 0.0f)) {
+    return false;
+  }
+
+  pthread_mutex_lock(&g_layers.mutex);
+
+  layer_t* p_layer = p_script->p_layer;
+  if (!p_layer) {
+    p_layer = calloc(1, sizeof(layer_t));
+    if (!p_layer) {
+      pthread_mutex_unlock(&g_layers.mutex);
+      return false;
+    }
+    p_layer->p_script = p_script;
+    p_script->p_layer = p_layer;
+    layer_push_front(p_layer);
+  }
+
+  if (p_layer->last_frame != g_layers.frame) {
+    p_layer->last_frame = g_layers.frame;
+    p_layer->frames++;
+    layer_unlink(p_layer);
+    layer_push_front(p_layer);
+  }
+
+  bool f_ready = (p_layer->frames >= LAYER_WARMUP_FRAMES)
+    && layer_update(v_ctx, p_layer, box, scale);
+  if (f_ready) {
+    p_layer->shown_frame = g_layers.frame;
+  }
+
+  pthread_mutex_unlock(&g_layers.mutex);
+
+  // what was drawn this frame stays put until the next one, so the layer
+  // can be put on screen outside of the lock
+  if (f_ready) {
+    layer_ops_draw(v_ctx, p_layer->v_layer, p_layer->x, p_layer->y,
+                   p_layer->width / p_layer->scale,
+                   p_layer->height / p_layer->scale);
+  }
+  return f_ready;
 }
 
-static inline float get_float(void* p, uint32_t offset)
+//---------------------------------------------------------
+// Called at the start of every frame, before the dirty ids are cleared.
+// Drops the layers of scripts that are gone and the pixels of any whose
+// tree has changed.
+void begin_script_layers(void* v_ctx)
 {
-  return ntoh_f32(*((float*)(p + offset)));
-}
+  // given in megabytes. 0 leaves layers off
+  g_layers.budget = (size_t)g_opts.layer_cache * 1024 * 1024;
+  if (!g_layers.budget) {
+    return;
+  }
 
+  g_layers.frame++;
 
-int padded_advance(int size)
-{
-  switch( size % 4 ) {
-    case 0: return size;
-    case 1: return size + 3;
-    case 2: return size + 2;
-    case 3: return size + 1;
-    default: return size;
-  };
+  bool f_dirty = any_ids_dirty();
+  layer_t* p_layer = g_layers.p_head;
+  while (p_layer) {
+    layer_t* p_next = p_layer->p_next;
+    if (!p_layer->p_script) {
+      layer_unlink(p_layer);
+      layer_release(v_ctx, p_layer);
+      free(p_layer);
+    } else if (f_dirty && script_changed(p_layer->p_script->id)) {
+      layer_release(v_ctx, p_layer);
+      p_layer->frames = 0;
+    }
+    p_layer = p_next;
+  }
 }
 
+//=============================================================================
+// rendering
+
 //---------------------------------------------------------
 void render_script(void* v_ctx, sid_t id)
 {
@@ -197,154 +1753,67 @@ void render_script(void* v_ctx, sid_t id)
   if ( !p_script ) {
     return;
   }
+  int64_t trace_start = trace_begin();
+  profile_frame_t profile;
+  bool f_profile = profile_enter(&profile, p_script->id);
 
   // track the state pushes
   int push_count = 0;
 
-  // setup
-  void* p = p_script->script.p_data;
-  int i = 0;
+  const compiled_op_t* p_op = p_script->p_ops;
+  const compiled_op_t* p_end = p_op + p_script->op_count;
 
-  while (i < p_script->script.size) {
-    script_op_t op = (script_op_t)get_uint16(p, i);
-    uint16_t param = get_uint16(p, i + 2);
-    i += 4;
+  for (; p_op < p_end; p_op++) {
+    uint16_t param = p_op->param;
+    const float* f = p_op->args.f;
+    const coordinates_t* pt = p_op->args.pt;
 
-    switch(op) {
+    switch(p_op->op) {
       case SCRIPT_OP_DRAW_LINE:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t b = {get_float(p, i + 8), get_float(p, i + 12)};
-          script_ops_draw_line(v_ctx, a, b, (param & FLAG_STROKE));
-        }
-        i += 16;
+        script_ops_draw_line(v_ctx, pt[0], pt[1], (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_TRIANGLE:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t b = {get_float(p, i + 8), get_float(p, i + 12)};
-          coordinates_t c = {get_float(p, i + 16), get_float(p, i + 20)};
-          script_ops_draw_triangle(v_ctx, a, b, c, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 24;
+        script_ops_draw_triangle(v_ctx, pt[0], pt[1], pt[2],
+                                 (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_QUAD:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t b = {get_float(p, i + 8), get_float(p, i + 12)};
-          coordinates_t c = {get_float(p, i + 16), get_float(p, i + 20)};
-          coordinates_t d = {get_float(p, i + 24), get_float(p, i + 28)};
-          script_ops_draw_quad(v_ctx, a, b, c, d, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 32;
+        script_ops_draw_quad(v_ctx, pt[0], pt[1], pt[2], pt[3],
+                             (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_RECT:
-        {
-          float w = get_float(p, i);
-          float h = get_float(p, i + 4);
-          script_ops_draw_rect(v_ctx, w, h, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 8;
+        script_ops_draw_rect(v_ctx, f[0], f[1], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_RRECT:
-        {
-          float w = get_float(p, i);
-          float h = get_float(p, i + 4);
-          float radius = get_float(p, i + 8);
-          script_ops_draw_rrect(v_ctx, w, h, radius, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 12;
+        script_ops_draw_rrect(v_ctx, f[0], f[1], f[2], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_RRECTV:
-        {
-          float w = get_float(p, i);
-          float h = get_float(p, i + 4);
-          float ulr = get_float(p, i + 8);
-          float urr = get_float(p, i + 12);
-          float lrr = get_float(p, i + 16);
-          float llr = get_float(p, i + 20);
-          script_ops_draw_rrectv(v_ctx, w, h, ulr, urr, lrr, llr, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 24;
+        script_ops_draw_rrectv(v_ctx, f[0], f[1], f[2], f[3], f[4], f[5],
+                               (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_ARC:
-        {
-          float radius = get_float(p, i);
-          float radians = get_float(p, i + 4);
-          script_ops_draw_arc(v_ctx, radius, radians, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 8;
+        script_ops_draw_arc(v_ctx, f[0], f[1], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_SECTOR:
-        {
-          float radius = get_float(p, i);
-          float radians = get_float(p, i + 4);
-          script_ops_draw_sector(v_ctx, radius, radians, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 8;
+        script_ops_draw_sector(v_ctx, f[0], f[1], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_CIRCLE:
-        {
-          float radius = get_float(p, i);
-          script_ops_draw_circle(v_ctx, radius, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 4;
+        script_ops_draw_circle(v_ctx, f[0], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_ELLIPSE:
-        {
-          float radius0 = get_float(p, i);
-          float radius1 = get_float(p, i + 4);
-          script_ops_draw_ellipse(v_ctx, radius0, radius1, (param & FLAG_FILL), (param & FLAG_STROKE));
-        }
-        i += 8;
+        script_ops_draw_ellipse(v_ctx, f[0], f[1], (param & FLAG_FILL), (param & FLAG_STROKE));
         break;
       case SCRIPT_OP_DRAW_TEXT:
-        {
-          uint32_t size = param;
-          const char* text = p + i;
-          script_ops_draw_text(v_ctx, size, text);
-        }
-        i += padded_advance( param );
+        script_ops_draw_text(v_ctx, p_op->args.text.size, p_op->args.text.p_data);
         break;
       case SCRIPT_OP_DRAW_SPRITES:
-        {
-          uint32_t count = get_uint32(p, i);
-          sprite_t* sprites = malloc(count * sizeof(sprite_t));
-
-          i += sizeof(uint32_t);
-
-          // get the id
-          sid_t id;
-          id.size = param;
-          id.p_data = p + i;
-          i += padded_advance(param);
-
-          // loop the draw commands and draw each
-          for (int n = 0; n < count; n++) {
-            sprites[n] = (sprite_t){
-              .sx = get_float(p, i),
-              .sy = get_float(p, i + 4),
-              .sw = get_float(p, i + 8),
-              .sh = get_float(p, i + 12),
-              .dx = get_float(p, i + 16),
-              .dy = get_float(p, i + 20),
-              .dw = get_float(p, i + 24),
-              .dh = get_float(p, i + 28),
-              .alpha = get_float( p, i + 32 )
-            };
-
-            i += 36;
-          }
-          script_ops_draw_sprites(v_ctx, id, count, sprites);
-          free(sprites);
-        }
+        script_ops_draw_sprites(v_ctx, p_op->args.sprites.id,
+                                p_op->args.sprites.count,
+                                p_op->args.sprites.p_sprites);
         break;
       case SCRIPT_OP_DRAW_SCRIPT:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_draw_script(v_ctx, id);
-        i += padded_advance(param);
+        if (!cull_script(p_op->args.id) && !draw_layer(v_ctx, p_op->args.id)) {
+          script_ops_draw_script(v_ctx, p_op->args.id);
+        }
         break;
       case SCRIPT_OP_BEGIN_PATH:
         script_ops_begin_path(v_ctx);
@@ -359,319 +1828,180 @@ void render_script(void* v_ctx, sid_t id)
         script_ops_stroke_path(v_ctx);
         break;
       case SCRIPT_OP_MOVE_TO:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          script_ops_move_to(v_ctx, a);
-        }
-        i += 8;
+        script_ops_move_to(v_ctx, pt[0]);
         break;
       case SCRIPT_OP_LINE_TO:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          script_ops_line_to(v_ctx, a);
-        }
-        i += 8;
+        script_ops_line_to(v_ctx, pt[0]);
         break;
       case SCRIPT_OP_ARC_TO:
-        {
-          coordinates_t a = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t b = {get_float(p, i + 8), get_float(p, i + 12)};
-          float radius = get_float(p, i + 16);
-          script_ops_arc_to(v_ctx, a, b, radius);
-        }
-        i += 20;
+        script_ops_arc_to(v_ctx, pt[0], pt[1], f[4]);
         break;
       case SCRIPT_OP_BEZIER_TO:
-        {
-          coordinates_t c0 = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t c1 = {get_float(p, i + 8), get_float(p, i + 12)};
-          coordinates_t a = {get_float(p, i + 16), get_float(p, i + 20)};
-          script_ops_bezier_to(v_ctx, c0, c1, a);
-        }
-        i += 24;
+        script_ops_bezier_to(v_ctx, pt[0], pt[1], pt[2]);
         break;
       case SCRIPT_OP_QUADRATIC_TO:
-        {
-          coordinates_t c = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t a = {get_float(p, i + 8), get_float(p, i + 12)};
-          script_ops_quadratic_to(v_ctx, c, a);
-        }
-        i += 16;
+        script_ops_quadratic_to(v_ctx, pt[0], pt[1]);
         break;
       case SCRIPT_OP_ARC:
-        {
-          coordinates_t c = {get_float(p, i), get_float(p, i + 4)};
-          float radius = get_float(p, i + 8);
-          float a0 = get_float(p, i + 12);
-          float a1 = get_float(p, i + 16);
-          sweep_dir_t sweep_dir = get_uint32(p, i + 20);
-          script_ops_arc(v_ctx, c, radius, a0, a1, sweep_dir);
-        }
-        i += 24;
+        script_ops_arc(v_ctx, p_op->args.arc.c,
+                       p_op->args.arc.radius,
+                       p_op->args.arc.a0,
+                       p_op->args.arc.a1,
+                       p_op->args.arc.sweep_dir);
         break;
       case SCRIPT_OP_POP_STATE:
         if (push_count > 0) {
           push_count--;
           script_ops_pop_state(v_ctx);
+          render_pop_state();
         }
         break;
       case SCRIPT_OP_POP_PUSH_STATE:
         if (push_count > 0) {
           push_count--;
           script_ops_pop_state(v_ctx);
+          render_pop_state();
         }
         // [[fallthrough]];
       case SCRIPT_OP_PUSH_STATE:
         push_count++;
         script_ops_push_state(v_ctx);
+        render_push_state();
         break;
 
       // case 0x43:        // clear
       case SCRIPT_OP_SCISSOR:
-        {
-          float w = get_float(p, i);
-          float h = get_float(p, i + 4);
-          script_ops_scissor(v_ctx, w, h);
-        }
-        i += 8;
+        script_ops_scissor(v_ctx, f[0], f[1]);
+        // nanovg replaces the scissor where cairo intersects with it, so
+        // only the new rectangle is relied on
+        render_state.clip = bbox_intersect(
+          render_view,
+          bbox_transform(render_state.tx, bbox_of_rect(0, 0, f[0], f[1])));
         break;
 
       case SCRIPT_OP_TRANSFORM:
-        {
-          float a = get_float(p, i);
-          float b = get_float(p, i + 4);
-          float c = get_float(p, i + 8);
-          float d = get_float(p, i + 12);
-          float e = get_float(p, i + 16);
-          float f = get_float(p, i + 20);
-          script_ops_transform(v_ctx, a, b, c, d, e, f);
-        }
-        i += 24;
+        script_ops_transform(v_ctx, f[0], f[1], f[2], f[3], f[4], f[5]);
+        render_state.tx = matrix_multiply(render_state.tx,
+                                          (matrix_t){f[0], f[1], f[2], f[3], f[4], f[5]});
         break;
       case SCRIPT_OP_SCALE:
-        {
-          float x = get_float(p, i);
-          float y = get_float(p, i + 4);
-          script_ops_scale(v_ctx, x, y);
-        }
-        i += 8;
+        script_ops_scale(v_ctx, f[0], f[1]);
+        render_state.tx = matrix_scale(render_state.tx, f[0], f[1]);
         break;
       case SCRIPT_OP_ROTATE:
-        {
-          float radians = get_float(p, i);
-          script_ops_rotate(v_ctx, radians);
-        }
-        i += 4;
+        script_ops_rotate(v_ctx, f[0]);
+        render_state.tx = matrix_rotate(render_state.tx, f[0]);
         break;
       case SCRIPT_OP_TRANSLATE:
-        {
-          float x = get_float(p, i);
-          float y = get_float(p, i + 4);
-          script_ops_translate(v_ctx, x, y);
-        }
-        i += 8;
+        script_ops_translate(v_ctx, f[0], f[1]);
+        render_state.tx = matrix_translate(render_state.tx, f[0], f[1]);
         break;
       case SCRIPT_OP_FILL_COLOR:
-        {
-          color_rgba_t color = {
-            get_byte(p,i),
-            get_byte(p,i+1),
-            get_byte(p,i+2),
-            get_byte(p,i+3)
-          };
-          script_ops_fill_color(v_ctx, color);
-        }
-        i += 4;
+        script_ops_fill_color(v_ctx, p_op->args.color);
         break;
       case SCRIPT_OP_FILL_LINEAR:
         {
-          coordinates_t start = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t end = {get_float(p, i + 8), get_float(p, i + 12)};
-          color_rgba_t color_start = {
-            get_byte(p, i + 16),
-            get_byte(p, i + 17),
-            get_byte(p, i + 18),
-            get_byte(p, i + 19)
-          };
-          color_rgba_t color_end = {
-            get_byte(p, i + 20),
-            get_byte(p, i + 21),
-            get_byte(p, i + 22),
-            get_byte(p, i + 23)
-          };
+          coordinates_t start = {p_op->args.gradient.f[0], p_op->args.gradient.f[1]};
+          coordinates_t end = {p_op->args.gradient.f[2], p_op->args.gradient.f[3]};
           script_ops_fill_linear(v_ctx,
                                  start, end,
-                                 color_start, color_end);
+                                 p_op->args.gradient.start,
+                                 p_op->args.gradient.end);
         }
-        i += 24;
         break;
       case SCRIPT_OP_FILL_RADIAL:
         {
-          coordinates_t center = {get_float(p, i), get_float(p, i + 4)};
-          float inner_radius = get_float(p, i + 8);
-          float outer_radius = get_float(p, i + 12);
-          color_rgba_t color_start = {
-            get_byte(p, i + 16),
-            get_byte(p, i + 17),
-            get_byte(p, i + 18),
-            get_byte(p, i + 19)
-          };
-          color_rgba_t color_end = {
-            get_byte(p, i + 20),
-            get_byte(p, i + 21),
-            get_byte(p, i + 22),
-            get_byte(p, i + 23)
-          };
+          coordinates_t center = {p_op->args.gradient.f[0], p_op->args.gradient.f[1]};
           script_ops_fill_radial(v_ctx, center,
-                                 inner_radius,
-                                 outer_radius,
-                                 color_start, color_end);
+                                 p_op->args.gradient.f[2],
+                                 p_op->args.gradient.f[3],
+                                 p_op->args.gradient.start,
+                                 p_op->args.gradient.end);
         }
-        i += 24;
         break;
       case SCRIPT_OP_FILL_IMAGE:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_fill_image(v_ctx, id);
-        i += padded_advance(param);
-      break;
+        script_ops_fill_image(v_ctx, p_op->args.id);
+        break;
       case SCRIPT_OP_FILL_STREAM:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_fill_stream(v_ctx, id);
-        i += padded_advance(param);
-      break;
+        script_ops_fill_stream(v_ctx, p_op->args.id);
+        break;
 
       case SCRIPT_OP_STROKE_WIDTH:
-        {
-          float w = param / 4.0;
-          script_ops_stroke_width(v_ctx, w);
-        }
+        script_ops_stroke_width(v_ctx, f[0]);
+        render_state.stroke_width = f[0];
         break;
       case SCRIPT_OP_STROKE_COLOR:
-        {
-          color_rgba_t color = {
-            get_byte(p, i),
-            get_byte(p, i + 1),
-            get_byte(p, i + 2),
-            get_byte(p, i + 3)
-          };
-          script_ops_stroke_color(v_ctx, color);
-        }
-        i += 4;
+        script_ops_stroke_color(v_ctx, p_op->args.color);
         break;
       case SCRIPT_OP_STROKE_LINEAR:
         {
-          coordinates_t start = {get_float(p, i), get_float(p, i + 4)};
-          coordinates_t end = {get_float(p, i + 8), get_float(p, i + 12)};
-          color_rgba_t color_start = {
-            get_byte(p, i + 16),
-            get_byte(p, i + 17),
-            get_byte(p, i + 18),
-            get_byte(p, i + 19)
-          };
-          color_rgba_t color_end = {
-            get_byte(p, i + 20),
-            get_byte(p, i + 21),
-            get_byte(p, i + 22),
-            get_byte(p, i + 23)
-          };
+          coordinates_t start = {p_op->args.gradient.f[0], p_op->args.gradient.f[1]};
+          coordinates_t end = {p_op->args.gradient.f[2], p_op->args.gradient.f[3]};
           script_ops_stroke_linear(v_ctx,
                                    start, end,
-                                   color_start, color_end);
+                                   p_op->args.gradient.start,
+                                   p_op->args.gradient.end);
         }
-        i += 24;
         break;
       case SCRIPT_OP_STROKE_RADIAL:
         {
-          coordinates_t center = {get_float(p, i), get_float(p, i + 4)};
-          float inner_radius = get_float(p, i + 8);
-          float outer_radius = get_float(p, i + 12);
-          color_rgba_t color_start = {
-            get_byte(p, i + 16),
-            get_byte(p, i + 17),
-            get_byte(p, i + 18),
-            get_byte(p, i + 19)
-          };
-          color_rgba_t color_end = {
-            get_byte(p, i + 20),
-            get_byte(p, i + 21),
-            get_byte(p, i + 22),
-            get_byte(p, i + 23)
-          };
+          coordinates_t center = {p_op->args.gradient.f[0], p_op->args.gradient.f[1]};
           script_ops_stroke_radial(v_ctx, center,
-                                   inner_radius,
-                                   outer_radius,
-                                   color_start, color_end);
+                                   p_op->args.gradient.f[2],
+                                   p_op->args.gradient.f[3],
+                                   p_op->args.gradient.start,
+                                   p_op->args.gradient.end);
         }
-        i += 24;
         break;
       case SCRIPT_OP_STROKE_IMAGE:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_stroke_image(v_ctx, id);
-        i += padded_advance(param);
-      break;
+        script_ops_stroke_image(v_ctx, p_op->args.id);
+        break;
       case SCRIPT_OP_STROKE_STREAM:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_stroke_stream(v_ctx, id);
-        i += padded_advance(param);
-      break;
+        script_ops_stroke_stream(v_ctx, p_op->args.id);
+        break;
       case SCRIPT_OP_LINE_CAP:
-        {
-          line_cap_t line_cap = (line_cap_t)param;
-          script_ops_line_cap(v_ctx, line_cap);
-        }
+        script_ops_line_cap(v_ctx, (line_cap_t)param);
         break;
       case SCRIPT_OP_LINE_JOIN:
-        {
-          line_join_t line_join = (line_join_t)param;
-          script_ops_line_join(v_ctx, line_join);
-        }
+        script_ops_line_join(v_ctx, (line_join_t)param);
         break;
       case SCRIPT_OP_MITER_LIMIT:
         script_ops_miter_limit(v_ctx, param);
         break;
       case SCRIPT_OP_FONT:
-        // we can reuse the passed in id struct
-        id.size = param;
-        id.p_data = p + i;
-        script_ops_font(v_ctx, id);
-        i += padded_advance(param);
+        script_ops_font(v_ctx, p_op->args.id);
         break;
       case SCRIPT_OP_FONT_SIZE:
-        {
-          float size = param / 4.0;
-          script_ops_font_size(v_ctx, size);
-        }
+        script_ops_font_size(v_ctx, f[0]);
+        render_state.font_size = f[0];
         break;
       case SCRIPT_OP_TEXT_ALIGN:
-        {
-          text_align_t text_align = (text_align_t)param;
-          script_ops_text_align(v_ctx, text_align);
-        }
+        script_ops_text_align(v_ctx, (text_align_t)param);
         break;
       case SCRIPT_OP_TEXT_BASE:
-        {
-          text_base_t text_base = (text_base_t)param;
-          script_ops_text_base(v_ctx, text_base);
-        }
+        script_ops_text_base(v_ctx, (text_base_t)param);
         break;
 
       default:
-        log_error("Unknown script_op: %d", op);
+        // unknown ops are dropped when the script is compiled
         break;
     }
+
+    if (f_profile) {
+      profile_op(&profile, p_op->op);
+    }
   }
 
   // if there are unbalanced pushes, clear them
   while (push_count > 0) {
     push_count--;
     script_ops_pop_state(v_ctx);
+    render_pop_state();
+  }
+
+  if (f_profile) {
+    profile_exit(&profile);
   }
+  trace_end(trace_start, trace_render_script, 0,
+            p_script->id.p_data, p_script->id.size);
 }
@@ -14,4 +14,10 @@ void put_script(uint32_t* p_msg_length);
 void delete_script(uint32_t* p_msg_length);
 
 void reset_scripts();
+void script_stats(uint32_t* p_count, uint64_t* p_bytes);
+bool script_changed(sid_t id);
+void start_script_damage(bbox_t* p_damage);
+void add_script_damage(sid_t id, float x, float y, bbox_t* p_damage);
+void begin_script_layers(void* v_ctx);
+void begin_script_render(bbox_t view, float x, float y);
 void render_script(void* v_ctx, sid_t id);
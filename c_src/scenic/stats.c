@@ -0,0 +1,187 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// Frame timing and resource counts, sent to the caller as MSG_OUT_STATS
+// when it asks. The caller can also ask for them to keep coming every so
+// many milliseconds, which needs no debug logging turned on.
+//
+// Frame times are kept for the most recent frames only. The percentiles
+// are worked out when the message is sent, which is rare next to frames.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "comms.h"
+#include "font.h"
+#include "image.h"
+#include "script.h"
+#include "stats.h"
+
+// frames the percentiles are taken over
+#define STATS_SAMPLES 256
+
+// one row per phase and one for the whole frame
+#define STATS_ROWS (stats_phase_count + 1)
+
+static struct {
+  uint32_t frames;
+  uint32_t frames_skipped;
+  uint64_t bytes_in;
+
+  // ingest since the last frame, which is counted towards the next one
+  int64_t pending_ingest;
+
+  // frame times in microseconds, as a ring
+  uint32_t samples[STATS_ROWS][STATS_SAMPLES];
+  uint32_t next_sample;
+  uint32_t sample_count;
+
+  // 0 only sends when asked
+  uint32_t period;
+  int64_t last_sent;
+} g_stats = {0};
+
+//---------------------------------------------------------
+PACK(typedef struct msg_stats_t
+{
+  uint32_t msg_id;
+  uint32_t frames;
+  uint32_t frames_skipped;
+  uint32_t frames_dropped;
+  // the frames the times cover
+  uint32_t samples;
+  // p50, p95 and p99 of each phase and then the whole frame, in
+  // microseconds
+  uint32_t times[STATS_ROWS][3];
+  uint64_t bytes_in;
+  uint32_t script_count;
+  uint64_t script_bytes;
+  uint32_t image_count;
+  uint64_t image_bytes;
+  uint32_t font_count;
+  uint64_t font_bytes;
+}) msg_stats_t;
+
+//---------------------------------------------------------
+static uint32_t clamp_usecs(int64_t usecs)
+{
+  if (usecs < 0) return 0;
+  if (usecs > UINT32_MAX) return UINT32_MAX;
+  return usecs;
+}
+
+//---------------------------------------------------------
+void stats_add_ingest(int64_t usecs, uint32_t bytes)
+{
+  g_stats.pending_ingest += usecs;
+  g_stats.bytes_in += bytes;
+}
+
+//---------------------------------------------------------
+// the ingest time in phase_usecs is ignored. What came in since the last
+// frame is used instead
+void stats_add_frame(const int64_t phase_usecs[stats_phase_count])
+{
+  uint32_t i = g_stats.next_sample;
+  uint32_t total = 0;
+
+  for (int phase = 0; phase < stats_phase_count; phase++) {
+    int64_t usecs = (phase == stats_phase_ingest)
+      ? g_stats.pending_ingest : phase_usecs[phase];
+    g_stats.samples[phase][i] = clamp_usecs(usecs);
+    total = clamp_usecs((int64_t)total + g_stats.samples[phase][i]);
+  }
+  g_stats.samples[stats_phase_count][i] = total;
+
+  g_stats.next_sample = (i + 1) % STATS_SAMPLES;
+  if (g_stats.sample_count < STATS_SAMPLES) {
+    g_stats.sample_count++;
+  }
+  g_stats.pending_ingest = 0;
+  g_stats.frames++;
+}
+
+//---------------------------------------------------------
+// a render that found nothing to draw. What it took in is left for the
+// next frame that is drawn
+void stats_skip_frame()
+{
+  g_stats.frames_skipped++;
+}
+
+//---------------------------------------------------------
+static int compare_u32(const void* p_a, const void* p_b)
+{
+  uint32_t a = *(const uint32_t*)p_a;
+  uint32_t b = *(const uint32_t*)p_b;
+  return (a > b) - (a < b);
+}
+
+//---------------------------------------------------------
+// nearest rank of an already sorted set
+static uint32_t percentile(const uint32_t* p_sorted, uint32_t count, uint32_t pct)
+{
+  if (!count) return 0;
+  uint32_t rank = (pct * count + 99) / 100;
+  return p_sorted[rank ? rank - 1 : 0];
+}
+
+//---------------------------------------------------------
+static void send_stats(const driver_data_t* p_data)
+{
+  msg_stats_t msg = {0};
+  msg.msg_id = MSG_OUT_STATS;
+  msg.frames = g_stats.frames;
+  msg.frames_skipped = g_stats.frames_skipped;
+  msg.frames_dropped = p_data->frames_dropped;
+  msg.samples = g_stats.sample_count;
+  msg.bytes_in = g_stats.bytes_in;
+
+  uint32_t sorted[STATS_SAMPLES];
+  for (int row = 0; row < STATS_ROWS; row++) {
+    memcpy(sorted, g_stats.samples[row], g_stats.sample_count * sizeof(uint32_t));
+    qsort(sorted, g_stats.sample_count, sizeof(uint32_t), compare_u32);
+    msg.times[row][0] = percentile(sorted, g_stats.sample_count, 50);
+    msg.times[row][1] = percentile(sorted, g_stats.sample_count, 95);
+    msg.times[row][2] = percentile(sorted, g_stats.sample_count, 99);
+  }
+
+  // the message is packed, so the counts can't be written in place
+  uint32_t count;
+  uint64_t bytes;
+  script_stats(&count, &bytes);
+  msg.script_count = count;
+  msg.script_bytes = bytes;
+  image_stats(&count, &bytes);
+  msg.image_count = count;
+  msg.image_bytes = bytes;
+  font_stats(&count, &bytes);
+  msg.font_count = count;
+  msg.font_bytes = bytes;
+
+  write_cmd((uint8_t*) &msg, sizeof(msg_stats_t));
+  g_stats.last_sent = monotonic_time();
+}
+
+//---------------------------------------------------------
+// Sends the stats now. The message carries how often to keep sending
+// them, in milliseconds, with 0 to stop
+void query_stats(uint32_t* p_msg_length, const driver_data_t* p_data)
+{
+  uint32_t period = 0;
+  read_bytes_down(&period, sizeof(uint32_t), p_msg_length);
+  g_stats.period = period;
+  send_stats(p_data);
+}
+
+//---------------------------------------------------------
+void poll_stats(const driver_data_t* p_data)
+{
+  if (g_stats.period
+      && (monotonic_time() - g_stats.last_sent >= g_stats.period)) {
+    send_stats(p_data);
+  }
+}
@@ -0,0 +1,29 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#pragma once
+
+#include "scenic_types.h"
+
+// the parts of a frame that are timed
+typedef enum {
+  // reading and applying the messages that came in since the last frame
+  stats_phase_ingest,
+  // working out what changed and where
+  stats_phase_interpret,
+  // drawing the scripts through the device
+  stats_phase_backend,
+  // finishing the frame and putting it on screen
+  stats_phase_present,
+  stats_phase_count,
+} stats_phase_t;
+
+void stats_add_ingest(int64_t usecs, uint32_t bytes);
+void stats_add_frame(const int64_t phase_usecs[stats_phase_count]);
+void stats_skip_frame();
+
+void query_stats(uint32_t* p_msg_length, const driver_data_t* p_data);
+void poll_stats(const driver_data_t* p_data);
@@ -0,0 +1,268 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+// A timeline of what the driver spent its time on, for finding out why a
+// device stutters. Events go into a ring in memory that keeps the most
+// recent ones, and are written out as a Chrome trace on request, which
+// chrome://tracing and Perfetto can open.
+//
+// Recording an event is two counter reads and a copy into the ring. Any
+// thread can record. Each takes its own slot with an atomic add, so there
+// are no locks. Tracing is started, stopped and dumped by the messages
+// from the caller, which are handled between frames while no other thread
+// is recording.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comms.h"
+#include "scenic_ops.h"
+#include "trace.h"
+
+#define TRACE_NAME_SIZE 32
+
+typedef struct {
+  int64_t start;
+  int64_t duration;
+  uint32_t kind;
+  uint32_t thread;
+  uint32_t arg;
+  uint32_t name_size;
+  char name[TRACE_NAME_SIZE];
+} trace_event_t;
+
+volatile bool g_tracing = false;
+
+static struct {
+  trace_event_t* p_events;
+  // the ring size is a power of two
+  uint64_t mask;
+  // events recorded so far. The ring holds the most recent of them
+  uint64_t next;
+  uint32_t threads;
+  // the counter and the clock when tracing started, which give the
+  // counter's rate when the trace is written
+  int64_t start_ticks;
+  int64_t start_ns;
+} g_trace = {0};
+
+// numbered in the order they first record something
+static __thread uint32_t trace_thread = 0;
+
+//---------------------------------------------------------
+void trace_end(int64_t start, trace_kind_t kind, uint32_t arg,
+               const void* p_name, uint32_t name_size)
+{
+  trace_event_t* p_events = g_trace.p_events;
+  if (!start || !p_events) {
+    return;
+  }
+  int64_t end = trace_now();
+
+  if (!trace_thread) {
+    trace_thread = __atomic_add_fetch(&g_trace.threads, 1, __ATOMIC_RELAXED);
+  }
+
+  uint64_t index = __atomic_fetch_add(&g_trace.next, 1, __ATOMIC_RELAXED);
+  trace_event_t* p_event = &p_events[index & g_trace.mask];
+  p_event->start = start;
+  p_event->duration = end - start;
+  p_event->kind = kind;
+  p_event->thread = trace_thread;
+  p_event->arg = arg;
+  if (name_size > TRACE_NAME_SIZE) {
+    name_size = TRACE_NAME_SIZE;
+  }
+  p_event->name_size = name_size;
+  if (name_size) {
+    memcpy(p_event->name, p_name, name_size);
+  }
+}
+
+//---------------------------------------------------------
+static void trace_stop()
+{
+  g_tracing = false;
+  free(g_trace.p_events);
+  g_trace.p_events = NULL;
+  g_trace.mask = 0;
+  g_trace.next = 0;
+}
+
+//---------------------------------------------------------
+// The message carries the number of events to keep, which is rounded up
+// to a power of two. 0 stops tracing and drops what was recorded
+void start_trace(uint32_t* p_msg_length)
+{
+  uint32_t count = 0;
+  read_bytes_down(&count, sizeof(uint32_t), p_msg_length);
+
+  trace_stop();
+  if (!count) {
+    return;
+  }
+
+  uint64_t size = 1;
+  while (size < count) {
+    size <<= 1;
+  }
+  g_trace.p_events = calloc(size, sizeof(trace_event_t));
+  if (!g_trace.p_events) {
+    log_error("Unable to allocate %u trace events", count);
+    return;
+  }
+  g_trace.mask = size - 1;
+  g_trace.start_ticks = trace_now();
+  g_trace.start_ns = trace_clock_ns();
+  g_tracing = true;
+}
+
+//---------------------------------------------------------
+static const char* op_name(uint32_t op)
+{
+  switch (op) {
+  case scenic_op_put_script: return "put_script";
+  case scenic_op_del_script: return "del_script";
+  case scenic_op_reset: return "reset";
+  case scenic_op_global_tx: return "global_tx";
+  case scenic_op_cursor_tx: return "cursor_tx";
+  case scenic_op_render: return "render";
+  case scenic_op_update_cursor: return "update_cursor";
+  case scenic_op_clear_color: return "clear_color";
+  case scenic_op_quit: return "quit";
+  case scenic_op_query_stats: return "query_stats";
+  case scenic_op_start_trace: return "start_trace";
+  case scenic_op_dump_trace: return "dump_trace";
+  case scenic_op_start_profile: return "start_profile";
+  case scenic_op_query_profile: return "query_profile";
+  case scenic_op_dump_frame: return "dump_frame";
+  case scenic_op_put_font: return "put_font";
+  case scenic_op_put_image: return "put_image";
+  case scenic_op_put_image_shm: return "put_image_shm";
+  case scenic_op_put_image_region: return "put_image_region";
+  default: return "unknown";
+  }
+}
+
+//---------------------------------------------------------
+// ids are whatever the caller named things, so anything that isn't plain
+// ascii is escaped
+static void write_json_string(FILE* p_file, const char* p_str, uint32_t size)
+{
+  fputc('"', p_file);
+  for (uint32_t i = 0; i < size; i++) {
+    unsigned char c = p_str[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', p_file);
+      fputc(c, p_file);
+    } else if (c < 0x20 || c >= 0x7f) {
+      fprintf(p_file, "\\u%04x", c);
+    } else {
+      fputc(c, p_file);
+    }
+  }
+  fputc('"', p_file);
+}
+
+//---------------------------------------------------------
+static void write_event(FILE* p_file, const trace_event_t* p_event,
+                        int64_t origin, double ns_per_tick)
+{
+  fputs("{\"name\":", p_file);
+  switch (p_event->kind) {
+  case trace_dispatch:
+    write_json_string(p_file, op_name(p_event->arg), strlen(op_name(p_event->arg)));
+    fputs(",\"cat\":\"dispatch\"", p_file);
+    break;
+  case trace_render_script:
+    write_json_string(p_file, p_event->name, p_event->name_size);
+    fputs(",\"cat\":\"script\"", p_file);
+    break;
+  case trace_begin_render:
+    fputs("\"begin_render\",\"cat\":\"render\"", p_file);
+    break;
+  case trace_render_scene:
+    fputs("\"render_scene\",\"cat\":\"render\"", p_file);
+    break;
+  case trace_end_render:
+    fputs("\"end_render\",\"cat\":\"render\"", p_file);
+    break;
+  case trace_present:
+    fputs("\"present\",\"cat\":\"render\"", p_file);
+    break;
+  case trace_image_upload:
+    write_json_string(p_file, p_event->name, p_event->name_size);
+    fprintf(p_file, ",\"cat\":\"image\",\"args\":{\"bytes\":%u}", p_event->arg);
+    break;
+  }
+
+  // in microseconds
+  fprintf(p_file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+          (p_event->start - origin) * ns_per_tick / 1000,
+          p_event->duration * ns_per_tick / 1000,
+          p_event->thread);
+}
+
+//---------------------------------------------------------
+// The message carries the path to write to. What was recorded is kept,
+// and recording carries on
+void dump_trace(uint32_t* p_msg_length)
+{
+  uint32_t path_size = *p_msg_length;
+  if (!path_size || (path_size >= PATH_MAX)) {
+    log_error("dump_trace needs a path shorter than %d bytes", PATH_MAX);
+    skip_bytes_down(p_msg_length);
+    return;
+  }
+  char* p_path = read_bytes_in_place(path_size, p_msg_length);
+  if (!p_path) {
+    log_error("dump_trace needs a path");
+    return;
+  }
+  char path[PATH_MAX];
+  memcpy(path, p_path, path_size);
+  path[path_size] = 0;
+
+  FILE* p_file = fopen(path, "w");
+  if (!p_file) {
+    log_error("Unable to open trace file %s", path);
+    return;
+  }
+
+  uint64_t next = g_trace.next;
+  uint64_t count = g_trace.p_events ? g_trace.mask + 1 : 0;
+  uint64_t first = (next > count) ? next - count : 0;
+
+  // times start from the oldest event kept
+  int64_t origin = 0;
+  for (uint64_t i = first; i < next; i++) {
+    const trace_event_t* p_event = &g_trace.p_events[i & g_trace.mask];
+    if (!origin || p_event->start < origin) {
+      origin = p_event->start;
+    }
+  }
+
+  double ns_per_tick = 1.0;
+  int64_t ticks = trace_now() - g_trace.start_ticks;
+  if (g_trace.p_events && (ticks > 0)) {
+    ns_per_tick = (double)(trace_clock_ns() - g_trace.start_ns) / ticks;
+  }
+
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", p_file);
+  for (uint64_t i = first; i < next; i++) {
+    write_event(p_file, &g_trace.p_events[i & g_trace.mask], origin, ns_per_tick);
+    fputs((i + 1 < next) ? ",\n" : "\n", p_file);
+  }
+  fputs("]}\n", p_file);
+
+  if (fclose(p_file)) {
+    log_error("Unable to write trace file %s", path);
+    return;
+  }
+  log_info("Wrote %llu trace events to %s", (unsigned long long)(next - first), path);
+}
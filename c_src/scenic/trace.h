@@ -0,0 +1,70 @@
+/*
+#  Created on 2026-10-18.
+#  Copyright © 2026 Kry10 Limited. All rights reserved.
+#
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+typedef enum {
+  // a message from the caller. arg is the op
+  trace_dispatch,
+  // name is the script id
+  trace_render_script,
+  trace_begin_render,
+  trace_render_scene,
+  trace_end_render,
+  // waiting on the swap or page flip that puts the frame on screen
+  trace_present,
+  // name is the image id and arg the bytes sent to the device
+  trace_image_upload,
+} trace_kind_t;
+
+// set while events are being recorded
+extern volatile bool g_tracing;
+
+// the monotonic clock in nanoseconds, which the counter is measured against
+static inline int64_t trace_clock_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Event times are read from the cpu's counter where there is one, which
+// costs a few nanoseconds against the tens or more clock_gettime can take.
+// They are turned into nanoseconds when the trace is written out.
+static inline int64_t trace_now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  int64_t ticks;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return trace_clock_ns();
+#endif
+}
+
+// Call at the start of something to trace and pass what it returns to
+// trace_end when it is done. Returns 0 when not tracing, which
+// trace_end ignores.
+static inline int64_t trace_begin()
+{
+  return g_tracing ? trace_now() : 0;
+}
+
+void trace_end(int64_t start, trace_kind_t kind, uint32_t arg,
+               const void* p_name, uint32_t name_size);
+
+void start_trace(uint32_t* p_msg_length);
+void dump_trace(uint32_t* p_msg_length);
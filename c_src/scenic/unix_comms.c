@@ -1,24 +1,163 @@
+#include <stdlib.h>
+
+#include "capture.h"
 #include "common.h"
 
+//=============================================================================
+// buffered stdin
+//
+// Messages from the caller tend to arrive in bursts of many small ones.
+// They are read through a buffer in large chunks, rather than with a
+// read() per field. Buffered bytes are always contiguous from in_start,
+// so a whole message can be handed out in place.
+
+#define IN_BUFFER_SIZE (64 * 1024)
+
+static uint8_t* p_in = NULL;
+static uint32_t in_capacity = 0;
+static uint32_t in_start = 0;
+static uint32_t in_end = 0;
+
+//---------------------------------------------------------
+static inline uint32_t in_buffered()
+{
+  return in_end - in_start;
+}
+
+//---------------------------------------------------------
+static inline void consume_in(uint32_t len)
+{
+  in_start += len;
+  if (in_start == in_end) {
+    in_start = in_end = 0;
+  }
+}
+
+//---------------------------------------------------------
+// forget whatever is buffered, for when stdin has been moved elsewhere
+void reset_in()
+{
+  in_start = in_end = 0;
+}
+
+//---------------------------------------------------------
+// make room for at least len contiguous bytes from in_start
+static bool reserve_in(uint32_t len)
+{
+  if (in_capacity - in_start >= len) {
+    return true;
+  }
+
+  // move whatever is still buffered to the front
+  uint32_t buffered = in_buffered();
+  if (in_start) {
+    memmove(p_in, p_in + in_start, buffered);
+    in_start = 0;
+    in_end = buffered;
+  }
+  if (in_capacity >= len) {
+    return true;
+  }
+
+  uint32_t size = in_capacity ? in_capacity : IN_BUFFER_SIZE;
+  while (size < len) {
+    size *= 2;
+  }
+  uint8_t* p = realloc(p_in, size);
+  if (!p) {
+    return false;
+  }
+  p_in = p;
+  in_capacity = size;
+  return true;
+}
+
+//---------------------------------------------------------
+// read until at least len bytes are buffered. Returns the number that
+// are, or what the failing read() returned
+static int fill_in(uint32_t len)
+{
+  if (!reserve_in(len)) {
+    return -1;
+  }
+
+  while (in_buffered() < len) {
+    int i = read(0, p_in + in_end, in_capacity - in_end);
+    if (i <= 0)
+      return (i);
+    in_end += i;
+  }
+
+  return in_buffered();
+}
+
+//---------------------------------------------------------
+// consume the next len bytes without copying them. The pointer is good
+// until the next read from stdin
+void* read_in_place(uint32_t len)
+{
+  int got = fill_in(len);
+  if ((got < 0) || ((uint32_t)got < len)) {
+    return NULL;
+  }
+
+  void* p = p_in + in_start;
+  consume_in(len);
+  capture_bytes(p, len);
+  return p;
+}
+
 //=============================================================================
 // raw comms with host app
 // from erl_comm.c
 // http://erlang.org/doc/tutorial/c_port.html#id64377
 //---------------------------------------------------------
-int read_exact(uint8_t* buf, int len)
+static int read_in(uint8_t* buf, int len)
 {
   int i, got = 0;
 
-  do
-  {
-    if ((i = read(0, buf + got, len - got)) <= 0)
-      return (i);
-    got += i;
-  } while (got < len);
+  if (len < 0)
+    return (-1);
+
+  // hand out what is already buffered first
+  if (in_buffered()) {
+    got = (in_buffered() < (uint32_t)len) ? (int)in_buffered() : len;
+    memcpy(buf, p_in + in_start, got);
+    consume_in(got);
+  }
+  if (got == len)
+    return (len);
+
+  // large reads, like image blobs, go straight into the caller's memory
+  if (len - got >= IN_BUFFER_SIZE / 2) {
+    do
+    {
+      if ((i = read(0, buf + got, len - got)) <= 0)
+        return (i);
+      got += i;
+    } while (got < len);
+
+    return (len);
+  }
+
+  if ((i = fill_in(len - got)) <= 0)
+    return (i);
+  memcpy(buf + got, p_in + in_start, len - got);
+  consume_in(len - got);
 
   return (len);
 }
 
+//---------------------------------------------------------
+int read_exact(uint8_t* buf, int len)
+{
+  int got = read_in(buf, len);
+  if (got == len) {
+    capture_bytes(buf, len);
+  }
+  return got;
+}
+
 //---------------------------------------------------------
 int write_exact(uint8_t* buf, int len)
 {
@@ -48,20 +187,22 @@ int read_msg_length(struct timeval * ptv)
   fd_set rfds;
   int    retval;
 
-  // Watch stdin (fd 0) to see when it has input.
+  // Watch stdin (fd 0) to see when it has input. There is no need to
+  // wait if the next message is already buffered
   FD_ZERO(&rfds);
   FD_SET(0, &rfds);
 
   // look for data
-  retval = select(1, &rfds, NULL, NULL, ptv);
+  retval = in_buffered() ? 1 : select(1, &rfds, NULL, NULL, ptv);
   if (retval == -1)
   {
     return -1; // error
   }
   else if (retval)
   {
-    if (read_exact(buff, 4) != 4)
+    if (read_in(buff, 4) != 4)
       return (-1);
+    capture_message(buff);
     // length from erlang is always big endian
     uint32_t len = *((uint32_t*) &buff);
 
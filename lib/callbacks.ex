@@ -13,6 +13,7 @@ defmodule Scenic.Driver.Local.Callbacks do
   alias Scenic.Assets.Stream
   alias Scenic.Math.Vector2
 
+  alias Scenic.Driver.Local.Shm
   alias Scenic.Driver.Local.ToPort
 
   import Driver,
@@ -26,6 +27,12 @@ defmodule Scenic.Driver.Local.Callbacks do
   # same as scenic/script.ex
   # @root_id Scenic.ViewPort.root_id()
 
+  # stream payloads smaller than this aren't worth a trip through shared memory
+  @shm_min_bytes 64 * 1024
+
+  # bytes per pixel of the raw bitmap formats
+  @bitmap_bytes %{g: 1, ga: 2, rgb: 3, rgba: 4}
+
   # --------------------------------------------------------
   @doc false
   def reset_scene(%{assigns: %{port: port, media: media}} = driver) do
@@ -35,7 +42,7 @@ defmodule Scenic.Driver.Local.Callbacks do
 
     # state changes
     fonts = Map.get(media, :fonts, [])
-    driver = assign(driver, :media, %{fonts: fonts})
+    driver = assign(driver, media: %{fonts: fonts}, stream_bitmaps: %{})
     {:ok, driver}
   end
 
@@ -118,11 +125,15 @@ defmodule Scenic.Driver.Local.Callbacks do
 
   def update_scene(ids, driver), do: do_update_scene(ids, driver)
 
-  defp do_update_scene(ids, %{assigns: %{port: port, dirty_streams: streams}} = driver) do
+  defp do_update_scene(
+         ids,
+         %{assigns: %{port: port, dirty_streams: streams}} = driver
+       ) do
     # update any pending streams
-    streams
-    |> Enum.uniq()
-    |> Enum.each(&do_put_stream(&1, port))
+    driver =
+      streams
+      |> Enum.uniq()
+      |> Enum.reduce(driver, &do_put_stream/2)
 
     driver =
       driver
@@ -158,19 +169,89 @@ defmodule Scenic.Driver.Local.Callbacks do
 
   # --------------------------------------------------------
   # streaming asset updates
-  defp do_put_stream(id, port) do
+  defp do_put_stream(id, %{assigns: %{port: port, shm: shm}} = driver) do
     case Stream.fetch(id) do
       {:ok, {Stream.Image, {w, h, _mime}, bin}} ->
-        ToPort.put_texture(port, id, :file, w, h, bin)
+        assign(driver, :shm, put_stream_texture(port, shm, id, :file, w, h, bin))
 
       {:ok, {Stream.Bitmap, {w, h, type}, bin}} ->
-        ToPort.put_texture(port, id, type, w, h, bin)
+        put_stream_bitmap(driver, id, type, w, h, bin)
 
       _ ->
-        :ok
+        driver
     end
   end
 
+  # Bitmap streams such as charts often change only a strip at a time.
+  # Compare against the pixels last sent and only send the rows in between
+  # the first and last ones that changed.
+  defp put_stream_bitmap(
+         %{assigns: %{port: port, shm: shm, stream_bitmaps: bitmaps}} = driver,
+         id,
+         type,
+         w,
+         h,
+         bin
+       ) do
+    stride = w * Map.get(@bitmap_bytes, type, 0)
+
+    shm =
+      with {^type, ^w, ^h, prev} when h > 0 and stride > 0 <- Map.get(bitmaps, id),
+           true <- byte_size(bin) == stride * h and byte_size(prev) == byte_size(bin) do
+        case changed_rows(prev, bin, stride, h) do
+          :none ->
+            shm
+
+          {y, rows} when rows * 2 <= h ->
+            region = binary_part(bin, y * stride, rows * stride)
+            ToPort.put_texture_region(port, id, type, 0, y, w, rows, region)
+            shm
+
+          _ ->
+            put_stream_texture(port, shm, id, type, w, h, bin)
+        end
+      else
+        _ -> put_stream_texture(port, shm, id, type, w, h, bin)
+      end
+
+    assign(driver, shm: shm, stream_bitmaps: Map.put(bitmaps, id, {type, w, h, bin}))
+  end
+
+  defp changed_rows(prev, bin, stride, h) do
+    changed? = fn y ->
+      binary_part(prev, y * stride, stride) != binary_part(bin, y * stride, stride)
+    end
+
+    case Enum.find(0..(h - 1), changed?) do
+      nil ->
+        :none
+
+      first ->
+        last = Enum.find((h - 1)..first//-1, changed?)
+        {first, last - first + 1}
+    end
+  end
+
+  # large payloads go through shared memory when it is turned on and a slot
+  # is free. Otherwise they go down the port
+  defp put_stream_texture(port, %Shm{} = shm, id, format, w, h, bin)
+       when byte_size(bin) >= @shm_min_bytes do
+    case Shm.write(shm, bin) do
+      {:ok, path, shm} ->
+        ToPort.put_texture_shm(port, id, format, w, h, path, byte_size(bin))
+        shm
+
+      _err ->
+        ToPort.put_texture(port, id, format, w, h, bin)
+        shm
+    end
+  end
+
+  defp put_stream_texture(port, shm, id, format, w, h, bin) do
+    ToPort.put_texture(port, id, format, w, h, bin)
+    shm
+  end
+
   # defp do_put_stream(Stream.Bitmap, id, %{assigns: %{port: port}} = driver) do
   #   driver = case Stream.fetch(id) do
   #     {:ok, {Stream.Bitmap, {w, h, type}, bin}} ->
@@ -258,30 +339,33 @@ defmodule Scenic.Driver.Local.Callbacks do
 
   defp ensure_streams(driver, []), do: driver
 
-  defp ensure_streams(%{assigns: %{port: port, media: media}} = driver, ids) do
+  defp ensure_streams(
+         %{assigns: %{port: port, media: media, stream_bitmaps: bitmaps}} = driver,
+         ids
+       ) do
     streams = Map.get(media, :streams, [])
 
-    streams =
-      Enum.reduce(ids, streams, fn id, streams ->
+    {streams, bitmaps} =
+      Enum.reduce(ids, {streams, bitmaps}, fn id, {streams, bitmaps} ->
         with false <- Enum.member?(streams, id),
              :ok <- Stream.subscribe(id) do
           case Stream.fetch(id) do
             {:ok, {Stream.Image, {w, h, _format}, bin}} ->
               ToPort.put_texture(port, id, :file, w, h, bin)
-              [id | streams]
+              {[id | streams], bitmaps}
 
             {:ok, {Stream.Bitmap, {w, h, format}, bin}} ->
               ToPort.put_texture(port, id, format, w, h, bin)
-              [id | streams]
+              {[id | streams], Map.put(bitmaps, id, {format, w, h, bin})}
 
             _err ->
-              streams
+              {streams, bitmaps}
           end
         else
-          _ -> streams
+          _ -> {streams, bitmaps}
         end
       end)
 
-    assign(driver, :media, Map.put(media, :streams, streams))
+    assign(driver, media: Map.put(media, :streams, streams), stream_bitmaps: bitmaps)
   end
 end
@@ -42,7 +42,14 @@ defmodule Scenic.Driver.Local do
         {:or, [:mfa, {:in, [:restart, :stop_driver, :stop_viewport, :stop_system, :halt_system]}]},
       default: :restart
     ],
-    input_blacklist: [type: {:list, :string}, default: []]
+    input_blacklist: [type: {:list, :string}, default: []],
+    shared_memory: [type: :boolean],
+    vsync: [type: :boolean],
+    render_threads: [type: :non_neg_integer],
+    dither: [type: :boolean],
+    layer_cache: [type: :non_neg_integer],
+    refresh_rate: [type: :non_neg_integer],
+    capture: [type: :string]
   ]
 
   # @mix_target Mix.Tasks.Compile.ScenicDriverLocal.target()
@@ -66,6 +73,7 @@ defmodule Scenic.Driver.Local do
   alias Scenic.Driver.Local.ToPort
   alias Scenic.Driver.Local.FromPort
   alias Scenic.Driver.Local.Cursor
+  alias Scenic.Driver.Local.Shm
 
   alias Scenic.Math.Matrix
   alias Scenic.Math.Vector2
@@ -179,6 +187,115 @@ defmodule Scenic.Driver.Local do
     Process.send(pid, :_hide_cursor_, [])
   end
 
+  # Frame timing and resource statistics, sent to `to` as
+  # `{:scenic_driver_local_stats, stats}`. stats is a map with the frames
+  # drawn, skipped because nothing changed and dropped behind a later
+  # frame, the p50/p95/p99 times in microseconds of the :ingest,
+  # :interpret, :backend and :present phases and the :total, the bytes
+  # taken in and the count and bytes of the scripts, images and fonts held.
+  #
+  # request_stats sends them once. subscribe_stats sends them now and then
+  # every period_ms until unsubscribe_stats, or until the subscriber exits.
+
+  @spec request_stats(driver :: pid | Driver.t(), to :: pid) :: :ok
+  def request_stats(driver, to \\ self())
+  def request_stats(%Scenic.Driver{pid: pid}, to), do: request_stats(pid, to)
+
+  def request_stats(pid, to) when is_pid(to) do
+    Process.send(pid, {:_request_stats_, to}, [])
+  end
+
+  @spec subscribe_stats(driver :: pid | Driver.t(), period_ms :: pos_integer, to :: pid) :: :ok
+  def subscribe_stats(driver, period_ms, to \\ self())
+
+  def subscribe_stats(%Scenic.Driver{pid: pid}, period_ms, to),
+    do: subscribe_stats(pid, period_ms, to)
+
+  def subscribe_stats(pid, period_ms, to)
+      when is_integer(period_ms) and period_ms > 0 and is_pid(to) do
+    Process.send(pid, {:_subscribe_stats_, to, period_ms}, [])
+  end
+
+  @spec unsubscribe_stats(driver :: pid | Driver.t(), to :: pid) :: :ok
+  def unsubscribe_stats(driver, to \\ self())
+  def unsubscribe_stats(%Scenic.Driver{pid: pid}, to), do: unsubscribe_stats(pid, to)
+
+  def unsubscribe_stats(pid, to) when is_pid(to) do
+    Process.send(pid, {:_unsubscribe_stats_, to}, [])
+  end
+
+  # A timeline of message dispatch, frames, scripts drawn, swaps and image
+  # uploads, kept in memory while tracing. start_trace keeps the most
+  # recent `events` of them. dump_trace writes them to `path`, on the
+  # machine the driver runs on, in the Chrome trace format that Perfetto
+  # and chrome://tracing open.
+
+  @spec start_trace(driver :: pid | Driver.t(), events :: pos_integer) :: :ok
+  def start_trace(driver, events \\ 65536)
+  def start_trace(%Scenic.Driver{pid: pid}, events), do: start_trace(pid, events)
+
+  def start_trace(pid, events) when is_integer(events) and events > 0 do
+    Process.send(pid, {:_start_trace_, events}, [])
+  end
+
+  @spec stop_trace(driver :: pid | Driver.t()) :: :ok
+  def stop_trace(%Scenic.Driver{pid: pid}), do: stop_trace(pid)
+
+  def stop_trace(pid) do
+    Process.send(pid, {:_start_trace_, 0}, [])
+  end
+
+  @spec dump_trace(driver :: pid | Driver.t(), path :: String.t()) :: :ok
+  def dump_trace(%Scenic.Driver{pid: pid}, path), do: dump_trace(pid, path)
+
+  def dump_trace(pid, path) when is_binary(path) do
+    Process.send(pid, {:_dump_trace_, path}, [])
+  end
+
+  # Writes the last frame drawn to `path`, on the machine the driver runs
+  # on. Paths ending in .png get a PNG and anything else the raw 32 bit
+  # ARGB pixels, row by row. Only the cairo devices can do this.
+
+  @spec dump_frame(driver :: pid | Driver.t(), path :: String.t()) :: :ok
+  def dump_frame(%Scenic.Driver{pid: pid}, path), do: dump_frame(pid, path)
+
+  def dump_frame(pid, path) when is_binary(path) do
+    Process.send(pid, {:_dump_frame_, path}, [])
+  end
+
+  # Counts and times every script op and every script drawn while
+  # profiling. start_profile starts afresh and stop_profile stops, keeping
+  # what was gathered. request_profile sends `to` the `top_n` hottest as
+  # `{:scenic_driver_local_profile, profile}`, where profile is a map with
+  # the :elapsed_ns profiled, the :ops by time spent in them, each with its
+  # :count and :time_ns, and the :scripts by time spent in themselves, each
+  # with its :id, :count, :self_ns and :total_ns including the scripts it
+  # draws. An op's time leaves out the scripts it draws.
+
+  @spec start_profile(driver :: pid | Driver.t()) :: :ok
+  def start_profile(%Scenic.Driver{pid: pid}), do: start_profile(pid)
+
+  def start_profile(pid) do
+    Process.send(pid, {:_start_profile_, true}, [])
+  end
+
+  @spec stop_profile(driver :: pid | Driver.t()) :: :ok
+  def stop_profile(%Scenic.Driver{pid: pid}), do: stop_profile(pid)
+
+  def stop_profile(pid) do
+    Process.send(pid, {:_start_profile_, false}, [])
+  end
+
+  @spec request_profile(driver :: pid | Driver.t(), top_n :: pos_integer, to :: pid) :: :ok
+  def request_profile(driver, top_n \\ 20, to \\ self())
+
+  def request_profile(%Scenic.Driver{pid: pid}, top_n, to),
+    do: request_profile(pid, top_n, to)
+
+  def request_profile(pid, top_n, to) when is_integer(top_n) and top_n > 0 and is_pid(to) do
+    Process.send(pid, {:_request_profile_, to, top_n}, [])
+  end
+
   defp put_if_set(opts, key, value)
   defp put_if_set(opts, _key, nil), do: opts
 
@@ -223,6 +340,35 @@ defmodule Scenic.Driver.Local do
     {:ok, title} = Keyword.fetch(window_opts, :title)
     fbdev = Keyword.get(window_opts, :fbdev, "/dev/fb0")
 
+    # on unless turned off. Only the framebuffer devices use it
+    vsync =
+      case opts[:vsync] do
+        false -> 0
+        _ -> 1
+      end
+
+    # the cairo devices can split each frame into bands drawn in parallel.
+    # 0 is one per cpu
+    render_threads = Keyword.get(opts, :render_threads, 1)
+
+    # off unless turned on. Smooths gradients on 16 and 8 bit framebuffers
+    dither =
+      case opts[:dither] do
+        true -> 1
+        _ -> 0
+      end
+
+    # megabytes for offscreen copies of scripts that don't change. 0 is off
+    layer_cache = Keyword.get(opts, :layer_cache, 0)
+
+    # frames a second the cairo-headless device presents at. 0 is as fast
+    # as frames come
+    refresh_rate = Keyword.get(opts, :refresh_rate, 0)
+
+    # file to record the messages sent to the port in, for scenic_replay.
+    # Empty is off
+    capture = Keyword.get(opts, :capture, "")
+
     resizeable =
       case window_opts[:resizeable] do
         true -> 1
@@ -231,7 +377,8 @@ defmodule Scenic.Driver.Local do
 
     args =
       " #{internal_cursor} #{layer} #{opacity} #{antialias} #{debug_mode} #{debug_fps}" <>
-        " #{width} #{height} #{resizeable} #{fbdev} \"#{title}\""
+        " #{width} #{height} #{resizeable} #{fbdev} #{vsync} #{render_threads} #{dither}" <>
+        " #{layer_cache} #{refresh_rate} \"#{capture}\" \"#{title}\""
 
     # open and initialize the window
     Process.flag(:trap_exit, true)
@@ -242,6 +389,20 @@ defmodule Scenic.Driver.Local do
 
     port = Port.open({:spawn, executable}, [:binary, {:packet, 4}])
 
+    # large stream updates can skip the port and go through shared memory
+    shm =
+      with true <- opts[:shared_memory] == true,
+           {:ok, shm} <- Shm.open() do
+        shm
+      else
+        false ->
+          nil
+
+        err ->
+          Logger.warning("#{inspect(__MODULE__)} shared memory unavailable: #{inspect(err)}")
+          nil
+      end
+
     driver =
       assign(driver,
         port: port,
@@ -271,7 +432,12 @@ defmodule Scenic.Driver.Local do
         rel_x: 0,
         rel_y: 0,
         dirty_streams: [],
-        input_blacklist: opts[:input_blacklist]
+        stream_bitmaps: %{},
+        shm: shm,
+        input_blacklist: opts[:input_blacklist],
+        stats_requests: [],
+        stats_subscribers: %{},
+        profile_requests: []
       )
 
     # send message to set up the cursor later
@@ -369,9 +535,12 @@ defmodule Scenic.Driver.Local do
   # handle the port exiting
   def handle_info(
         {:EXIT, port_id, :normal},
-        %{assigns: %{port: port, closing: closing}} = driver
+        %{assigns: %{port: port, closing: closing, shm: shm}} = driver
       )
       when port_id == port do
+    Shm.close(shm)
+    driver = assign(driver, :shm, nil)
+
     if closing do
       Logger.info("#{inspect(__MODULE__)} clean close")
       # we are closing cleanly, let it happen.
@@ -404,6 +573,82 @@ defmodule Scenic.Driver.Local do
     {:noreply, Input.clear_input_debounce(source, event, driver)}
   end
 
+  def handle_info({:_request_stats_, to}, %{assigns: %{stats_requests: requests}} = driver) do
+    driver = assign(driver, :stats_requests, [to | requests])
+    {:noreply, query_stats(driver)}
+  end
+
+  # subscribers are monitored, so one that exits without unsubscribing
+  # doesn't keep the stats coming
+  def handle_info(
+        {:_subscribe_stats_, to, period_ms},
+        %{assigns: %{stats_subscribers: subscribers}} = driver
+      ) do
+    ref =
+      case subscribers do
+        %{^to => {_, ref}} -> ref
+        _ -> Process.monitor(to)
+      end
+
+    driver = assign(driver, :stats_subscribers, Map.put(subscribers, to, {period_ms, ref}))
+    {:noreply, query_stats(driver)}
+  end
+
+  def handle_info(
+        {:_unsubscribe_stats_, to},
+        %{assigns: %{stats_subscribers: subscribers}} = driver
+      ) do
+    case subscribers do
+      %{^to => {_, ref}} -> Process.demonitor(ref, [:flush])
+      _ -> :ok
+    end
+
+    driver = assign(driver, :stats_subscribers, Map.delete(subscribers, to))
+    {:noreply, query_stats(driver)}
+  end
+
+  def handle_info(
+        {:DOWN, ref, :process, pid, _reason},
+        %{assigns: %{stats_subscribers: subscribers}} = driver
+      ) do
+    case subscribers do
+      %{^pid => {_, ^ref}} ->
+        driver = assign(driver, :stats_subscribers, Map.delete(subscribers, pid))
+        {:noreply, query_stats(driver)}
+
+      _ ->
+        {:noreply, driver}
+    end
+  end
+
+  def handle_info({:_start_trace_, events}, %{assigns: %{port: port}} = driver) do
+    ToPort.start_trace(events, port)
+    {:noreply, driver}
+  end
+
+  def handle_info({:_dump_trace_, path}, %{assigns: %{port: port}} = driver) do
+    ToPort.dump_trace(path, port)
+    {:noreply, driver}
+  end
+
+  def handle_info({:_dump_frame_, path}, %{assigns: %{port: port}} = driver) do
+    ToPort.dump_frame(path, port)
+    {:noreply, driver}
+  end
+
+  def handle_info({:_start_profile_, on?}, %{assigns: %{port: port}} = driver) do
+    ToPort.start_profile(on?, port)
+    {:noreply, driver}
+  end
+
+  def handle_info(
+        {:_request_profile_, to, top_n},
+        %{assigns: %{profile_requests: requests, port: port}} = driver
+      ) do
+    ToPort.query_profile(top_n, port)
+    {:noreply, assign(driver, :profile_requests, [to | requests])}
+  end
+
   def handle_info(_msg, driver) do
     # Logger.warn("#{inspect(__MODULE__)} ignoring #{inspect(msg)}")
     {:noreply, driver}
@@ -412,6 +657,19 @@ defmodule Scenic.Driver.Local do
   # --------------------------------------------------------
   # internal helper utilities
 
+  # the port sends the stats as often as the most frequent subscriber
+  # wants them, and stops once there are none
+  defp query_stats(%{assigns: %{stats_subscribers: subscribers, port: port}} = driver) do
+    period_ms =
+      case Map.values(subscribers) do
+        [] -> 0
+        subs -> subs |> Enum.map(fn {period_ms, _ref} -> period_ms end) |> Enum.min()
+      end
+
+    ToPort.query_stats(period_ms, port)
+    driver
+  end
+
   @doc false
   # not defp because it is called from input.ex
   def set_global_tx(
@@ -8,6 +8,7 @@ defmodule Scenic.Driver.Local.FromPort do
 
   alias Scenic.ViewPort
   alias Scenic.Driver
+  alias Scenic.Driver.Local.Shm
 
   # import IEx
 
@@ -24,12 +25,14 @@ defmodule Scenic.Driver.Local.FromPort do
 
   # incoming message ids
   @msg_close_id 0x00
-  #  @msg_stats_id             0x01
+  @msg_stats_id 0x01
   @msg_puts_id 0x02
   @msg_write_id 0x03
   @msg_inspect_id 0x04
   @msg_reshape_id 0x05
   @msg_ready_id 0x06
+  @msg_profile_id 0x08
+  @msg_shm_done_id 0x09
 
   @msg_info_id 0xA0
   @msg_warn_id 0xA1
@@ -122,6 +125,43 @@ defmodule Scenic.Driver.Local.FromPort do
     end
   end
 
+  # --------------------------------------------------------
+  def handle_port_message(
+        <<@msg_stats_id::unsigned-integer-size(32)-native>> <> msg,
+        %{assigns: %{stats_requests: requests, stats_subscribers: subscribers}} = driver
+      ) do
+    stats = decode_stats(msg)
+
+    (requests ++ Map.keys(subscribers))
+    |> Enum.uniq()
+    |> Enum.each(&send(&1, {:scenic_driver_local_stats, stats}))
+
+    {:noreply, assign(driver, :stats_requests, [])}
+  end
+
+  # --------------------------------------------------------
+  def handle_port_message(
+        <<@msg_profile_id::unsigned-integer-size(32)-native>> <> msg,
+        %{assigns: %{profile_requests: requests}} = driver
+      ) do
+    profile = decode_profile(msg)
+
+    requests
+    |> Enum.uniq()
+    |> Enum.each(&send(&1, {:scenic_driver_local_profile, profile}))
+
+    {:noreply, assign(driver, :profile_requests, [])}
+  end
+
+  # --------------------------------------------------------
+  # the driver has read a shared memory slot, so it can be written again
+  def handle_port_message(
+        <<@msg_shm_done_id::unsigned-integer-size(32)-native>> <> path,
+        %{assigns: %{shm: shm}} = driver
+      ) do
+    {:noreply, assign(driver, :shm, Shm.release(shm, path))}
+  end
+
   # --------------------------------------------------------
   def handle_port_message(
         <<@msg_puts_id::unsigned-integer-size(32)-native>> <> msg,
@@ -676,6 +716,86 @@ defmodule Scenic.Driver.Local.FromPort do
     end
   end
 
+  # --------------------------------------------------------
+  # frame times are in microseconds. The percentiles cover the most recent
+  # frames, up to a few hundred of them
+  defp decode_stats(<<
+         frames::unsigned-integer-size(32)-native,
+         frames_skipped::unsigned-integer-size(32)-native,
+         frames_dropped::unsigned-integer-size(32)-native,
+         samples::unsigned-integer-size(32)-native,
+         times::binary-size(60),
+         bytes_in::unsigned-integer-size(64)-native,
+         script_count::unsigned-integer-size(32)-native,
+         script_bytes::unsigned-integer-size(64)-native,
+         image_count::unsigned-integer-size(32)-native,
+         image_bytes::unsigned-integer-size(64)-native,
+         font_count::unsigned-integer-size(32)-native,
+         font_bytes::unsigned-integer-size(64)-native
+       >>) do
+    [ingest, interpret, backend, present, total] =
+      for <<p50::unsigned-integer-size(32)-native,
+            p95::unsigned-integer-size(32)-native,
+            p99::unsigned-integer-size(32)-native <- times>> do
+        %{p50: p50, p95: p95, p99: p99}
+      end
+
+    %{
+      frames: frames,
+      frames_skipped: frames_skipped,
+      frames_dropped: frames_dropped,
+      samples: samples,
+      ingest: ingest,
+      interpret: interpret,
+      backend: backend,
+      present: present,
+      total: total,
+      bytes_in: bytes_in,
+      scripts: %{count: script_count, bytes: script_bytes},
+      images: %{count: image_count, bytes: image_bytes},
+      fonts: %{count: font_count, bytes: font_bytes}
+    }
+  end
+
+  # --------------------------------------------------------
+  defp decode_profile(<<elapsed_ns::unsigned-integer-size(64)-native, msg::binary>>) do
+    <<op_count::unsigned-integer-size(32)-native, msg::binary>> = msg
+    {ops, msg} = decode_profile_ops(op_count, msg, [])
+    <<script_count::unsigned-integer-size(32)-native, msg::binary>> = msg
+    {scripts, <<>>} = decode_profile_scripts(script_count, msg, [])
+    %{elapsed_ns: elapsed_ns, ops: ops, scripts: scripts}
+  end
+
+  defp decode_profile_ops(0, msg, ops), do: {Enum.reverse(ops), msg}
+
+  defp decode_profile_ops(count, msg, ops) do
+    <<
+      size::unsigned-integer-size(32)-native,
+      name::binary-size(size),
+      runs::unsigned-integer-size(64)-native,
+      time_ns::unsigned-integer-size(64)-native,
+      msg::binary
+    >> = msg
+
+    decode_profile_ops(count - 1, msg, [%{op: name, count: runs, time_ns: time_ns} | ops])
+  end
+
+  defp decode_profile_scripts(0, msg, scripts), do: {Enum.reverse(scripts), msg}
+
+  defp decode_profile_scripts(count, msg, scripts) do
+    <<
+      size::unsigned-integer-size(32)-native,
+      id::binary-size(size),
+      calls::unsigned-integer-size(64)-native,
+      total_ns::unsigned-integer-size(64)-native,
+      self_ns::unsigned-integer-size(64)-native,
+      msg::binary
+    >> = msg
+
+    script = %{id: id, count: calls, total_ns: total_ns, self_ns: self_ns}
+    decode_profile_scripts(count - 1, msg, [script | scripts])
+  end
+
   # --------------------------------------------------------
   defp codepoint_to_char(codepoint_to_atom)
   defp codepoint_to_char(cp), do: <<cp::utf8>>
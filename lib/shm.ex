@@ -0,0 +1,98 @@
+#
+#  Created on 2026-10-18.
+#  Copyright 2026 Kry10 Limited
+#
+
+# Ring of shared memory files that large stream payloads are written into,
+# so that only a short message describing them goes down the port. The
+# driver maps each file read-only the first time it sees it.
+#
+# Files are only ever grown, never truncated, so the driver can't read past
+# the end of one while it is being rewritten. A slot is busy from when it is
+# written until the driver says it is done with it, and is not written again
+# until then. When every slot is busy the caller sends the payload down the
+# port instead.
+
+defmodule Scenic.Driver.Local.Shm do
+  @moduledoc false
+
+  @dir "/dev/shm"
+  @slot_count 4
+
+  defstruct slots: {}, next: 0, busy: MapSet.new()
+
+  @doc false
+  def open() do
+    name = "scenic_driver_local_#{System.pid()}_#{System.unique_integer([:positive])}"
+    base = Path.join(@dir, name)
+
+    slots =
+      Enum.reduce_while(0..(@slot_count - 1), [], fn n, slots ->
+        path = "#{base}_#{n}"
+
+        case :file.open(path, [:read, :write, :raw, :binary]) do
+          {:ok, fd} -> {:cont, [{path, fd} | slots]}
+          err -> {:halt, {err, slots}}
+        end
+      end)
+
+    case slots do
+      {err, slots} ->
+        close(%__MODULE__{slots: List.to_tuple(slots)})
+        err
+
+      slots ->
+        {:ok, %__MODULE__{slots: slots |> Enum.reverse() |> List.to_tuple()}}
+    end
+  end
+
+  @doc false
+  def write(%__MODULE__{slots: slots, next: next, busy: busy} = shm, bin) when is_binary(bin) do
+    count = tuple_size(slots)
+
+    # the first free slot, going round from the one after the last written
+    free =
+      0..(count - 1)
+      |> Enum.map(&rem(next + &1, count))
+      |> Enum.find(&(!MapSet.member?(busy, &1)))
+
+    case free do
+      nil ->
+        {:error, :busy}
+
+      n ->
+        {path, fd} = elem(slots, n)
+
+        case :file.pwrite(fd, 0, bin) do
+          :ok ->
+            {:ok, path, %{shm | next: rem(n + 1, count), busy: MapSet.put(busy, n)}}
+
+          err ->
+            err
+        end
+    end
+  end
+
+  # the driver has read the payload in the file at path
+  @doc false
+  def release(%__MODULE__{slots: slots, busy: busy} = shm, path) do
+    case Enum.find_index(Tuple.to_list(slots), fn {p, _} -> p == path end) do
+      nil -> shm
+      n -> %{shm | busy: MapSet.delete(busy, n)}
+    end
+  end
+
+  def release(shm, _path), do: shm
+
+  @doc false
+  def close(%__MODULE__{slots: slots}) do
+    slots
+    |> Tuple.to_list()
+    |> Enum.each(fn {path, fd} ->
+      :file.close(fd)
+      File.rm(path)
+    end)
+  end
+
+  def close(_), do: :ok
+end
@@ -20,7 +20,7 @@ defmodule Scenic.Driver.Local.ToPort do
   @cmd_request_input 0x0A
 
   @cmd_close 0x20
-  # @cmd_query_stats 0x21
+  @cmd_query_stats 0x21
   @cmd_reshape 0x22
   @cmd_position 0x23
   @cmd_focus 0x24
@@ -29,9 +29,16 @@ defmodule Scenic.Driver.Local.ToPort do
   @cmd_restore 0x27
   @cmd_show 0x28
   @cmd_hide 0x29
+  @cmd_start_trace 0x2A
+  @cmd_dump_trace 0x2B
+  @cmd_start_profile 0x2C
+  @cmd_query_profile 0x2D
+  @cmd_dump_frame 0x2E
 
   @cmd_put_font 0x40
   @cmd_put_img 0x41
+  @cmd_put_img_shm 0x42
+  @cmd_put_img_region 0x43
 
   @min_window_width 40
   @min_window_height 20
@@ -229,6 +236,60 @@ defmodule Scenic.Driver.Local.ToPort do
     Port.command(port, <<@cmd_close::unsigned-integer-size(32)-native>>)
   end
 
+  @doc false
+  # the stats come back once now and then every period_ms. 0 stops them
+  def query_stats(period_ms, port) when is_integer(period_ms) and period_ms >= 0 do
+    msg = <<
+      @cmd_query_stats::unsigned-integer-size(32)-native,
+      period_ms::unsigned-integer-size(32)-native
+    >>
+
+    Port.command(port, msg)
+  end
+
+  @doc false
+  # keeps the most recent events, rounded up to a power of two. 0 stops
+  def start_trace(events, port) when is_integer(events) and events >= 0 do
+    msg = <<
+      @cmd_start_trace::unsigned-integer-size(32)-native,
+      events::unsigned-integer-size(32)-native
+    >>
+
+    Port.command(port, msg)
+  end
+
+  @doc false
+  def dump_trace(path, port) when is_binary(path) do
+    Port.command(port, [<<@cmd_dump_trace::unsigned-integer-size(32)-native>>, path])
+  end
+
+  @doc false
+  def dump_frame(path, port) when is_binary(path) do
+    Port.command(port, [<<@cmd_dump_frame::unsigned-integer-size(32)-native>>, path])
+  end
+
+  @doc false
+  # true starts profiling afresh. false stops and keeps what was gathered
+  def start_profile(on?, port) when is_boolean(on?) do
+    msg = <<
+      @cmd_start_profile::unsigned-integer-size(32)-native,
+      if(on?, do: 1, else: 0)::unsigned-integer-size(32)-native
+    >>
+
+    Port.command(port, msg)
+  end
+
+  @doc false
+  # the profile comes back with the top_n hottest ops and scripts
+  def query_profile(top_n, port) when is_integer(top_n) and top_n >= 0 do
+    msg = <<
+      @cmd_query_profile::unsigned-integer-size(32)-native,
+      top_n::unsigned-integer-size(32)-native
+    >>
+
+    Port.command(port, msg)
+  end
+
   def focus(port) do
     Port.command(port, <<@cmd_focus::unsigned-integer-size(32)-native>>)
   end
@@ -307,4 +368,87 @@ defmodule Scenic.Driver.Local.ToPort do
 
     Port.command(port, msg)
   end
+
+  # the pixels are already in a shared memory file at path
+  def put_texture_shm(port, id, format, w, h, path, size)
+
+  def put_texture_shm(port, id, :file, w, h, path, size) do
+    do_put_texture_shm(port, id, 0, w, h, path, size)
+  end
+
+  def put_texture_shm(port, id, :g, w, h, path, size) do
+    do_put_texture_shm(port, id, 1, w, h, path, size)
+  end
+
+  def put_texture_shm(port, id, :ga, w, h, path, size) do
+    do_put_texture_shm(port, id, 2, w, h, path, size)
+  end
+
+  def put_texture_shm(port, id, :rgb, w, h, path, size) do
+    do_put_texture_shm(port, id, 3, w, h, path, size)
+  end
+
+  def put_texture_shm(port, id, :rgba, w, h, path, size) do
+    do_put_texture_shm(port, id, 4, w, h, path, size)
+  end
+
+  def do_put_texture_shm(port, id, format, w, h, path, size)
+      when is_integer(w) and is_integer(h) and is_binary(path) and is_binary(id) do
+    msg = [
+      <<@cmd_put_img_shm::unsigned-integer-size(32)-native>>,
+      <<
+        byte_size(id)::unsigned-integer-size(32)-native,
+        byte_size(path)::unsigned-integer-size(32)-native,
+        0::unsigned-integer-size(32)-native,
+        size::unsigned-integer-size(32)-native,
+        w::unsigned-integer-size(32)-native,
+        h::unsigned-integer-size(32)-native,
+        format::unsigned-integer-size(32)-native
+      >>,
+      id,
+      path
+    ]
+
+    Port.command(port, msg)
+  end
+
+  # replace the x/y/w/h region of an existing texture. bin holds just the
+  # pixels of the region. Only raw formats, not files
+  def put_texture_region(port, id, format, x, y, w, h, bin)
+
+  def put_texture_region(port, id, :g, x, y, w, h, bin) do
+    do_put_texture_region(port, id, 1, x, y, w, h, bin)
+  end
+
+  def put_texture_region(port, id, :ga, x, y, w, h, bin) do
+    do_put_texture_region(port, id, 2, x, y, w, h, bin)
+  end
+
+  def put_texture_region(port, id, :rgb, x, y, w, h, bin) do
+    do_put_texture_region(port, id, 3, x, y, w, h, bin)
+  end
+
+  def put_texture_region(port, id, :rgba, x, y, w, h, bin) do
+    do_put_texture_region(port, id, 4, x, y, w, h, bin)
+  end
+
+  def do_put_texture_region(port, id, format, x, y, w, h, bin)
+      when is_integer(x) and is_integer(y) and is_integer(w) and is_integer(h) and
+             is_binary(bin) and is_binary(id) do
+    msg = [
+      <<@cmd_put_img_region::unsigned-integer-size(32)-native>>,
+      <<
+        byte_size(id)::unsigned-integer-size(32)-native,
+        x::unsigned-integer-size(32)-native,
+        y::unsigned-integer-size(32)-native,
+        w::unsigned-integer-size(32)-native,
+        h::unsigned-integer-size(32)-native,
+        format::unsigned-integer-size(32)-native
+      >>,
+      id,
+      bin
+    ]
+
+    Port.command(port, msg)
+  end
 end
@@ -35,4 +35,71 @@ defmodule Scenic.Driver.LocalTest do
 
     assert validation_error.message =~ "expected :name"
   end
+
+  test "validate_opts/1 with the rendering and capture opts" do
+    opts = [
+      vsync: false,
+      render_threads: 4,
+      dither: true,
+      layer_cache: 16,
+      refresh_rate: 60,
+      capture: "/tmp/scenic.cap",
+      window: [title: "Captured"]
+    ]
+
+    assert {:ok, valid} = Scenic.Driver.Local.validate_opts(opts)
+    assert valid[:vsync] == false
+    assert valid[:render_threads] == 4
+    assert valid[:dither] == true
+    assert valid[:layer_cache] == 16
+    assert valid[:refresh_rate] == 60
+    assert valid[:capture] == "/tmp/scenic.cap"
+    assert valid[:window][:title] == "Captured"
+  end
+
+  test "validate_opts/1 with invalid rendering and capture opts" do
+    for {key, value} <- [
+          vsync: "yes",
+          render_threads: -1,
+          dither: 1,
+          layer_cache: -16,
+          refresh_rate: 59.94,
+          capture: ~c"/tmp/scenic.cap"
+        ] do
+      assert {:error, validation_error} = Scenic.Driver.Local.validate_opts([{key, value}])
+      assert validation_error.message =~ "#{key}"
+    end
+
+    assert {:error, validation_error} =
+             Scenic.Driver.Local.validate_opts(window: [title: :captured])
+
+    assert validation_error.message =~ "title"
+  end
+
+  test "a stats subscriber that exits is dropped and the stats stop" do
+    # cat stands in for the port, and sends back what it was sent
+    port = Port.open({:spawn_executable, System.find_executable("cat")}, [:binary])
+
+    driver = %Scenic.Driver{
+      assigns: %{port: port, stats_requests: [], stats_subscribers: %{}}
+    }
+
+    subscriber = spawn(fn -> Process.sleep(:infinity) end)
+
+    # the driver's monitors come to this process, since it is standing in
+    {:noreply, driver} =
+      Scenic.Driver.Local.handle_info({:_subscribe_stats_, subscriber, 100}, driver)
+
+    assert Map.keys(driver.assigns.stats_subscribers) == [subscriber]
+    assert_receive {^port, {:data, <<0x21::32-native, 100::32-native>>}}
+
+    Process.exit(subscriber, :kill)
+    assert_receive {:DOWN, ref, :process, ^subscriber, :killed}
+
+    {:noreply, driver} =
+      Scenic.Driver.Local.handle_info({:DOWN, ref, :process, subscriber, :killed}, driver)
+
+    assert driver.assigns.stats_subscribers == %{}
+    assert_receive {^port, {:data, <<0x21::32-native, 0::32-native>>}}
+  end
 end
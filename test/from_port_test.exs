@@ -0,0 +1,112 @@
+defmodule Scenic.Driver.Local.FromPortTest do
+  use ExUnit.Case
+
+  alias Scenic.Driver.Local.FromPort
+
+  @stats_id 0x01
+  @profile_id 0x08
+
+  defp driver(assigns) do
+    empty = %{stats_requests: [], stats_subscribers: %{}, profile_requests: []}
+    %Scenic.Driver{assigns: Map.merge(empty, assigns)}
+  end
+
+  defp percentiles(p50, p95, p99) do
+    <<p50::32-native, p95::32-native, p99::32-native>>
+  end
+
+  test "stats are decoded and sent to whoever asked" do
+    msg = <<
+      @stats_id::32-native,
+      # frames, skipped, dropped, samples
+      120::32-native,
+      3::32-native,
+      2::32-native,
+      100::32-native,
+      # ingest, interpret, backend, present, total
+      percentiles(10, 20, 30)::binary,
+      percentiles(40, 50, 60)::binary,
+      percentiles(70, 80, 90)::binary,
+      percentiles(1, 2, 3)::binary,
+      percentiles(121, 152, 183)::binary,
+      # bytes in
+      5_000_000_000::64-native,
+      # scripts, images and fonts, each a count and bytes
+      12::32-native,
+      3400::64-native,
+      4::32-native,
+      65_536::64-native,
+      1::32-native,
+      250_000::64-native
+    >>
+
+    # asked once and subscribed too, but sent them once
+    driver = driver(%{stats_requests: [self()], stats_subscribers: %{self() => {100, nil}}})
+
+    assert {:noreply, driver} = FromPort.handle_port_message(msg, driver)
+    assert driver.assigns.stats_requests == []
+
+    assert_received {:scenic_driver_local_stats, stats}
+    refute_received {:scenic_driver_local_stats, _}
+
+    assert stats == %{
+             frames: 120,
+             frames_skipped: 3,
+             frames_dropped: 2,
+             samples: 100,
+             ingest: %{p50: 10, p95: 20, p99: 30},
+             interpret: %{p50: 40, p95: 50, p99: 60},
+             backend: %{p50: 70, p95: 80, p99: 90},
+             present: %{p50: 1, p95: 2, p99: 3},
+             total: %{p50: 121, p95: 152, p99: 183},
+             bytes_in: 5_000_000_000,
+             scripts: %{count: 12, bytes: 3400},
+             images: %{count: 4, bytes: 65_536},
+             fonts: %{count: 1, bytes: 250_000}
+           }
+  end
+
+  test "a profile is decoded and sent to whoever asked" do
+    msg = <<
+      @profile_id::32-native,
+      # elapsed
+      2_000_000::64-native,
+      # ops: name, count, time
+      2::32-native,
+      9::32-native,
+      "draw_text",
+      40::64-native,
+      900_000::64-native,
+      9::32-native,
+      "fill_path",
+      7::64-native,
+      100_000::64-native,
+      # scripts: id, calls, total, self
+      1::32-native,
+      6::32-native,
+      "_root_",
+      1::64-native,
+      1_500_000::64-native,
+      300_000::64-native
+    >>
+
+    driver = driver(%{profile_requests: [self(), self()]})
+
+    assert {:noreply, driver} = FromPort.handle_port_message(msg, driver)
+    assert driver.assigns.profile_requests == []
+
+    assert_received {:scenic_driver_local_profile, profile}
+    refute_received {:scenic_driver_local_profile, _}
+
+    assert profile == %{
+             elapsed_ns: 2_000_000,
+             ops: [
+               %{op: "draw_text", count: 40, time_ns: 900_000},
+               %{op: "fill_path", count: 7, time_ns: 100_000}
+             ],
+             scripts: [
+               %{id: "_root_", count: 1, total_ns: 1_500_000, self_ns: 300_000}
+             ]
+           }
+  end
+end
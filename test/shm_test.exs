@@ -0,0 +1,33 @@
+defmodule Scenic.Driver.Local.ShmTest do
+  use ExUnit.Case
+
+  alias Scenic.Driver.Local.Shm
+
+  setup do
+    {:ok, shm} = Shm.open()
+    on_exit(fn -> Shm.close(shm) end)
+    %{shm: shm}
+  end
+
+  test "write/2 doesn't reuse a slot until it is released", %{shm: shm} do
+    {shm, paths} =
+      Enum.reduce(1..4, {shm, []}, fn n, {shm, paths} ->
+        assert {:ok, path, shm} = Shm.write(shm, <<n>>)
+        {shm, [path | paths]}
+      end)
+
+    assert paths |> Enum.uniq() |> length() == 4
+    assert Shm.write(shm, <<5>>) == {:error, :busy}
+
+    [last | _] = paths
+    shm = Shm.release(shm, last)
+    assert {:ok, ^last, shm} = Shm.write(shm, <<5>>)
+    assert File.read!(last) == <<5>>
+    assert Shm.write(shm, <<6>>) == {:error, :busy}
+  end
+
+  test "release/2 ignores paths it doesn't know", %{shm: shm} do
+    assert Shm.release(shm, "/dev/shm/not_a_slot") == shm
+    assert Shm.release(nil, "/dev/shm/not_a_slot") == nil
+  end
+end
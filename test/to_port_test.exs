@@ -0,0 +1,90 @@
+defmodule Scenic.Driver.Local.ToPortTest do
+  use ExUnit.Case
+
+  alias Scenic.Driver.Local.ToPort
+
+  # cat sends back exactly what the driver would have been sent
+  setup do
+    %{port: Port.open({:spawn_executable, System.find_executable("cat")}, [:binary])}
+  end
+
+  defp sent(port, size, acc \\ <<>>)
+  defp sent(_port, size, acc) when byte_size(acc) >= size, do: acc
+
+  defp sent(port, size, acc) do
+    receive do
+      {^port, {:data, data}} -> sent(port, size, acc <> data)
+    after
+      1000 -> acc
+    end
+  end
+
+  defp assert_sent(port, expected) do
+    assert sent(port, byte_size(expected)) == expected
+  end
+
+  test "query_stats/2", %{port: port} do
+    ToPort.query_stats(250, port)
+    assert_sent(port, <<0x21::32-native, 250::32-native>>)
+  end
+
+  test "start_trace/2", %{port: port} do
+    ToPort.start_trace(4096, port)
+    assert_sent(port, <<0x2A::32-native, 4096::32-native>>)
+  end
+
+  test "dump_trace/2", %{port: port} do
+    ToPort.dump_trace("/tmp/trace.json", port)
+    assert_sent(port, <<0x2B::32-native, "/tmp/trace.json">>)
+  end
+
+  test "start_profile/2", %{port: port} do
+    ToPort.start_profile(true, port)
+    ToPort.start_profile(false, port)
+    assert_sent(port, <<0x2C::32-native, 1::32-native, 0x2C::32-native, 0::32-native>>)
+  end
+
+  test "query_profile/2", %{port: port} do
+    ToPort.query_profile(10, port)
+    assert_sent(port, <<0x2D::32-native, 10::32-native>>)
+  end
+
+  test "dump_frame/2", %{port: port} do
+    ToPort.dump_frame("/tmp/frame.png", port)
+    assert_sent(port, <<0x2E::32-native, "/tmp/frame.png">>)
+  end
+
+  test "put_texture_shm/7", %{port: port} do
+    ToPort.put_texture_shm(port, "img", :rgb, 2, 3, "/scenic_0", 18)
+
+    assert_sent(port, <<
+      0x42::32-native,
+      3::32-native,
+      9::32-native,
+      0::32-native,
+      18::32-native,
+      2::32-native,
+      3::32-native,
+      3::32-native,
+      "img",
+      "/scenic_0"
+    >>)
+  end
+
+  test "put_texture_region/8", %{port: port} do
+    pixels = <<1, 2, 3, 4, 5, 6>>
+    ToPort.put_texture_region(port, "img", :g, 4, 5, 3, 2, pixels)
+
+    assert_sent(port, <<
+      0x43::32-native,
+      3::32-native,
+      4::32-native,
+      5::32-native,
+      3::32-native,
+      2::32-native,
+      1::32-native,
+      "img",
+      pixels::binary
+    >>)
+  end
+end